@@ -3,6 +3,7 @@
 #include "eudaq/FileReader.hh"
 #include "eudaq/OptionParser.hh"
 #include "eudaq/Utils.hh"
+#include "eudaq/Clustering.hh"
 
 #include <iostream>
 #include <algorithm>
@@ -25,6 +26,7 @@ struct Seed {
 
 struct Cluster {
   Cluster(double x, double y, double c) : x(x), y(y), c(c) {}
+  static bool compare(const Cluster & lhs, const Cluster & rhs) { return lhs.c > rhs.c; }
   double x, y, c;
 };
 
@@ -47,6 +49,7 @@ int main(int /*argc*/, char ** argv) {
   eudaq::Option<double> thresh_seed(op, "s", "seed-thresh", 5.0, "thresh", "Threshold for seed pixels, in units of sigma");
   eudaq::Option<double> thresh_clus(op, "c", "cluster-thresh", 10.0, "thresh", "Threshold for 3x3 clusters, in units of sigma");
 
+  eudaq::OptionFlag connected(op, "a", "connected", "Cluster all connected pixels above the seed threshold instead of NxN windows around seeds");
   eudaq::OptionFlag weighted(op, "w", "weighted", "Use weighted average for cluster centre instead of seed position");
   eudaq::OptionFlag tracksonly(op, "t", "tracks-only", "Extract only clusters which are part of a track (not implemented)");
   eudaq::Option<std::string> boards(op, "b", "boards", "", "numbers", "Board numbers to extract (empty=all)");
@@ -69,11 +72,17 @@ int main(int /*argc*/, char ** argv) {
       unsigned runnum = 0;
       const int dclust = clust.Value()/2;
       std::vector<unsigned> planes = parsenumbers(boards.Value());
-      std::cout << "Cluster size " << clust.Value() << "x" << clust.Value() << " (dclust=" << dclust << ")" << std::endl;
+      // connected clusters have no fixed size, so their threshold is not scaled
+      const double clusterthresh = (connected.IsSet() ? 1 : clust.Value()) * noise.Value() * thresh_clus.Value();
+      if (connected.IsSet()) {
+        std::cout << "Connected clusters" << std::endl;
+      } else {
+        std::cout << "Cluster size " << clust.Value() << "x" << clust.Value() << " (dclust=" << dclust << ")" << std::endl;
+      }
       std::cout << "Seed threshold: " << thresh_seed.Value() << " sigma = "
         << thresh_seed.Value()*noise.Value() << " adc" << std::endl;
       std::cout << "Cluster threshold: " << thresh_clus.Value() << " sigma = "
-        << clust.Value()*noise.Value()*thresh_clus.Value() << " adc" << std::endl;
+        << clusterthresh << " adc" << std::endl;
       std::cout << "Boards: ";
       if (planes.empty()) std::cout << "all";
       for (size_t i = 0; i < planes.size(); ++i) std::cout << (i ? ", " : "") << planes[i];
@@ -123,6 +132,9 @@ int main(int /*argc*/, char ** argv) {
       // }
       // std::cout << std::endl;
 
+      eudaq::PixelClusterer clusterer;
+      std::vector<int> clusx, clusy;
+      std::vector<unsigned> labels;
       std::vector<unsigned> hit_hist;
       {
         const eudaq::DetectorEvent & dev = reader.GetDetectorEvent();
@@ -182,7 +194,7 @@ int main(int /*argc*/, char ** argv) {
               int width = brd.XSize() - xmarkers.Value().size();
               int height = brd.YSize() - ymarkers.Value().size();
               std::vector<double> cds(width * height);
-              std::vector<Seed> seeds;
+              std::vector<Seed> seeds, badpix;
               for (unsigned i = 0; i < brd.HitPixels(); ++i) {
                 int x = XFIX((unsigned)brd.GetX(i)), y = YFIX((unsigned)brd.GetY(i));
                 if (x < 0 || y < 0) continue;
@@ -191,36 +203,54 @@ int main(int /*argc*/, char ** argv) {
                 if (cds[idx] >= noise.Value() * thresh_seed.Value()) {
                   seeds.push_back(Seed(x, y, cds[idx]));
                   //if (p < 6) std::cout << i << ", " << x << ", " << y << ", " << idx << ", " << cds[idx] << std::endl;
+                } else if (connected.IsSet() && cds[idx] == BADPIX) {
+                  badpix.push_back(Seed(x, y, 0));
                 }
               }
-              std::sort(seeds.begin(), seeds.end(), &Seed::compare);
               std::vector<Cluster> clusters;
-              for (size_t i = 0; i < seeds.size(); ++i) {
-                bool badseed = false;
-                double charge = 0, sumx = 0, sumy = 0;
-                for (int dy = -dclust; dy <= dclust; ++dy) {
-                  int y = seeds[i].y + dy;
-                  if (y < 0 || y >= height) continue;
-                  for (int dx = -dclust; dx <= dclust; ++dx) {
-                    int x = seeds[i].x + dx;
-                    if (x < 0 || x >= width) continue;
-                    size_t idx = width * y + x;
-                    if (cds[idx] == BADPIX) {
-                      badseed = true;
-                    } else {
-                      charge += cds[idx];
-                      sumx += x*cds[idx];
-                      sumy += y*cds[idx];
-                    }
-                  }
+              if (connected.IsSet()) {
+                // every seed pixel belongs to exactly one cluster; bad pixels
+                // are clustered too, so that clusters touching one are dropped
+                // like the NxN windows below (markers are already removed)
+                clusx.clear();
+                clusy.clear();
+                for (size_t i = 0; i < seeds.size(); ++i) {
+                  clusx.push_back(seeds[i].x);
+                  clusy.push_back(seeds[i].y);
+                }
+                for (size_t i = 0; i < badpix.size(); ++i) {
+                  clusx.push_back(badpix[i].x);
+                  clusy.push_back(badpix[i].y);
+                }
+                size_t nclus = clusterer.Cluster(clusx.data(), clusy.data(), 0, clusx.size(), labels);
+                std::vector<double> charge(nclus, 0), sumx(nclus, 0), sumy(nclus, 0);
+                std::vector<size_t> maxseed(nclus, seeds.size());
+                std::vector<bool> badclus(nclus, false);
+                for (size_t i = 0; i < badpix.size(); ++i) {
+                  badclus[labels[seeds.size() + i]] = true;
                 }
-                if (!badseed && charge >= clust.Value() * noise.Value() * thresh_clus.Value()) {
-                  double cx = seeds[i].x, cy = seeds[i].y;
+                for (size_t i = 0; i < seeds.size(); ++i) {
+                  unsigned l = labels[i];
+                  charge[l] += seeds[i].a;
+                  sumx[l] += seeds[i].x * seeds[i].a;
+                  sumy[l] += seeds[i].y * seeds[i].a;
+                  if (maxseed[l] == seeds.size() || seeds[i].a > seeds[maxseed[l]].a) maxseed[l] = i;
+                }
+                for (size_t c = 0; c < nclus; ++c) {
+                  if (badclus[c] || charge[c] < clusterthresh) continue;
+                  double cx = seeds[maxseed[c]].x, cy = seeds[maxseed[c]].y;
                   if (weighted.IsSet()) {
-                    cx = sumx / (double)charge;
-                    cy = sumy / (double)charge;
+                    cx = sumx[c] / charge[c];
+                    cy = sumy[c] / charge[c];
                   }
-                  clusters.push_back(Cluster(cx, cy, charge));
+                  clusters.push_back(Cluster(cx, cy, charge[c]));
+                }
+                std::stable_sort(clusters.begin(), clusters.end(), &Cluster::compare);
+              } else {
+                std::sort(seeds.begin(), seeds.end(), &Seed::compare);
+                for (size_t i = 0; i < seeds.size(); ++i) {
+                  bool badseed = false;
+                  double charge = 0, sumx = 0, sumy = 0;
                   for (int dy = -dclust; dy <= dclust; ++dy) {
                     int y = seeds[i].y + dy;
                     if (y < 0 || y >= height) continue;
@@ -228,7 +258,31 @@ int main(int /*argc*/, char ** argv) {
                       int x = seeds[i].x + dx;
                       if (x < 0 || x >= width) continue;
                       size_t idx = width * y + x;
-                      cds[idx] = BADPIX;
+                      if (cds[idx] == BADPIX) {
+                        badseed = true;
+                      } else {
+                        charge += cds[idx];
+                        sumx += x*cds[idx];
+                        sumy += y*cds[idx];
+                      }
+                    }
+                  }
+                  if (!badseed && charge >= clusterthresh) {
+                    double cx = seeds[i].x, cy = seeds[i].y;
+                    if (weighted.IsSet()) {
+                      cx = sumx / (double)charge;
+                      cy = sumy / (double)charge;
+                    }
+                    clusters.push_back(Cluster(cx, cy, charge));
+                    for (int dy = -dclust; dy <= dclust; ++dy) {
+                      int y = seeds[i].y + dy;
+                      if (y < 0 || y >= height) continue;
+                      for (int dx = -dclust; dx <= dclust; ++dx) {
+                        int x = seeds[i].x + dx;
+                        if (x < 0 || x >= width) continue;
+                        size_t idx = width * y + x;
+                        cds[idx] = BADPIX;
+                      }
                     }
                   }
                 }
@@ -3,6 +3,9 @@
 #include "eudaq/OptionParser.hh"
 #include "eudaq/Utils.hh"
 #include "eudaq/Logger.hh"
+#include "eudaq/ParallelConverter.hh"
+#include "eudaq/Instrumentation.hh"
+#include "eudaq/PluginManager.hh"
 
 #include <iostream>
 #include "eudaq/MultiFileReader.hh"
@@ -10,6 +13,18 @@
 using namespace eudaq;
 unsigned dbg = 0; 
 
+// Converts the event (timed as STAGE_CONVERT) outside of STAGE_WRITE, except
+// the BORE, which the writer needs to initialize the plugins first
+static void Write(eudaq::FileWriter & writer, const eudaq::DetectorEvent & dev) {
+  if (writer.UsesStandardEvent() && !dev.IsBORE()) {
+    eudaq::StandardEvent sev = eudaq::PluginManager::ConvertToStandard(dev);
+    StageTimer timer(STAGE_WRITE);
+    writer.WriteStandardEvent(dev, sev);
+  } else {
+    StageTimer timer(STAGE_WRITE);
+    writer.WriteEvent(dev);
+  }
+}
 
 int main(int, char ** argv) {
 	std::clock_t    start;
@@ -23,14 +38,34 @@ int main(int, char ** argv) {
   eudaq::OptionFlag async(op, "a", "nosync", "Disables Synchronisation with TLU events");
   eudaq::Option<size_t> syncEvents(op, "n" ,"syncevents",1000,"size_t","Number of events that need to be synchronous before they are used");
   eudaq::Option<uint64_t> syncDelay(op, "d" ,"longDelay",20,"uint64_t","us time long time delay");
+  eudaq::Option<unsigned> threads(op, "j", "threads", 1, "threads", "Number of threads converting to StandardEvents (0 = one per core)");
   eudaq::Option<std::string> level(op, "l", "log-level", "INFO", "level",
       "The minimum level for displaying log messages locally");
+  eudaq::OptionFlag latency(op, "L", "latency", "Print the conversion and write latencies at the end");
   op.ExtraHelpText("Available output types are: " + to_string(eudaq::FileWriterFactory::GetTypes(), ", "));
   try {
     op.Parse(argv);
     EUDAQ_LOG_LEVEL(level.Value());
     std::vector<unsigned> numbers = parsenumbers(events.Value());
 	std::sort(numbers.begin(),numbers.end());
+    if (!numbers.empty() && async.Value() && op.NumArgs() == 1) {
+      // without synchronisation the selected events can be read directly,
+      // jumping to them through the index of the file
+      eudaq::FileReader reader(op.GetArg(0), ipat.Value(), true);
+      std::shared_ptr<eudaq::FileWriter> writer(FileWriterFactory::Create(type.Value()));
+      writer->SetFilePattern(opat.Value());
+      writer->StartRun(reader.RunNumber());
+      if (reader.SeekBORE()) Write(*writer, reader.GetDetectorEvent());
+      numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+      for (size_t i = 0; i < numbers.size(); ++i) {
+        if (!reader.SeekEvent(numbers[i])) {
+          EUDAQ_WARN("No event " + to_string(numbers[i]));
+          continue;
+        }
+        Write(*writer, reader.GetDetectorEvent());
+      }
+      if (reader.SeekEORE()) Write(*writer, reader.GetDetectorEvent());
+    } else {
 		eudaq::multiFileReader reader(!async.Value());
     for (size_t i = 0; i < op.NumArgs(); ++i) {
 	
@@ -39,14 +74,28 @@ int main(int, char ** argv) {
       std::shared_ptr<eudaq::FileWriter> writer(FileWriterFactory::Create(type.Value()));
       writer->SetFilePattern(opat.Value());
       writer->StartRun(reader.RunNumber());
+      std::unique_ptr<eudaq::ParallelConverter> converter;
+      if (threads.Value() != 1 && writer->UsesStandardEvent()) {
+        converter.reset(new eudaq::ParallelConverter(
+            [&writer](const DetectorEvent &dev, const StandardEvent &sev) {
+              StageTimer timer(STAGE_WRITE);
+              writer->WriteStandardEvent(dev, sev);
+            },
+            threads.Value()));
+      }
 	  int event_nr=0;
+      try {
       do {
 		  if (!numbers.empty()&&reader.GetDetectorEvent().GetEventNumber()>numbers.back())
 		  {
 			break;
 		  }else if (reader.GetDetectorEvent().IsBORE() || reader.GetDetectorEvent().IsEORE() || numbers.empty() ||
 				std::find(numbers.begin(), numbers.end(), reader.GetDetectorEvent().GetEventNumber()) != numbers.end()) {
-			  writer->WriteEvent(reader.GetDetectorEvent());
+			  if (converter) {
+				  converter->Convert(std::make_shared<DetectorEvent>(reader.GetDetectorEvent()));
+			  } else {
+				  Write(*writer, reader.GetDetectorEvent());
+			  }
 			  if(dbg>0)std::cout<< "writing one more event" << std::endl;
 			  ++event_nr;
 			  if (event_nr%1000==0)
@@ -55,13 +104,22 @@ int main(int, char ** argv) {
 			  }
 			}
       } while (reader.NextEvent());
+      } catch (...) {
+        // still write the events converted so far
+        if (converter) converter->Flush();
+        throw;
+      }
+      if (converter) converter->Flush();
       if(dbg>0)std::cout<< "no more events to read" << std::endl;
+    }
     
   } catch (...) {
 	    std::cout << "Time: " << (std::clock() - start) / (double)(CLOCKS_PER_SEC / 1000) << " ms" << std::endl;
+    if (latency.Value()) std::cout << Instrumentation::Report();
     return op.HandleMainException();
   }
     std::cout << "Time: " << (std::clock() - start) / (double)(CLOCKS_PER_SEC / 1000) << " ms" << std::endl;
+  if (latency.Value()) std::cout << Instrumentation::Report();
   if(dbg>0)std::cout<< "almost done with Converter. exiting" << std::endl;
   return 0;
 }
@@ -0,0 +1,67 @@
+#include "eudaq/OptionParser.hh"
+#include "eudaq/BufferSerializer.hh"
+#include "eudaq/StandardEvent.hh"
+#include "eudaq/Timer.hh"
+#include "eudaq/Utils.hh"
+
+#include <iostream>
+#include <cstdlib>
+
+using eudaq::to_string;
+
+int main(int /*argc*/, char ** argv) {
+  eudaq::OptionParser op("EUDAQ Serializer Benchmark", "1.0",
+      "Round-trips a large StandardEvent through a BufferSerializer and reports the throughput");
+  eudaq::Option<unsigned> npix(op, "n", "pixels", 1000000, "pixels",
+      "Total number of hit pixels in the event");
+  eudaq::Option<unsigned> nplanes(op, "p", "planes", 1, "planes",
+      "Number of planes the pixels are distributed over");
+  eudaq::Option<unsigned> nloops(op, "l", "loops", 20, "loops",
+      "Number of serialize/deserialize round trips");
+  try {
+    op.Parse(argv);
+    if (nplanes.Value() == 0) throw eudaq::OptionException("Need at least one plane");
+
+    eudaq::StandardEvent ev(1, 1);
+    unsigned perplane = npix.Value() / nplanes.Value();
+    std::srand(42);
+    for (unsigned p = 0; p < nplanes.Value(); ++p) {
+      eudaq::StandardPlane plane(p, "BENCH", "BENCH");
+      plane.SetSizeZS(1152, 576, 0);
+      for (unsigned i = 0; i < perplane; ++i) {
+        plane.PushPixel(std::rand() % 1152, std::rand() % 576, std::rand() % 256);
+      }
+      ev.AddPlane(plane);
+    }
+
+    size_t bytes = 0;
+    double tser = 0, tdes = 0;
+    for (unsigned loop = 0; loop < nloops.Value(); ++loop) {
+      eudaq::BufferSerializer buf;
+      eudaq::Timer tim;
+      ev.Serialize(buf);
+      tser += tim.Seconds();
+      bytes = buf.size();
+
+      tim.Restart();
+      buf.read<unsigned>(); // event type id
+      eudaq::StandardEvent out(buf);
+      tdes += tim.Seconds();
+
+      if (out.NumPlanes() != ev.NumPlanes() ||
+          out.GetPlane(0).HitPixels() != ev.GetPlane(0).HitPixels() ||
+          (perplane && out.GetPlane(0).GetX(perplane - 1) != ev.GetPlane(0).GetX(perplane - 1))) {
+        throw eudaq::MessageException("Round trip produced a different event");
+      }
+    }
+
+    double mb = bytes * nloops.Value() / 1e6;
+    std::cout << "Event size:  " << bytes << " bytes (" << perplane * nplanes.Value() << " pixels)\n"
+              << "Serialize:   " << 1e3 * tser / nloops.Value() << " ms/event, " << mb / tser << " MB/s\n"
+              << "Deserialize: " << 1e3 * tdes / nloops.Value() << " ms/event, " << mb / tdes << " MB/s"
+              << std::endl;
+  } catch (...) {
+    return op.HandleMainException();
+  }
+  return 0;
+}
@@ -5,6 +5,7 @@
 #include "eudaq/Utils.hh"
 #include "eudaq/DetectorEvent.hh"
 #include "eudaq/RawDataEvent.hh"
+#include "eudaq/CompactStandardEvent.hh"
 
 #include <iostream>
 #include <fstream>
@@ -92,6 +93,20 @@ bool DoEvent(unsigned /*ndata*/, const eudaq::DetectorEvent & dev, bool do_proce
   return do_display;
 }
 
+// Displays a data event selected with -d, returns false for unknown types
+bool DisplayEvent(unsigned ndata, const eudaq::Event & ev, bool do_process, bool do_zs, bool do_dump) {
+  if (const eudaq::DetectorEvent * dev = dynamic_cast<const eudaq::DetectorEvent *>(&ev)) {
+    DoEvent(ndata, *dev, do_process, true, do_zs, do_dump);
+  } else if (const StandardEvent * sev = dynamic_cast<const StandardEvent *>(&ev)) {
+    std::cout << *sev << std::endl;
+  } else if (const eudaq::CompactStandardEvent * cev = dynamic_cast<const eudaq::CompactStandardEvent *>(&ev)) {
+    std::cout << *cev << std::endl;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 int main(int /*argc*/, char ** argv) {
 
   eudaq::OptionParser op("EUDAQ Raw Data file reader", "1.0",
@@ -122,6 +137,10 @@ int main(int /*argc*/, char ** argv) {
 
     if (do_event_to_ttree.IsSet()) throw eudaq::MessageException("The -r option is deprecated: use \"./Converter.exe -t root\" instead.");
 
+    // if only some events are displayed, jump to them through the index
+    // instead of reading the whole file (there is no summary then)
+    bool seek = !displaynumbers.empty() && !showlast && !do_pall.IsSet() && !do_eore.IsSet();
+
     for (size_t i = 0; i < op.NumArgs(); ++i) {
 
       eudaq::FileReader reader(op.GetArg(i), ipat.Value());
@@ -129,6 +148,27 @@ int main(int /*argc*/, char ** argv) {
 
       //    cout << i << " " << reader.Filename()  << endl;
 
+      if (seek) {
+        if (reader.SeekBORE()) {
+          const eudaq::Event & bore = reader.GetEvent();
+          if (do_bore.IsSet()) std::cout << bore << std::endl;
+          if (const eudaq::DetectorEvent * dev = dynamic_cast<const eudaq::DetectorEvent *>(&bore)) {
+            eudaq::PluginManager::Initialize(*dev);
+          }
+        }
+        unsigned nshown = 0;
+        for (size_t n = 0; n < displaynumbers.size(); ++n) {
+          // like ndata below, -d counts the data events in the file from 1
+          if (displaynumbers[n] == 0 || !reader.SeekData(displaynumbers[n] - 1)) {
+            EUDAQ_WARN("No event " + to_string(displaynumbers[n]));
+            continue;
+          }
+          if (DisplayEvent(displaynumbers[n], reader.GetEvent(), do_proc.IsSet(), do_zs.IsSet(), do_dump.IsSet())) ++nshown;
+        }
+        EUDAQ_INFO("Displayed " + to_string(nshown) + " of " + to_string(displaynumbers.size()) + " events");
+        continue;
+      }
+
       unsigned ndata = 0, ndatalast = 0, nnondet = 0, nbore = 0, neore = 0;
 
       do {
@@ -177,6 +217,14 @@ int main(int /*argc*/, char ** argv) {
             } else {
               if (showlast) lastevent = std::shared_ptr<eudaq::Event>(new eudaq::StandardEvent(*sev));
             }
+          } else if (const eudaq::CompactStandardEvent * cev = dynamic_cast<const eudaq::CompactStandardEvent *>(&ev)) {
+            bool show = std::find(displaynumbers.begin(), displaynumbers.end(), ndata) != displaynumbers.end();
+            if (show) {
+              std::cout << *cev << std::endl;
+              shown = true;
+            } else {
+              if (showlast) lastevent = std::shared_ptr<eudaq::Event>(new eudaq::CompactStandardEvent(*cev));
+            }
           }
         }
 
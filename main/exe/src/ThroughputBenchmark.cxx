@@ -0,0 +1,476 @@
+#include "eudaq/OptionParser.hh"
+#include "eudaq/RunControl.hh"
+#include "eudaq/DataCollector.hh"
+#include "eudaq/Producer.hh"
+#include "eudaq/RawDataEvent.hh"
+#include "eudaq/StandardEvent.hh"
+#include "eudaq/BufferSerializer.hh"
+#include "eudaq/Configuration.hh"
+#include "eudaq/Instrumentation.hh"
+#include "eudaq/Logger.hh"
+#include "eudaq/MemoryPool.hh"
+#include "eudaq/Utils.hh"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <vector>
+#include <ctime>
+
+using eudaq::to_string;
+using eudaq::Instrumentation;
+
+namespace {
+
+  typedef std::chrono::steady_clock clock_type;
+
+  double Seconds(clock_type::duration d) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(d)
+        .count();
+  }
+
+  double CPUSeconds() { return std::clock() / double(CLOCKS_PER_SEC); }
+
+  /** The events a synthetic producer sends, set in its configuration
+   *  section: "EventType" (raw or standard), "EventSize" (bytes of random
+   *  data in a RawDataEvent), "Planes", "Width", "Height" and "Occupancy"
+   *  (fraction of hit pixels per StandardPlane), and "Rate" (events/s,
+   *  0 for as fast as possible).
+   */
+  struct EventShape {
+    EventShape()
+        : standard(false), size(1024), planes(6), width(1152), height(576),
+          occupancy(1e-4), rate(0) {}
+    explicit EventShape(const eudaq::Configuration &conf)
+        : standard(conf.Get("EventType", "raw") == "standard"),
+          size(conf.Get("EventSize", 1024)), planes(conf.Get("Planes", 6)),
+          width(conf.Get("Width", 1152)), height(conf.Get("Height", 576)),
+          occupancy(conf.Get("Occupancy", 1e-4)),
+          rate(conf.Get("Rate", 0.0)) {}
+    unsigned HitsPerPlane() const {
+      return (unsigned)(occupancy * width * height + 0.5);
+    }
+    bool standard;
+    unsigned size, planes, width, height;
+    double occupancy, rate;
+  };
+
+  /** Builds the events of a shape from a fixed pool of random numbers,
+   *  so that generating them costs little compared to sending them.
+   */
+  class EventGenerator {
+  public:
+    EventGenerator(const EventShape &shape, unsigned seed)
+        : m_shape(shape), m_pool(1 << 18), m_pos(0) {
+      std::mt19937 rng(seed);
+      for (size_t i = 0; i < m_pool.size(); ++i)
+        m_pool[i] = rng();
+    }
+    std::unique_ptr<eudaq::Event> Make(unsigned run, unsigned ev) {
+      if (!m_shape.standard) {
+        std::unique_ptr<eudaq::RawDataEvent> raw(
+            new eudaq::RawDataEvent("Bench", run, ev));
+        size_t words = (m_shape.size + 3) / 4;
+        raw->AddBlock(0, Next(words), m_shape.size);
+        return raw;
+      }
+      std::unique_ptr<eudaq::StandardEvent> sev(
+          new eudaq::StandardEvent(run, ev));
+      unsigned hits = m_shape.HitsPerPlane();
+      for (unsigned p = 0; p < m_shape.planes; ++p) {
+        eudaq::StandardPlane plane(p, "Bench", "Bench");
+        plane.SetSizeZS(m_shape.width, m_shape.height, hits);
+        const uint32_t *r = Next(hits);
+        for (unsigned i = 0; i < hits; ++i)
+          plane.SetPixel(i, (r[i] & 0xffff) % m_shape.width,
+                         (r[i] >> 16) % m_shape.height, 1);
+        sev->AddPlane(plane);
+      }
+      return sev;
+    }
+    /// The size of the serialized events (all events of a shape have it),
+    /// including the send time stamp
+    size_t SerializedSize() {
+      eudaq::BufferSerializer ser;
+      std::unique_ptr<eudaq::Event> ev = Make(0, 0);
+      ev->SetFastTag(eudaq::Event::FTAG_SENDTIME, 0);
+      ev->Serialize(ser);
+      return ser.size();
+    }
+
+  private:
+    const uint32_t *Next(size_t n) {
+      if (n > m_pool.size())
+        m_pool.resize(n);
+      if (m_pos + n > m_pool.size())
+        m_pos = 0;
+      const uint32_t *p = &m_pool[m_pos];
+      m_pos = (m_pos + n * 7 + 1) % (m_pool.size() - n + 1);
+      return p;
+    }
+    EventShape m_shape;
+    std::vector<uint32_t> m_pool;
+    size_t m_pos;
+  };
+
+  /** A producer sending synthetic events from its own thread while a run
+   *  is active.
+   */
+  class BenchProducer : public eudaq::Producer {
+  public:
+    BenchProducer(const std::string &name, const std::string &runcontrol,
+                  unsigned seed)
+        : eudaq::Producer(name, runcontrol), m_seed(seed), m_run(0), m_ev(0),
+          m_running(false), m_done(false), m_sent(0) {}
+    ~BenchProducer() { Stop(); }
+    virtual void OnConfigure(const eudaq::Configuration &conf) {
+      m_shape = EventShape(conf);
+      SetStatus(eudaq::Status::LVL_OK, "Configured (" + conf.Name() + ")");
+    }
+    virtual void OnStartRun(unsigned run) {
+      Stop();
+      m_run = run;
+      m_ev = 0;
+      SendEvent(eudaq::RawDataEvent::BORE("Bench", m_run));
+      m_running = true;
+      m_thread.reset(new std::thread(&BenchProducer::Generate, this));
+      SetStatus(eudaq::Status::LVL_OK, "");
+    }
+    virtual void OnStopRun() {
+      Stop();
+      SendEvent(eudaq::RawDataEvent::EORE("Bench", m_run, ++m_ev));
+    }
+    virtual void OnTerminate() { m_done = true; }
+    bool Done() const { return m_done; }
+    uint64_t Sent() const { return m_sent; }
+
+  private:
+    void Stop() {
+      m_running = false;
+      if (m_thread) {
+        m_thread->join();
+        m_thread.reset();
+      }
+    }
+    void Generate() {
+      // generating and serializing the events is counted as well
+      Instrumentation::SetThreadStage(eudaq::STAGE_SEND);
+      EventGenerator gen(m_shape, m_seed);
+      clock_type::time_point next = clock_type::now();
+      clock_type::duration period(0);
+      if (m_shape.rate > 0)
+        period = std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double>(1.0 / m_shape.rate));
+      while (m_running) {
+        if (period.count()) {
+          next += period;
+          std::this_thread::sleep_until(next);
+        }
+        std::unique_ptr<eudaq::Event> ev = gen.Make(m_run, ++m_ev);
+        // for the end-to-end latency (STAGE_TOTAL) at the collector
+        ev->SetFastTag(eudaq::Event::FTAG_SENDTIME, Instrumentation::Now());
+        SendEvent(*ev);
+        ++m_sent;
+      }
+    }
+    unsigned m_seed;
+    EventShape m_shape;
+    unsigned m_run, m_ev;
+    std::atomic<bool> m_running, m_done;
+    std::atomic<uint64_t> m_sent;
+    std::unique_ptr<std::thread> m_thread;
+  };
+
+  class BenchRunControl : public eudaq::RunControl {
+  public:
+    explicit BenchRunControl(const std::string &addr)
+        : eudaq::RunControl(addr) {}
+    bool DataCollectorReady() const { return !m_dataaddr.empty(); }
+    size_t NumProducers() const {
+      size_t n = 0;
+      for (size_t i = 0; i < NumConnections(); ++i) {
+        if (GetConnection(i).GetType() == "Producer" &&
+            GetConnection(i).GetState() > 0)
+          ++n;
+      }
+      return n;
+    }
+  };
+
+  std::string ProducerName(unsigned i) { return "Bench" + to_string(i); }
+
+  /// The CPU seconds used so far by the threads of each stage
+  std::vector<double> StageCPU() {
+    std::vector<double> cpu(eudaq::NUM_STAGES);
+    for (int i = 0; i < eudaq::NUM_STAGES; ++i)
+      cpu[i] = Instrumentation::ThreadCPU((eudaq::InstrumentationStage)i);
+    return cpu;
+  }
+
+  /** The statistics of the given stages. latency_sum_s is the sum of the
+   *  latencies, which includes waiting in the queues for RECEIVE and BUILD;
+   *  cpu_s is the CPU time, since cpu0 (from StageCPU), of the threads
+   *  working on the stage, where there are any in this process.
+   */
+  std::string JsonStages(int first, int last, const std::vector<double> &cpu0) {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(3) << "{";
+    bool sep = false;
+    for (int i = first; i <= last; ++i) {
+      eudaq::InstrumentationStage stage = (eudaq::InstrumentationStage)i;
+      eudaq::LatencyHistogram::Snapshot snap =
+          Instrumentation::Get(stage).Snap();
+      if (!snap.count)
+        continue;
+      s << (sep ? ", " : "") << "\"" << Instrumentation::StageName(stage)
+        << "\": {\"count\": " << snap.count
+        << ", \"p50_us\": " << snap.Percentile(0.5) / 1e3
+        << ", \"p99_us\": " << snap.Percentile(0.99) / 1e3
+        << ", \"max_us\": " << snap.max / 1e3
+        << ", \"latency_sum_s\": " << snap.sum / 1e9;
+      double cpu = Instrumentation::ThreadCPU(stage) - cpu0[i];
+      if (cpu > 0)
+        s << ", \"cpu_s\": " << cpu;
+      s << "}";
+      sep = true;
+    }
+    s << "}";
+    return s.str();
+  }
+
+  void Output(const std::string &json, const std::string &filename) {
+    if (filename == "") {
+      std::cout << json << std::endl;
+      return;
+    }
+    std::ofstream file(filename.c_str(), std::ios::app);
+    if (!file)
+      EUDAQ_THROW("Unable to open " + filename);
+    file << json << std::endl;
+  }
+
+  struct Settings {
+    unsigned producers;
+    std::string config, writers, datadir, output;
+    double duration;
+  };
+
+  /** Runs the collector side: the RunControl and a DataCollector, once for
+   *  each writer, and reports the sustained rate of built events.
+   */
+  void RunCollector(const Settings &set, const std::string &rcaddr,
+                    const std::string &dataaddr,
+                    std::vector<std::unique_ptr<BenchProducer>> &local) {
+    std::string port(rcaddr, rcaddr.rfind(':') + 1);
+    BenchRunControl rc("tcp://" + port);
+    eudaq::DataCollector dc("", "tcp://localhost:" + port, dataaddr,
+                            set.datadir + "/benchrun.dat");
+    // producers connecting while the RunControl initialises the data
+    // collector would not get an answer
+    while (!rc.DataCollectorReady())
+      eudaq::mSleep(100);
+    eudaq::mSleep(500);
+    for (unsigned i = 0; i < local.size(); ++i)
+      local[i].reset(new BenchProducer(ProducerName(i),
+                                       "tcp://localhost:" + port, i + 1));
+    std::cerr << "Waiting for " << set.producers << " producers" << std::endl;
+    while (rc.NumProducers() < set.producers)
+      eudaq::mSleep(100);
+    eudaq::mSleep(1000); // let them connect to the data collector
+
+    // the size of the sub-events each producer sends, for the data rate
+    std::vector<std::string> writers = eudaq::split(set.writers, ",");
+    for (size_t w = 0; w < writers.size(); ++w) {
+      eudaq::Configuration conf(set.config);
+      conf.SetSection("DataCollector");
+      conf.Set("FileType", writers[w]);
+      conf.Set("FilePattern", set.datadir + "/bench$6R$X");
+      size_t evbytes = 0;
+      for (unsigned i = 0; i < set.producers; ++i) {
+        conf.SetSection("Producer." + ProducerName(i));
+        evbytes += EventGenerator(EventShape(conf), i + 1).SerializedSize();
+      }
+      rc.Configure(conf);
+      eudaq::mSleep(1000);
+      Instrumentation::Reset();
+      double cpu0 = CPUSeconds();
+      std::vector<double> stagecpu0 = StageCPU();
+      uint64_t misses0 = eudaq::MemoryPool::NumMisses();
+      rc.StartRun("benchmark");
+
+      // sample the number of written events, the rate is taken between the
+      // first and the last change
+      eudaq::LatencyHistogram &written =
+          Instrumentation::Get(eudaq::STAGE_WRITE);
+      clock_type::time_point start = clock_type::now(), first, last;
+      uint64_t n0 = 0, n1 = 0, prev = 0;
+      bool stopping = false;
+      for (;;) {
+        eudaq::mSleep(10);
+        clock_type::time_point now = clock_type::now();
+        uint64_t n = written.Snap().count;
+        if (n != prev) {
+          if (!n0) {
+            n0 = n;
+            first = now;
+          }
+          n1 = n;
+          last = now;
+          prev = n;
+        }
+        if (!stopping && n0 && Seconds(now - first) >= set.duration) {
+          rc.StopRun();
+          stopping = true;
+        } else if (stopping && Seconds(now - last) > 2) {
+          break; // drained
+        } else if (!n0 && Seconds(now - start) > 30 + set.duration) {
+          EUDAQ_THROW("No events were written");
+        }
+      }
+      double cpu = CPUSeconds() - cpu0;
+      double dt = Seconds(last - first);
+      double rate = dt > 0 ? (n1 - n0) / dt : 0;
+      eudaq::LatencyHistogram::Snapshot total =
+          Instrumentation::Get(eudaq::STAGE_TOTAL).Snap();
+      std::ostringstream s;
+      s << std::fixed << std::setprecision(3) << "{\"benchmark\": \"throughput\""
+        << ", \"writer\": \"" << writers[w] << "\""
+        << ", \"producers\": " << set.producers
+        << ", \"event_bytes\": " << evbytes << ", \"events\": " << n1
+        << ", \"seconds\": " << dt << ", \"events_per_s\": " << rate
+        << ", \"mb_per_s\": " << rate * evbytes / 1e6
+        << ", \"latency_p50_us\": " << total.Percentile(0.5) / 1e3
+        << ", \"latency_p99_us\": " << total.Percentile(0.99) / 1e3
+        << ", \"cpu_s\": " << cpu << ", \"pool_misses\": "
+        << eudaq::MemoryPool::NumMisses() - misses0 << ", \"stages\": "
+        << JsonStages(local.empty() ? eudaq::STAGE_RECEIVE
+                                    : eudaq::STAGE_SERIALIZE,
+                      eudaq::NUM_STAGES - 1, stagecpu0)
+        << "}";
+      Output(s.str(), set.output);
+      eudaq::mSleep(1000);
+    }
+    if (local.empty()) {
+      rc.Terminate();
+    } else {
+      local.clear();
+    }
+  }
+
+  /// Runs producers for a collector in another process until terminated
+  void RunProducers(const Settings &set, const std::string &rcaddr,
+                    unsigned firstid) {
+    std::vector<std::unique_ptr<BenchProducer>> producers;
+    for (unsigned i = 0; i < set.producers; ++i)
+      producers.push_back(std::unique_ptr<BenchProducer>(new BenchProducer(
+          ProducerName(firstid + i), rcaddr, firstid + i + 1)));
+    double cpu0 = CPUSeconds();
+    std::vector<double> stagecpu0 = StageCPU();
+    bool done = false;
+    while (!done) {
+      eudaq::mSleep(100);
+      done = true;
+      for (size_t i = 0; i < producers.size(); ++i)
+        done = done && producers[i]->Done();
+    }
+    uint64_t sent = 0;
+    for (size_t i = 0; i < producers.size(); ++i)
+      sent += producers[i]->Sent();
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(3)
+      << "{\"benchmark\": \"throughput-producers\", \"producers\": "
+      << set.producers << ", \"events\": " << sent
+      << ", \"cpu_s\": " << CPUSeconds() - cpu0 << ", \"stages\": "
+      << JsonStages(eudaq::STAGE_SERIALIZE, eudaq::STAGE_SEND, stagecpu0)
+      << "}";
+    Output(s.str(), set.output);
+  }
+}
+
+int main(int /*argc*/, char **argv) {
+  eudaq::OptionParser op(
+      "EUDAQ Throughput Benchmark", "1.0",
+      "Runs synthetic producers against a DataCollector and reports the "
+      "sustained event and data rates, the latencies of the data path stages "
+      "and from sending to writing (latency_p50_us, latency_p99_us; only "
+      "when the producers run on the same host) and the CPU time used, as one JSON object per writer. By default "
+      "everything runs in one process; with -m collector and -m producer "
+      "the producers can run in other processes or on other hosts.");
+  eudaq::Option<std::string> mode(op, "m", "mode", "all", "mode",
+      "all, collector (RunControl and DataCollector) or producer");
+  eudaq::Option<unsigned> nprod(op, "p", "producers", 2, "num",
+      "Number of producers (in this process for producer mode)");
+  eudaq::Option<unsigned> firstid(op, "i", "first-id", 0, "num",
+      "Number of the first producer in producer mode");
+  eudaq::Option<std::string> type(op, "t", "type", "raw", "type",
+      "Events to send: raw (random data blocks) or standard (hit planes)");
+  eudaq::Option<unsigned> size(op, "s", "size", 1024, "bytes",
+      "Size of the raw data events");
+  eudaq::Option<double> occupancy(op, "o", "occupancy", 1e-4, "fraction",
+      "Fraction of hit pixels in the standard events");
+  eudaq::Option<double> rate(op, "R", "rate", 0, "Hz",
+      "Events per second and producer (0 = as fast as possible)");
+  eudaq::Option<std::string> writers(op, "w", "writers", "null,native",
+      "types", "Comma separated file writers to measure");
+  eudaq::Option<double> duration(op, "d", "duration", 10, "seconds",
+      "Duration of each measurement");
+  eudaq::Option<std::string> conffile(op, "c", "config", "", "file",
+      "Configuration file with further settings (overrides the options)");
+  eudaq::Option<std::string> rcaddr(op, "a", "runcontrol",
+      "tcp://localhost:44100", "address",
+      "Address of the RunControl (it listens on this port)");
+  eudaq::Option<std::string> dataaddr(op, "D", "data-address", "tcp://44101",
+      "address", "Listen address of the DataCollector");
+  eudaq::Option<std::string> datadir(op, "f", "data-dir", ".", "directory",
+      "Directory for the files written and the run number file");
+  eudaq::Option<std::string> output(op, "O", "output", "", "file",
+      "Append the results to this file instead of printing them");
+  eudaq::Option<std::string> level(op, "l", "log-level", "NONE", "level",
+      "The minimum level for displaying log messages locally");
+  try {
+    op.Parse(argv);
+    EUDAQ_LOG_LEVEL(level.Value());
+    Settings set;
+    set.producers = nprod.Value();
+    set.writers = writers.Value();
+    set.datadir = datadir.Value();
+    set.output = output.Value();
+    set.duration = duration.Value();
+
+    // the producer settings from the options, then from the file
+    std::ostringstream conf;
+    for (unsigned i = 0; i < set.producers + firstid.Value(); ++i)
+      conf << "[Producer." << ProducerName(i) << "]\n"
+           << "EventType = " << type.Value() << "\n"
+           << "EventSize = " << size.Value() << "\n"
+           << "Occupancy = " << occupancy.Value() << "\n"
+           << "Rate = " << rate.Value() << "\n";
+    set.config = conf.str();
+    if (conffile.Value() != "") {
+      std::ifstream file(conffile.Value().c_str());
+      if (!file)
+        EUDAQ_THROW("Unable to open " + conffile.Value());
+      set.config += std::string(std::istreambuf_iterator<char>(file),
+                                std::istreambuf_iterator<char>());
+    }
+
+    if (mode.Value() == "producer") {
+      RunProducers(set, rcaddr.Value(), firstid.Value());
+    } else if (mode.Value() == "all" || mode.Value() == "collector") {
+      std::vector<std::unique_ptr<BenchProducer>> local(
+          mode.Value() == "all" ? set.producers : 0);
+      RunCollector(set, rcaddr.Value(), dataaddr.Value(), local);
+    } else {
+      EUDAQ_THROW("Unknown mode: " + mode.Value());
+    }
+  } catch (...) {
+    return op.HandleMainException();
+  }
+  return 0;
+}
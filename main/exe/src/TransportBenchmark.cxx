@@ -0,0 +1,118 @@
+#include "eudaq/OptionParser.hh"
+#include "eudaq/TransportFactory.hh"
+#include "eudaq/Timer.hh"
+#include "eudaq/Utils.hh"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <ctime>
+#if EUDAQ_PLATFORM_IS(LINUX) || EUDAQ_PLATFORM_IS(MACOSX)
+#include <time.h>
+#endif
+
+using eudaq::to_string;
+
+namespace {
+
+  // CPU time used by the calling thread only, so that the client threads do
+  // not count towards the server cost
+  double ThreadCPUSeconds() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#else
+    return std::clock() / double(CLOCKS_PER_SEC);
+#endif
+  }
+
+  class Counter {
+  public:
+    Counter() : connections(0), packets(0), bytes(0) {}
+    void Handler(eudaq::TransportEvent &ev) {
+      if (ev.etype == eudaq::TransportEvent::CONNECT) {
+        ev.id.SetState(1);
+        ++connections;
+      } else if (ev.etype == eudaq::TransportEvent::RECEIVE) {
+        ++packets;
+        bytes += ev.packet.size();
+      }
+    }
+    unsigned connections;
+    uint64_t packets, bytes;
+  };
+
+  void Client(const std::string &address, unsigned events, unsigned size,
+              std::atomic<bool> *go) {
+    std::unique_ptr<eudaq::TransportClient> client(
+        eudaq::TransportFactory::CreateClient(address));
+    std::vector<unsigned char> data(size, 0xAB);
+    while (!*go)
+      eudaq::mSleep(1);
+    for (unsigned i = 0; i < events; ++i) {
+      client->SendPacket(&data[0], data.size());
+    }
+  }
+}
+
+int main(int /*argc*/, char ** argv) {
+  eudaq::OptionParser op("EUDAQ Transport Benchmark", "1.0",
+      "Connects several loopback clients to a transport server and measures "
+      "the server CPU time needed to receive their packets");
+  eudaq::Option<std::string> proto(op, "t", "transport", "tcp", "name",
+      "The server transport to use (e.g. tcp or epoll)");
+  eudaq::Option<unsigned> port(op, "p", "port", 44100, "port",
+      "The port to listen on");
+  eudaq::Option<unsigned> nclients(op, "c", "clients", 64, "num",
+      "Number of clients");
+  eudaq::Option<unsigned> nevents(op, "n", "events", 2000, "num",
+      "Number of packets sent by each client");
+  eudaq::Option<unsigned> size(op, "s", "size", 10000, "bytes",
+      "Size of each packet");
+  try {
+    op.Parse(argv);
+    std::unique_ptr<eudaq::TransportServer> server(
+        eudaq::TransportFactory::CreateServer(proto.Value() + "://" + to_string(port.Value())));
+    Counter counter;
+    server->SetCallback(eudaq::TransportCallback(&counter, &Counter::Handler));
+
+    std::string address = proto.Value() + "://localhost:" + to_string(port.Value());
+    std::atomic<bool> go(false);
+    std::vector<std::thread> clients;
+    for (unsigned i = 0; i < nclients.Value(); ++i) {
+      // connect one at a time so as not to overflow the listen backlog
+      clients.push_back(std::thread(Client, address, nevents.Value(), size.Value(), &go));
+      while (counter.connections <= i) {
+        server->Process(10000);
+      }
+    }
+
+    uint64_t expected = uint64_t(nclients.Value()) * nevents.Value();
+    eudaq::Timer timer;
+    double cpu0 = ThreadCPUSeconds();
+    go = true;
+    while (counter.packets < expected && timer.Seconds() < 60) {
+      server->Process(100000);
+    }
+    double cpu = ThreadCPUSeconds() - cpu0;
+    double wall = timer.Seconds();
+    for (size_t i = 0; i < clients.size(); ++i) {
+      clients[i].join();
+    }
+
+    std::cout << "Transport:   " << proto.Value() << " (" << nclients.Value() << " clients)\n"
+              << "Packets:     " << counter.packets << " of " << expected << "\n"
+              << "Wall time:   " << wall << " s, " << counter.bytes / wall / 1e6 << " MB/s\n"
+              << "Server CPU:  " << cpu << " s, " << 1e6 * cpu / counter.packets << " us/packet"
+              << std::endl;
+    if (counter.packets != expected) {
+      throw eudaq::MessageException("Not all packets were received");
+    }
+  } catch (...) {
+    return op.HandleMainException();
+  }
+  return 0;
+}
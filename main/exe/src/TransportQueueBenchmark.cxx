@@ -0,0 +1,169 @@
+#include "eudaq/OptionParser.hh"
+#include "eudaq/TransportBase.hh"
+#include "eudaq/Mutex.hh"
+#include "eudaq/Timer.hh"
+#include "eudaq/Utils.hh"
+
+#include <iostream>
+#include <iomanip>
+#include <queue>
+#include <vector>
+
+namespace {
+
+  // The event delivery of TransportBase before the lock-free queue: a mutex
+  // protected std::queue holding a copy of every packet, handed to a heap
+  // allocated, virtual callback helper.
+  namespace old {
+    struct Event {
+      Event(eudaq::TransportEvent::EventType et, eudaq::ConnectionInfo &i,
+            const std::string &p = "")
+          : etype(et), id(i), packet(p) {}
+      eudaq::TransportEvent::EventType etype;
+      eudaq::ConnectionInfo &id;
+      std::string packet;
+    };
+    struct Helper {
+      virtual void call(Event &) = 0;
+      virtual ~Helper() {}
+    };
+    template <typename T> struct HelperMember : public Helper {
+      HelperMember(T *obj, void (T::*func)(Event &)) : m_obj(obj), m_func(func) {}
+      virtual void call(Event &ev) { (m_obj->*m_func)(ev); }
+      T *m_obj;
+      void (T::*m_func)(Event &);
+    };
+    // As TransportBase was: packets are queued with m_mutex held (by
+    // Process around ProcessEvents) and copied out of the queue
+    class Transport {
+    public:
+      explicit Transport(Helper *cb) : m_callback(cb) {}
+      void Push(eudaq::TransportEvent::EventType et, eudaq::ConnectionInfo &id,
+                const std::string &packet) {
+        eudaq::MutexLock m(m_mutex);
+        m_events.push(Event(et, id, packet));
+      }
+      void Process() {
+        for (;;) {
+          eudaq::MutexLock m(m_mutex);
+          if (m_events.empty())
+            break;
+          Event evt(m_events.front());
+          m_events.pop();
+          m.Release();
+          m_callback->call(evt);
+        }
+      }
+
+    private:
+      std::queue<Event> m_events;
+      std::unique_ptr<Helper> m_callback;
+      eudaq::Mutex m_mutex;
+    };
+  }
+
+  // The event delivery of TransportBase
+  class Transport {
+  public:
+    explicit Transport(const eudaq::TransportCallback &cb) : m_callback(cb) {}
+    void Push(eudaq::TransportEvent::EventType et, eudaq::ConnectionInfo &id,
+              std::string &&packet) {
+      m_events.Push(et, id, std::move(packet));
+    }
+    void Process() {
+      eudaq::TransportEventQueue::Item item;
+      while (m_events.Pop(item)) {
+        eudaq::TransportEvent evt(item.etype, *item.id, std::move(item.packet));
+        m_callback(evt);
+      }
+    }
+
+  private:
+    eudaq::TransportEventQueue m_events;
+    eudaq::TransportCallback m_callback;
+  };
+
+  // Handlers doing as little as the real ones before they look at the data
+  struct Handler {
+    Handler() : packets(0), bytes(0) {}
+    void OnOld(old::Event &ev) { Count(ev.etype, ev.packet); }
+    void OnNew(eudaq::TransportEvent &ev) { Count(ev.etype, ev.packet); }
+    void Count(eudaq::TransportEvent::EventType et, const std::string &p) {
+      if (et == eudaq::TransportEvent::RECEIVE) {
+        ++packets;
+        bytes += p.size();
+      }
+    }
+    uint64_t packets, bytes;
+  };
+
+  struct Workload {
+    const char *name;
+    size_t size;  ///< Bytes per packet
+    size_t batch; ///< Packets received per call of ProcessEvents
+  };
+
+  // Receive packets in batches and handle them, as in TransportBase::Process.
+  // The packet is built from a receive buffer, like ConnectionInfoTCP does.
+  template <typename T>
+  double Run(T &transport, const Workload &w, uint64_t events) {
+    std::vector<char> buffer(w.size, 'x');
+    eudaq::ConnectionInfo conn("bench");
+    eudaq::Timer timer;
+    for (uint64_t n = 0; n < events; n += w.batch) {
+      for (size_t i = 0; i < w.batch; ++i) {
+        transport.Push(eudaq::TransportEvent::RECEIVE, conn,
+                       std::string(buffer.data(), buffer.size()));
+      }
+      transport.Process();
+    }
+    return timer.Seconds();
+  }
+}
+
+int main(int /*argc*/, char **argv) {
+  eudaq::OptionParser op("EUDAQ Transport Queue Benchmark", "1.0",
+      "Compares the delivery of received packets to the handlers through the "
+      "previous mutex+std::queue path and through the lock-free event queue, "
+      "for packet sizes typical of the command, log and data connections");
+  eudaq::Option<unsigned> nevents(op, "n", "events", 1000000, "num",
+      "Number of packets per workload");
+  eudaq::Option<unsigned> datasize(op, "s", "datasize", 65536, "bytes",
+      "Size of the data packets");
+  try {
+    op.Parse(argv);
+    const Workload workloads[] = {
+        {"CommandReceiver", 32, 1},
+        {"LogCollector", 256, 8},
+        {"DataCollector", datasize.Value(), 16}};
+    std::cout << std::left << std::setw(16) << "Loop" << std::right
+              << std::setw(10) << "bytes" << std::setw(14) << "old ns/pkt"
+              << std::setw(14) << "new ns/pkt" << std::setw(10) << "speedup"
+              << std::endl;
+    for (size_t i = 0; i < sizeof workloads / sizeof *workloads; ++i) {
+      const Workload &w = workloads[i];
+      // fewer large packets, so that each workload takes similar time
+      uint64_t events = std::max<uint64_t>(
+          1000, nevents.Value() / std::max<size_t>(1, w.size / 1024));
+      Handler hold, hnew;
+      old::Transport oldt(new old::HelperMember<Handler>(&hold, &Handler::OnOld));
+      Transport newt(eudaq::TransportCallback(&hnew, &Handler::OnNew));
+      Run(oldt, w, events / 10); // warm up
+      Run(newt, w, events / 10);
+      double told = Run(oldt, w, events);
+      double tnew = Run(newt, w, events);
+      if (hold.packets != hnew.packets || hold.bytes != hnew.bytes)
+        throw eudaq::MessageException("Packets lost in " +
+                                      std::string(w.name));
+      std::cout << std::left << std::setw(16) << w.name << std::right
+                << std::setw(10) << w.size << std::fixed
+                << std::setprecision(1) << std::setw(14)
+                << 1e9 * told / events << std::setw(14)
+                << 1e9 * tnew / events << std::setw(9)
+                << std::setprecision(2) << told / tnew << "x" << std::endl;
+    }
+  } catch (...) {
+    return op.HandleMainException();
+  }
+  return 0;
+}
@@ -0,0 +1,141 @@
+#ifndef EUDAQ_INCLUDED_BoundedQueue
+#define EUDAQ_INCLUDED_BoundedQueue
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstddef>
+
+namespace eudaq {
+
+  /** A bounded, lock-free, multi-producer/multi-consumer FIFO queue.
+   *  It is a ring of cells, each with its own sequence counter
+   *  (D. Vyukov's bounded MPMC queue), so that pushing and popping never
+   *  take a lock and never allocate. The capacity is rounded up to a power
+   *  of two. TryPush/TryPop fail immediately if the queue is full/empty;
+   *  Push/Pop wait (spinning, then sleeping briefly) until they succeed or
+   *  until the given flag is raised.
+   */
+  template <typename T> class BoundedQueue {
+  public:
+    explicit BoundedQueue(size_t capacity)
+        : m_cells(RoundUp(capacity)), m_mask(m_cells.size() - 1), m_head(0),
+          m_tail(0) {
+      for (size_t i = 0; i < m_cells.size(); ++i) {
+        m_cells[i].seq.store(i, std::memory_order_relaxed);
+      }
+    }
+
+    bool TryPush(T &&value) {
+      Cell *cell;
+      size_t pos = m_tail.load(std::memory_order_relaxed);
+      for (;;) {
+        cell = &m_cells[pos & m_mask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)pos;
+        if (dif == 0) {
+          if (m_tail.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+            break;
+        } else if (dif < 0) {
+          return false; // full
+        } else {
+          pos = m_tail.load(std::memory_order_relaxed);
+        }
+      }
+      cell->value = std::move(value);
+      cell->seq.store(pos + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool TryPop(T &value) {
+      Cell *cell;
+      size_t pos = m_head.load(std::memory_order_relaxed);
+      for (;;) {
+        cell = &m_cells[pos & m_mask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        std::ptrdiff_t dif = (std::ptrdiff_t)seq - (std::ptrdiff_t)(pos + 1);
+        if (dif == 0) {
+          if (m_head.compare_exchange_weak(pos, pos + 1,
+                                           std::memory_order_relaxed))
+            break;
+        } else if (dif < 0) {
+          return false; // empty
+        } else {
+          pos = m_head.load(std::memory_order_relaxed);
+        }
+      }
+      value = std::move(cell->value);
+      cell->value = T();
+      cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Push, waiting for free space; returns false if abort was raised
+    bool Push(T &&value, const std::atomic<bool> &abort) {
+      for (unsigned tries = 0; !TryPush(std::move(value)); ++tries) {
+        if (abort)
+          return false;
+        Backoff(tries);
+      }
+      return true;
+    }
+
+    /// Pop, waiting for data; returns false if abort was raised
+    bool Pop(T &value, const std::atomic<bool> &abort) {
+      for (unsigned tries = 0; !TryPop(value); ++tries) {
+        if (abort)
+          return false;
+        Backoff(tries);
+      }
+      return true;
+    }
+
+    /// Approximate number of queued elements
+    size_t Size() const {
+      size_t tail = m_tail.load(std::memory_order_relaxed);
+      size_t head = m_head.load(std::memory_order_relaxed);
+      return tail > head ? tail - head : 0;
+    }
+    size_t Capacity() const { return m_cells.size(); }
+    bool Empty() const { return Size() == 0; }
+
+    static void Backoff(unsigned tries) {
+      if (tries < 64) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+
+  private:
+    BoundedQueue(const BoundedQueue &);
+    BoundedQueue &operator=(const BoundedQueue &);
+
+    static size_t RoundUp(size_t n) {
+      size_t result = 2;
+      while (result < n)
+        result <<= 1;
+      return result;
+    }
+
+    struct Cell {
+      Cell() : seq(0) {}
+      Cell(const Cell &) : seq(0) {}
+      std::atomic<size_t> seq;
+      T value;
+    };
+
+    std::vector<Cell> m_cells;
+    const size_t m_mask;
+    // keep producer and consumer counters on separate cache lines
+    char m_pad0[64];
+    std::atomic<size_t> m_head;
+    char m_pad1[64];
+    std::atomic<size_t> m_tail;
+    char m_pad2[64];
+  };
+}
+
+#endif // EUDAQ_INCLUDED_BoundedQueue
@@ -4,6 +4,8 @@
 #include <deque>
 #include <algorithm>
 #include <iostream>
+#include <memory>
+#include <string>
 #include "eudaq/Serializer.hh"
 #include "eudaq/Exception.hh"
 
@@ -33,6 +35,75 @@ namespace eudaq {
     std::vector<unsigned char> m_data;
     size_t m_offset;
   };
+
+  /// A contiguous piece of memory making up part of a serialized object
+  struct BufferSegment {
+    BufferSegment(const unsigned char *d = 0, size_t s = 0)
+        : data(d), size(s) {}
+    const unsigned char *data;
+    size_t size;
+  };
+
+  /** A Serializer that avoids copying large pieces of data.
+   *  Everything is copied into an internal buffer, except chunks of at
+   *  least \c threshold bytes passed with append_reference() (e.g.
+   *  RawDataEvent blocks), which are only referenced. The result is a list
+   *  of segments that can be sent with a single scatter-gather call. The
+   *  serialized object must not be modified or destroyed while the segments
+   *  are in use.
+   */
+  class DLLEXPORT GatherSerializer : public Serializer {
+  public:
+    explicit GatherSerializer(size_t threshold = 4096)
+        : m_threshold(threshold), m_size(0) {}
+    void clear() {
+      m_data.clear();
+      m_pieces.clear();
+      m_size = 0;
+    }
+    /// Total number of serialized bytes
+    size_t size() const { return m_size; }
+    /// The serialized data as list of segments, in order
+    std::vector<BufferSegment> Segments() const;
+
+  private:
+    struct Piece {
+      const unsigned char *ref; ///< Referenced data, or 0 if owned
+      size_t offset, size;      ///< offset into m_data of owned data
+    };
+    virtual void Serialize(const unsigned char *data, size_t len);
+    virtual void SerializeReference(const unsigned char *data, size_t len);
+    size_t m_threshold, m_size;
+    std::vector<unsigned char> m_data;
+    std::vector<Piece> m_pieces;
+  };
+
+  /** A read-only Deserializer over a span of memory it does not own.
+   *  If an owner is given (e.g. the shared packet received from a Transport),
+   *  objects that support it may keep references into the span via
+   *  ReadReference() instead of copying their payload.
+   */
+  class DLLEXPORT BufferDeserializer : public Deserializer {
+  public:
+    BufferDeserializer(const unsigned char *data, size_t size,
+                       std::shared_ptr<const void> owner =
+                           std::shared_ptr<const void>())
+        : m_data(data), m_size(size), m_offset(0), m_owner(owner) {}
+    explicit BufferDeserializer(const std::shared_ptr<const std::string> &buf)
+        : m_data(reinterpret_cast<const unsigned char *>(buf->data())),
+          m_size(buf->size()), m_offset(0), m_owner(buf) {}
+    size_t size() const { return m_size; }
+    size_t remaining() const { return m_size - m_offset; }
+    virtual bool HasData() { return m_offset < m_size; }
+    virtual const unsigned char *
+    ReadReference(size_t len, std::shared_ptr<const void> &owner);
+
+  private:
+    virtual void Deserialize(unsigned char *data, size_t len);
+    const unsigned char *m_data;
+    size_t m_size, m_offset;
+    std::shared_ptr<const void> m_owner;
+  };
 }
 
 #endif // EUDAQ_INCLUDED_BufferSerializer
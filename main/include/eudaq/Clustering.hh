@@ -0,0 +1,78 @@
+#ifndef EUDAQ_INCLUDED_Clustering
+#define EUDAQ_INCLUDED_Clustering
+
+#include "eudaq/Platform.hh"
+#include <cstddef>
+#include <vector>
+
+namespace eudaq {
+
+  class StandardPlane;
+
+  /** Which hits belong to the same cluster.
+   */
+  struct DLLEXPORT ClusterOptions {
+    ClusterOptions()
+        : maxdx(1), maxdy(1), diagonal(true), separateframes(false) {}
+    int maxdx, maxdy; ///< Largest distance in x and y between neighbours
+    /// Whether hits that differ in both x and y can be neighbours, i.e.
+    /// 8- instead of 4-connectivity for maxdx = maxdy = 1
+    bool diagonal;
+    /// Only cluster hits of the same frame, otherwise frames are merged
+    bool separateframes;
+  };
+
+  /** One cluster of a plane.
+   */
+  struct DLLEXPORT PixelCluster {
+    PixelCluster()
+        : x(0), y(0), charge(0), npixels(0), frame(0), xmin(0), xmax(0),
+          ymin(0), ymax(0) {}
+    double x, y;    ///< Mean position of the hits
+    double charge;  ///< Sum of the pixel values
+    unsigned npixels, frame;
+    int xmin, xmax, ymin, ymax;
+  };
+
+  /** Groups hits into clusters of connected pixels.
+   *  The hits are swept in row order (sorting them first unless they are
+   *  already in that order, as for most readouts) and each one is joined
+   *  with its neighbours in the preceding rows in a union-find forest, so
+   *  the cost grows linearly with the number of hits and chains of hits
+   *  are merged correctly whatever their shape. The working memory is
+   *  kept between calls, so one clusterer should be reused per thread.
+   */
+  class DLLEXPORT PixelClusterer {
+  public:
+    explicit PixelClusterer(const ClusterOptions &opts = ClusterOptions())
+        : m_opts(opts) {}
+    const ClusterOptions &Options() const { return m_opts; }
+    void SetOptions(const ClusterOptions &opts) { m_opts = opts; }
+
+    /** Cluster n hits (frame may be null). Sets labels[i] to the cluster
+     *  of hit i, numbered from 0 in the order of their first hit, and
+     *  returns the number of clusters.
+     */
+    size_t Cluster(const int *x, const int *y, const int *frame, size_t n,
+                   std::vector<unsigned> &labels);
+    /// Cluster the hits of one frame of a plane
+    size_t Cluster(const StandardPlane &plane, unsigned frame,
+                   std::vector<unsigned> &labels);
+    /// Cluster a plane (all frames) and sum up the clusters
+    size_t Cluster(const StandardPlane &plane,
+                   std::vector<PixelCluster> &clusters);
+
+  private:
+    unsigned Find(unsigned i);
+    void Union(unsigned a, unsigned b);
+
+    ClusterOptions m_opts;
+    std::vector<unsigned> m_parent; ///< Union-find forest over the hits
+    std::vector<unsigned> m_order;  ///< Hits sorted by frame, y and x
+    std::vector<unsigned> m_roots;  ///< Cluster number of each root
+    std::vector<int> m_x, m_y, m_frame;
+    std::vector<double> m_pix;
+  };
+}
+
+#endif // EUDAQ_INCLUDED_Clustering
@@ -0,0 +1,110 @@
+#ifndef EUDAQ_INCLUDED_ColumnarFile
+#define EUDAQ_INCLUDED_ColumnarFile
+
+#include "eudaq/Compression.hh"
+#include "eudaq/StandardEvent.hh"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eudaq {
+
+  class Serializer;
+  class FileDeserializer;
+
+  /** The columns of a columnar hit file ("columnar" file writer, *.col).
+   *  The file holds chunks of consecutive events. In each chunk the event
+   *  numbers and timestamps are stored as one column each, and the hits of
+   *  every plane as separate columns, so a reader only has to read and
+   *  decode the planes and columns it needs. Integer columns are delta
+   *  and/or zigzag encoded and bit-packed, then compressed as a block.
+   */
+  enum ColumnarColumn {
+    COL_EVENTNUMBER = 0x1,
+    COL_TIMESTAMP = 0x2,
+    COL_HITS = 0x4, ///< Hits per event, gives ColumnarPlane offsets/present
+    COL_FRAME = 0x8,
+    COL_X = 0x10,
+    COL_Y = 0x20,
+    COL_VALUE = 0x40,
+    COL_ALL = 0x7f
+  };
+
+  /** The hits of one plane in one chunk of events.
+   *  The hits of event i are those from offsets[i] to offsets[i+1], and
+   *  present[i] tells whether the plane was in event i at all;
+   *  the vectors of columns that were not read are empty.
+   */
+  struct DLLEXPORT ColumnarPlane {
+    unsigned id;
+    std::string type, sensor;
+    unsigned xsize, ysize, frames, flags;
+    std::vector<uint32_t> offsets;
+    std::vector<bool> present;
+    std::vector<uint32_t> frame;
+    std::vector<double> x, y, value;
+  };
+
+  /** Collects StandardEvents and writes them as one chunk.
+   */
+  class DLLEXPORT ColumnarChunk {
+  public:
+    ColumnarChunk();
+    ~ColumnarChunk();
+    void AddEvent(const StandardEvent &ev);
+    size_t NumEvents() const { return m_eventnumbers.size(); }
+    /// Write the chunk and start a new one
+    void Write(Serializer &ser, CompressionCodec codec);
+    /// Write the file header
+    static void WriteHeader(Serializer &ser, unsigned runnumber);
+
+  private:
+    struct Plane;
+    Plane &GetPlane(const StandardPlane &p);
+    std::vector<uint64_t> m_eventnumbers, m_timestamps;
+    std::vector<std::unique_ptr<Plane>> m_planes;
+  };
+
+  /** Reads a columnar hit file chunk by chunk. Only the given columns
+   *  (a mask of ColumnarColumn) of the given planes (all if empty) are read
+   *  from the file; the others are skipped. COL_HITS is implied by any hit
+   *  column and the event numbers and timestamps are always read.
+   */
+  class DLLEXPORT ColumnarFileReader {
+  public:
+    ColumnarFileReader(const std::string &filename, int columns = COL_ALL,
+                       const std::vector<unsigned> &planes =
+                           std::vector<unsigned>());
+    ~ColumnarFileReader();
+    unsigned RunNumber() const { return m_runnumber; }
+    /// Read the next chunk, returns false at the end of the file
+    bool NextChunk();
+
+    size_t NumEvents() const { return m_eventnumbers.size(); }
+    unsigned GetEventNumber(size_t i) const {
+      return (unsigned)m_eventnumbers[i];
+    }
+    uint64_t GetTimestamp(size_t i) const { return m_timestamps[i]; }
+    size_t NumPlanes() const { return m_planes.size(); }
+    const ColumnarPlane &GetPlane(size_t i) const { return m_planes[i]; }
+    /// The plane with the given id in this chunk, or 0
+    const ColumnarPlane *FindPlane(unsigned id) const;
+    /** Event i of the chunk, with the planes and columns that were read.
+     *  Without COL_HITS every plane of the chunk is included, without hits.
+     */
+    StandardEvent GetStandardEvent(size_t i) const;
+    /// Bytes of column data read from the file so far
+    uint64_t BytesRead() const { return m_bytesread; }
+
+  private:
+    std::unique_ptr<FileDeserializer> m_des;
+    int m_columns;
+    std::vector<unsigned> m_planeids;
+    unsigned m_version, m_runnumber;
+    std::vector<uint64_t> m_eventnumbers, m_timestamps;
+    std::vector<ColumnarPlane> m_planes;
+    uint64_t m_bytesread;
+  };
+}
+
+#endif // EUDAQ_INCLUDED_ColumnarFile
@@ -0,0 +1,102 @@
+#ifndef EUDAQ_INCLUDED_CompactStandardEvent
+#define EUDAQ_INCLUDED_CompactStandardEvent
+
+#include "eudaq/StandardEvent.hh"
+#include <vector>
+#include <string>
+
+namespace eudaq {
+
+  /** A compact, structure-of-arrays copy of a StandardPlane.
+   *  The coordinates of all frames are stored in two flat uint16_t arrays
+   *  and the pixel values in a single array whose type is chosen to fit the
+   *  data (nothing at all for binary sensors), with one offset array per
+   *  quantity marking where each frame starts.
+   *  Converting to and from StandardPlane is lossless.
+   */
+  class DLLEXPORT CompactPlane : public Serializable {
+  public:
+    enum PixelType {
+      PIX_BINARY, ///< Every hit has the value 1, nothing is stored
+      PIX_UINT8,
+      PIX_UINT16,
+      PIX_INT32,
+      PIX_DOUBLE
+    };
+    CompactPlane();
+    explicit CompactPlane(const StandardPlane &);
+    CompactPlane(Deserializer &);
+    void Serialize(Serializer &) const;
+    StandardPlane ToStandard() const;
+
+    unsigned ID() const { return m_id; }
+    const std::string &Type() const { return m_type; }
+    const std::string &Sensor() const { return m_sensor; }
+    unsigned XSize() const { return m_xsize; }
+    unsigned YSize() const { return m_ysize; }
+    unsigned TLUEvent() const { return m_tluevent; }
+    unsigned PivotPixel() const { return m_pivotpixel; }
+    int GetFlags(int f) const { return m_flags & f; }
+    PixelType GetPixelType() const { return (PixelType)m_pixtype; }
+    unsigned NumFrames() const { return (unsigned)m_pixoffsets.size() - 1; }
+    unsigned HitPixels(unsigned frame = 0) const;
+
+    /** The raw values of one frame, as StandardPlane::GetX(index, frame)
+     *  etc. For CDS or pivot processed values use ToStandard().
+     */
+    double GetX(unsigned index, unsigned frame = 0) const;
+    double GetY(unsigned index, unsigned frame = 0) const;
+    double GetPixel(unsigned index, unsigned frame = 0) const;
+    bool GetPivot(unsigned index, unsigned frame = 0) const;
+
+    void Print(std::ostream &) const;
+
+  private:
+    size_t CoordIndex(unsigned index, unsigned frame) const;
+
+    std::string m_type, m_sensor;
+    unsigned m_id, m_tluevent;
+    unsigned m_xsize, m_ysize;
+    unsigned m_flags, m_pivotpixel;
+    unsigned char m_pixtype;
+    bool m_widecoords; ///< Coordinates did not fit uint16_t, see m_xd/m_yd
+    std::vector<uint32_t> m_pixoffsets, m_coordoffsets, m_pivotoffsets;
+    std::vector<uint16_t> m_x, m_y;
+    std::vector<double> m_xd, m_yd;
+    std::vector<uint8_t> m_pix8;
+    std::vector<uint16_t> m_pix16;
+    std::vector<int32_t> m_pix32;
+    std::vector<double> m_pixd;
+    std::vector<uint8_t> m_pivot;
+    std::vector<unsigned> m_mat;
+  };
+
+  /** A StandardEvent stored with CompactPlanes. It has its own event type,
+   *  so files written with it (e.g. by the "standard:compact" writer) are
+   *  smaller and faster to read; ToStandard() gives back the StandardEvent.
+   */
+  class DLLEXPORT CompactStandardEvent : public Event {
+    EUDAQ_DECLARE_EVENT(CompactStandardEvent);
+
+  public:
+    CompactStandardEvent(const StandardEvent &);
+    CompactStandardEvent(Deserializer &);
+    StandardEvent ToStandard() const;
+
+    size_t NumPlanes() const { return m_planes.size(); }
+    const CompactPlane &GetPlane(size_t i) const { return m_planes[i]; }
+    virtual void Serialize(Serializer &) const;
+    virtual void Print(std::ostream &) const;
+
+  private:
+    std::vector<CompactPlane> m_planes;
+  };
+
+  inline std::ostream &operator<<(std::ostream &os, const CompactPlane &pl) {
+    pl.Print(os);
+    return os;
+  }
+
+} // namespace eudaq
+
+#endif // EUDAQ_INCLUDED_CompactStandardEvent
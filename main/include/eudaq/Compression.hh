@@ -0,0 +1,45 @@
+#ifndef EUDAQ_INCLUDED_Compression
+#define EUDAQ_INCLUDED_Compression
+
+#include "eudaq/Platform.hh"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace eudaq {
+
+  /** General purpose compression of byte blocks, used by the file formats.
+   *  COMPRESS_FAST is a small built-in LZ77 codec in the spirit of LZ4 that
+   *  is always available; zlib and zstd are used when EUDAQ was built with
+   *  them. The codec id is stored in the files, so it must never change.
+   */
+  enum CompressionCodec {
+    COMPRESS_NONE = 0,
+    COMPRESS_FAST = 1,
+    COMPRESS_ZLIB = 2,
+    COMPRESS_ZSTD = 3
+  };
+
+  /// Whether this build can (de)compress with the codec
+  bool DLLEXPORT CompressionAvailable(CompressionCodec codec);
+  /// COMPRESS_FAST; zlib and zstd have to be asked for by name
+  CompressionCodec DLLEXPORT DefaultCompression();
+  /// Parse "none", "fast", "zlib" or "zstd" (empty means the default)
+  CompressionCodec DLLEXPORT CompressionFromName(const std::string &name);
+  std::string DLLEXPORT CompressionName(CompressionCodec codec);
+
+  /** Compress len bytes, replacing the contents of out.
+   *  Returns false, leaving out unspecified, if the result would not be
+   *  smaller than the input; the data should then be stored uncompressed.
+   */
+  bool DLLEXPORT Compress(CompressionCodec codec, const unsigned char *data,
+                          size_t len, std::vector<unsigned char> &out);
+
+  /** Decompress len bytes into exactly rawlen bytes at out.
+   *  Throws if the data is corrupt or the codec is not available.
+   */
+  void DLLEXPORT Decompress(CompressionCodec codec, const unsigned char *data,
+                            size_t len, unsigned char *out, size_t rawlen);
+}
+
+#endif // EUDAQ_INCLUDED_Compression
@@ -13,11 +13,44 @@
 #include "eudaq/Configuration.hh"
 #include "eudaq/Utils.hh"
 #include "eudaq/Platform.hh"
+#include "eudaq/BoundedQueue.hh"
+#include "eudaq/DetectorEvent.hh"
+#include "eudaq/MemoryPool.hh"
+#include "eudaq/SharedMemoryRing.hh"
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <map>
+#include <deque>
+#include <unordered_map>
 namespace eudaq {
 
   /** Implements the functionality of the File Writer application.
    *
+   *  Data taking is split into a pipeline of threads connected by bounded
+   *  lock-free queues, so that neither deserialization nor a slow disk
+   *  stall the reading of the sockets:
+   *   -# the receive thread runs the transport and queues raw packets,
+   *   -# a pool of workers deserializes them into Events,
+   *   -# the builder thread puts the packets back in receive order and
+   *      calls OnConnect/OnDisconnect/OnReceive/OnCompleteEvent,
+   *   -# the writer thread passes the built DetectorEvents to the FileWriter.
+   *
+   *  By default sub-events are combined in the order they arrive. At most
+   *  "MaxBufferedEvents" sub-events are kept per producer while waiting
+   *  for the others; further ones are dropped (and counted as DROPPED in
+   *  the status), so that one producer that stops sending cannot make the
+   *  others fill up the memory. With
+   *  "EventBuilding = trigger" in the configuration they are instead matched
+   *  by their TLU trigger ID: each producer gets a ring of "TriggerRingSize"
+   *  slots indexed by trigger ID, and triggers that are still incomplete
+   *  after "BuildTimeout" milliseconds (or whose slot is needed again) are
+   *  written without the missing sub-events.
+   *
+   *  With "SharedMemory = <name>" the writer thread also publishes every
+   *  built event in a SharedMemoryRing of "SharedMemorySlots" slots of
+   *  "SharedMemorySlotSize" bytes, from which monitors on the same host can
+   *  read them (see Monitor).
    */
   class DLLEXPORT DataCollector : public CommandReceiver {
   public:
@@ -38,31 +71,111 @@ namespace eudaq {
     virtual ~DataCollector();
 
     void DataThread();
+    void DeserializeThread();
+    void BuilderThread();
+    void WriterThread();
+
+  protected:
+    /// Pass a complete event on to the writer thread
+    void QueueForWriting(const std::shared_ptr<DetectorEvent> &ev);
 
   private:
     struct Info {
       std::shared_ptr<ConnectionInfo> id;
-      std::list<std::shared_ptr<Event>> events;
+      std::list<std::shared_ptr<Event>, PoolAllocator<std::shared_ptr<Event>>>
+          events;
+      std::vector<std::shared_ptr<Event>> ring; ///< Sub-events by trigger ID
+    };
+
+    /// State of one trigger ID in trigger-number event building
+    struct TriggerSlot {
+      TriggerSlot() : tid((unsigned)-1), count(0), done(true), arrival(0) {}
+      unsigned tid;
+      size_t count; ///< Number of producers that delivered this trigger
+      bool done;    ///< Already written (late sub-events are dropped)
+      Time arrival; ///< Arrival of the first sub-event
+    };
+
+    /// A transport event travelling through the pipeline
+    struct Item {
+      enum Type { NONE, CONNECT, DISCONNECT, RECEIVE };
+      Item() : type(NONE), seq(0), stamp(0) {}
+      Type type;
+      uint64_t seq;   ///< Position in receive order
+      uint64_t stamp; ///< Entry into the current stage, for Instrumentation
+      std::shared_ptr<ConnectionInfo> id;
+      std::shared_ptr<const std::string> packet;
+      std::shared_ptr<Event> event;
     };
 
     const std::string
         m_runnumberfile; // path to the file containing the run number
     void DataHandler(TransportEvent &ev);
     size_t GetInfo(const ConnectionInfo &id);
+    void QueueItem(Item::Type type, const ConnectionInfo &id,
+                   std::shared_ptr<const std::string> packet =
+                       std::shared_ptr<const std::string>());
+    void HandleItem(Item &item);
+    /// False (and an error status) if the pipeline did not drain in time
+    bool WaitForPipeline(const std::string &what);
+    unsigned TriggerID(const Event &ev) const;
+    void OnReceiveTriggered(size_t index, std::shared_ptr<Event> ev);
+    void EmitTrigger(size_t slot);
+    void FlushTriggers(bool all);
+    void ResetTriggers();
+    void FinishEvent(DetectorEvent &ev, bool &found_bore);
+    void ConfigureSharedMemory();
 
-    bool m_done, m_listening;
+    std::atomic<bool> m_done;
+    bool m_listening;
     TransportServer *m_dataserver; ///< Transport for receiving data packets
                                    //       pthread_t m_thread;
                                    //       pthread_attr_t m_threadattr;
     std::unique_ptr<std::thread> m_thread;
+    std::vector<std::unique_ptr<std::thread>> m_workers;
+    std::unique_ptr<std::thread> m_builderthread, m_writerthread;
+    BoundedQueue<Item> m_rxqueue;    ///< Packets waiting for deserialization
+    BoundedQueue<Item> m_buildqueue; ///< Events waiting for the builder
+    BoundedQueue<std::shared_ptr<DetectorEvent>>
+        m_writequeue; ///< Built events waiting for the writer
+    /// Clones of the identified connections, by transport connection
+    std::map<const ConnectionInfo *, std::shared_ptr<ConnectionInfo>> m_conns;
+    std::atomic<uint64_t> m_seqqueued; ///< Items queued by the receive thread
+    std::atomic<uint64_t> m_seqbuilt;  ///< Items handled by the builder
+    std::atomic<uint64_t> m_numqueued; ///< Events queued for writing
+    std::atomic<uint64_t> m_numwritten; ///< Events handled by the writer
+    std::mutex m_buildmutex;  ///< Protects the event building state
+    std::mutex m_writermutex; ///< Protects m_writer
     std::vector<Info> m_buffer;
+    /// Index into m_buffer of the connections passed to OnConnect
+    std::unordered_map<const ConnectionInfo *, size_t> m_infoidx;
+    std::atomic<bool> m_triggermode; ///< Build events by trigger ID
+    size_t m_ringsize;     ///< Number of trigger slots per producer
+    double m_buildtimeout; ///< Seconds before an incomplete event is written
+    std::vector<TriggerSlot> m_slots;
+    std::deque<std::pair<size_t, unsigned>,
+               PoolAllocator<std::pair<size_t, unsigned>>>
+        m_pendingslots; ///< Arrival order
+    std::atomic<uint64_t> m_numincomplete, m_numlate;
+    size_t m_maxbuffered; ///< Sub-events kept per producer in sequential mode
+    std::atomic<uint64_t> m_numdropped; ///< Dropped as the buffer was full
     size_t m_numwaiting; ///< The number of producers with events waiting in the
                          ///buffer
     size_t m_itlu;       ///< Index of TLU in m_buffer vector, or -1 if no TLU
-    unsigned m_runnumber, m_eventnumber;
+    unsigned m_runnumber;
+    std::atomic<unsigned> m_eventnumber; ///< Also read by OnStatus
     std::shared_ptr<FileWriter> m_writer;
+    std::unique_ptr<SharedMemoryRing> m_ring; ///< Protected by m_writermutex
     Configuration m_config;
     Time m_runstart;
+    /// Updated by the writer thread, for OnStatus
+    std::atomic<uint64_t> m_filebytes, m_filequeue;
+    /// MemoryPool::NumMisses() at the start of the run (the pool is shared
+    /// by the whole process and only holds events, their lists and the
+    /// queues, not packets or data blocks)
+    std::atomic<uint64_t> m_runpoolmisses;
+    uint64_t m_lastfilebytes; ///< For the file write rate in OnStatus
+    Time m_laststatus;
   };
 }
 
@@ -143,13 +143,18 @@ namespace eudaq {
       // same.
 
       // auto triggerID=ev.GetEventNumber();
-      unsigned triggerID = ev.GetTag<unsigned>("tlu_trigger_id", 0);
+      unsigned triggerID =
+          ev.HasFastTag(Event::FTAG_TRIGGERID)
+              ? (unsigned)ev.GetFastTag(Event::FTAG_TRIGGERID)
+              : ev.GetTag<unsigned>("tlu_trigger_id", 0); // older files
       auto tlu_triggerID = tlu.GetEventNumber();
       return compareTLU2DUT(tlu_triggerID, triggerID);
     }
 
     virtual void setCurrentTLUEvent(eudaq::Event &ev,
                                     eudaq::TLUEvent const &tlu) {
+      ev.SetFastTag(Event::FTAG_TRIGGERID, tlu.GetEventNumber());
+      // still read by converters and analysis code through the string tags
       ev.SetTag("tlu_trigger_id", tlu.GetEventNumber());
     }
     virtual void GetLCIORunHeader(lcio::LCRunHeader &, eudaq::Event const &,
@@ -169,6 +174,13 @@ namespace eudaq {
       return false;
     };
 
+    /** Returns whether GetStandardSubEvent may be called for different
+     *  events at the same time. Plugins that keep state between events
+     *  return false; the ParallelConverter then converts their sub-events
+     *  one at a time and in order.
+     */
+    virtual bool IsThreadSafe() const { return true; }
+
     /** Returns the type of event this plugin can convert to lcio as a pair of
      * Event type id and subtype string.
      */
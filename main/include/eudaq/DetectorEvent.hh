@@ -3,6 +3,7 @@
 
 #include <vector>
 #include "eudaq/TLUEvent.hh"
+#include "eudaq/MemoryPool.hh"
 #include <memory>
 
 namespace eudaq {
@@ -49,7 +50,8 @@ namespace eudaq {
     }
 
   private:
-    std::vector<std::shared_ptr<Event>> m_events;
+    std::vector<std::shared_ptr<Event>, PoolAllocator<std::shared_ptr<Event>>>
+        m_events;
   };
 }
 
@@ -12,6 +12,7 @@
 #include "eudaq/Exception.hh"
 #include "eudaq/Utils.hh"
 #include "eudaq/Platform.hh"
+#include "eudaq/MemoryPool.hh"
 
 #define EUDAQ_DECLARE_EVENT(type)                                              \
 public:                                                                        \
@@ -49,6 +50,17 @@ namespace eudaq {
       FLAG_STATUS = 256,
       FLAG_ALL = (unsigned)-1
     }; // Matches FLAGNAMES in .cc file
+    /** Ids of the numeric fast tags, see SetFastTag().
+     *  Ids below FTAG_USER are reserved for EUDAQ.
+     */
+    enum FastTagId {
+      FTAG_TRIGGERID = 1,
+      FTAG_FRAMECOUNT = 2,
+      FTAG_TIMESTAMP_BEGIN = 3,
+      FTAG_TIMESTAMP_END = 4,
+      FTAG_SENDTIME = 5, ///< Instrumentation::Now() when the event was sent
+      FTAG_USER = 256
+    }; // Matches FASTTAGNAMES in .cc file
     Event(unsigned run, unsigned event, uint64_t timestamp = NOTIMESTAMP,
           unsigned flags = 0)
         : m_flags(flags), m_runnumber(run), m_eventnumber(event),
@@ -56,6 +68,14 @@ namespace eudaq {
     Event(Deserializer &ds);
     virtual void Serialize(Serializer &) const = 0;
 
+    /// Events of all types are allocated from the MemoryPool
+    static void *operator new(size_t size) {
+      return MemoryPool::Allocate(size);
+    }
+    static void operator delete(void *p, size_t size) {
+      MemoryPool::Deallocate(p, size);
+    }
+
     unsigned GetRunNumber() const { return m_runnumber; }
     unsigned GetEventNumber() const { return m_eventnumber; }
     uint64_t GetTimestamp() const { return m_timestamp; }
@@ -80,6 +100,15 @@ namespace eudaq {
       return eudaq::from_string(GetTag(name), def);
     }
 
+    /** Fast tags hold well-known numeric metadata (trigger IDs, frame
+     *  counters, ...) without converting it to and from strings.
+     *  They are stored next to the string tags in a way that older
+     *  versions simply see as one more tag.
+     */
+    Event &SetFastTag(unsigned id, uint64_t val);
+    bool HasFastTag(unsigned id) const;
+    uint64_t GetFastTag(unsigned id, uint64_t def = 0) const;
+
     bool IsBORE() const { return GetFlags(FLAG_BORE) != 0; }
     bool IsEORE() const { return GetFlags(FLAG_EORE) != 0; }
     bool HasHits() const { return GetFlags(FLAG_HITS) != 0; }
@@ -101,6 +130,7 @@ namespace eudaq {
     unsigned m_flags, m_runnumber, m_eventnumber;
     uint64_t m_timestamp;
     map_t m_tags; ///< Metadata tags in (name=value) pairs of strings
+    std::vector<std::pair<unsigned, uint64_t>> m_fasttags; ///< Numeric tags
   };
 
   DLLEXPORT std::ostream &operator<<(std::ostream &, const Event &);
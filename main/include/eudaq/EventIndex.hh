@@ -0,0 +1,69 @@
+#ifndef EUDAQ_INCLUDED_EventIndex
+#define EUDAQ_INCLUDED_EventIndex
+
+#include "eudaq/Platform.hh"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+
+namespace eudaq {
+
+  class Event;
+  class Serializer;
+  class Deserializer;
+
+  /** Position of one event in a raw data file.
+   */
+  struct DLLEXPORT EventIndexEntry {
+    EventIndexEntry() : eventnumber(0), flags(0), offset(0), timestamp(0) {}
+    EventIndexEntry(const Event &ev, uint64_t offset);
+    void Serialize(Serializer &ser) const;
+    void Deserialize(Deserializer &ds);
+    unsigned eventnumber;
+    unsigned flags;
+    uint64_t offset; ///< Byte offset of the event in the raw file
+    uint64_t timestamp;
+  };
+
+  /** The index of a raw data file, mapping event numbers and timestamps to
+   *  byte offsets. The native file writers store it next to the raw file,
+   *  with ".idx" appended to its name (e.g. run000123.raw.idx): a version
+   *  tag followed by one fixed-size entry per event.
+   */
+  class DLLEXPORT EventIndex {
+  public:
+    EventIndex() : m_bore((size_t)-1), m_eore((size_t)-1), m_sorted(true) {}
+    /// Load the index file, returns false if it does not exist
+    bool Load(const std::string &filename);
+    void Add(const EventIndexEntry &entry);
+    size_t Size() const { return m_entries.size(); }
+    const EventIndexEntry &Entry(size_t i) const { return m_entries[i]; }
+    /// The data event (not BORE/EORE) with this number, or 0
+    const EventIndexEntry *FindEvent(unsigned eventnumber) const;
+    /// The first data event with a timestamp not earlier than ts, or 0
+    const EventIndexEntry *FindTimestamp(uint64_t ts) const;
+    /// The n-th data event in the file (counting from 0), or 0
+    const EventIndexEntry *DataEntry(size_t n) const;
+    /// The (first) BORE or EORE, or 0
+    const EventIndexEntry *FindBORE() const;
+    const EventIndexEntry *FindEORE() const;
+
+    static std::string IndexName(const std::string &rawfile) {
+      return rawfile + ".idx";
+    }
+    /// Start an index file; entries are then written with Append
+    static void WriteHeader(Serializer &ser);
+    static void Append(Serializer &ser, const Event &ev, uint64_t offset);
+
+  private:
+    std::vector<EventIndexEntry> m_entries;
+    std::unordered_map<unsigned, size_t> m_byevent;
+    std::vector<size_t> m_data; ///< Data entries in file order
+    size_t m_bore, m_eore;
+    mutable std::vector<size_t> m_bytime; ///< Data entries by timestamp
+    mutable bool m_sorted;
+  };
+}
+
+#endif // EUDAQ_INCLUDED_EventIndex
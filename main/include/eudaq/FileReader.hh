@@ -4,6 +4,7 @@
 #include "eudaq/FileSerializer.hh"
 #include "eudaq/DetectorEvent.hh"
 #include "eudaq/StandardEvent.hh"
+#include "eudaq/EventIndex.hh"
 
 #include <string>
 
@@ -13,11 +14,27 @@ namespace eudaq {
 
   class DLLEXPORT FileReader {
   public:
+    /** Open a raw data file. With mapped=true a complete (closed) file is
+     *  read through a memory mapping where the platform supports it;
+     *  otherwise the reader waits for data appended to a running file.
+     */
     FileReader(const std::string &filename,
-               const std::string &filepattern = "");
+               const std::string &filepattern = "", bool mapped = false);
 
     ~FileReader();
     bool NextEvent(size_t skip = 0);
+    /** Jump to the data event with the given number, or to the first one
+     *  recorded at or after the given timestamp, to the n-th data event in
+     *  the file (counting from 0), or to the BORE or EORE. These use the index
+     *  written next to the file, or scan the file once if there is none.
+     *  They return false (leaving the current event unchanged) if there is
+     *  no such event.
+     */
+    bool SeekEvent(unsigned eventnumber);
+    bool SeekTimestamp(uint64_t timestamp);
+    bool SeekData(size_t n);
+    bool SeekBORE();
+    bool SeekEORE();
     std::string Filename() const { return m_filename; }
     unsigned RunNumber() const;
     const eudaq::Event &GetEvent() const;
@@ -29,13 +46,17 @@ namespace eudaq {
     std::shared_ptr<eudaq::DetectorEvent> GetDetectorEvent_ptr() {
       return std::dynamic_pointer_cast<eudaq::DetectorEvent>(m_ev);
     };
-    void Interrupt() { m_des.Interrupt(); }
+    void Interrupt() { m_des->Interrupt(); }
 
   private:
+    static FileDeserializer *Open(const std::string &filename, bool mapped);
+    const EventIndex &Index();
+    bool SeekTo(const EventIndexEntry *entry);
     std::string m_filename;
-    FileDeserializer m_des;
+    std::unique_ptr<FileDeserializer> m_des;
     std::shared_ptr<eudaq::Event> m_ev;
     unsigned m_ver;
+    std::unique_ptr<EventIndex> m_index;
   };
 }
 
@@ -6,20 +6,153 @@
 #include "eudaq/Serializer.hh"
 #include "eudaq/Exception.hh"
 #include "eudaq/BufferSerializer.hh"
+#include "eudaq/Time.hh"
+#include "eudaq/Compression.hh"
 #include <memory>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 namespace eudaq {
   class Event;
   class DLLEXPORT FileSerializer : public Serializer {
   public:
     FileSerializer(const std::string &fname, bool overwrite = false);
     virtual void Flush();
+    /// Flush and wait until the data has reached the disk
+    virtual void Sync();
     uint64_t FileBytes() const { return m_filebytes; }
-    ~FileSerializer();
+    /// Bytes accepted by the serializer but not yet written to the file
+    virtual uint64_t PendingBytes() const { return 0; }
+    virtual ~FileSerializer();
+
+  protected:
+    FileSerializer();
+    uint64_t m_filebytes;
 
   private:
     virtual void Serialize(const unsigned char *data, size_t len);
     FILE *m_file;
-    uint64_t m_filebytes;
+  };
+
+  /** A FileSerializer that collects the data in large aligned buffers and
+   *  writes them from a separate I/O thread, so that the caller only blocks
+   *  when both buffers are full. Flush() hands the current buffer to the I/O
+   *  thread without waiting; Sync() waits for all data to be on disk.
+   *  With direct=true the file is opened with O_DIRECT (where available) and
+   *  only whole blocks are written until Sync() or destruction.
+   */
+  class DLLEXPORT AsyncFileSerializer : public FileSerializer {
+  public:
+    AsyncFileSerializer(const std::string &fname, size_t buffersize = 1 << 22,
+                        bool direct = false, bool overwrite = false);
+    virtual void Flush();
+    virtual void Sync();
+    virtual uint64_t PendingBytes() const;
+    virtual ~AsyncFileSerializer();
+
+  private:
+    virtual void Serialize(const unsigned char *data, size_t len);
+    void Submit(bool all);
+    void WaitIdle(std::unique_lock<std::mutex> &lock);
+    void IOThread();
+    int m_fd;
+    bool m_direct;
+    size_t m_capacity;
+    std::vector<unsigned char> m_mem[2];
+    unsigned char *m_buf[2];
+    int m_fill;          ///< Index of the buffer being filled
+    size_t m_used;       ///< Bytes used in the buffer being filled
+    size_t m_ioready;    ///< Bytes handed to the I/O thread, 0 if idle
+    bool m_stop;
+    std::string m_error; ///< Last write error of the I/O thread
+    std::atomic<uint64_t> m_written;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::thread m_thread;
+  };
+
+  /** A FileSerializer writing a block-compressed container: the data is cut
+   *  into frames of framesize bytes that are compressed independently by a
+   *  pool of worker threads and written in order by an I/O thread. A frame
+   *  index is appended when the file is closed, so that readers can seek
+   *  without decompressing the whole file (see CompressedFileDeserializer).
+   *  Flush() ends the current frame early, Sync() waits until all frames
+   *  are on disk. FileBytes() counts the uncompressed bytes, so that
+   *  offsets (e.g. in an EventIndex) refer to the uncompressed stream.
+   */
+  class DLLEXPORT CompressedFileSerializer : public FileSerializer {
+  public:
+    CompressedFileSerializer(const std::string &fname, CompressionCodec codec,
+                             size_t framesize = 1 << 21, unsigned threads = 0,
+                             bool overwrite = false);
+    virtual void Flush();
+    virtual void Sync();
+    virtual uint64_t PendingBytes() const;
+    virtual ~CompressedFileSerializer();
+
+  private:
+    struct Frame;
+    virtual void Serialize(const unsigned char *data, size_t len);
+    void Seal();
+    void WaitWritten(std::unique_lock<std::mutex> &lock);
+    void Worker();
+    void Writer();
+    void WriteIndex();
+    FILE *m_out;
+    CompressionCodec m_codec;
+    size_t m_framesize;
+    size_t m_maxframes; ///< Frames being compressed or waiting to be written
+    std::shared_ptr<Frame> m_current;
+    std::deque<std::shared_ptr<Frame>> m_frames;
+    std::vector<std::shared_ptr<Frame>> m_free;
+    std::vector<uint64_t> m_index; ///< Raw offset, file offset and raw size
+    uint64_t m_fileoffset;
+    bool m_stop;
+    std::string m_error; ///< Last write error of the I/O thread
+    std::atomic<uint64_t> m_written;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<std::thread> m_workers;
+    std::thread m_writer;
+  };
+
+  /** How a file writer buffers and flushes its output, parsed from the
+   *  parameters of the FileType, e.g. "native:async,flushms=500".
+   *  The comma separated options are:
+   *   - async:        write from a separate I/O thread
+   *   - direct:       bypass the page cache (implies async)
+   *   - buffer=N:     size of each of the two I/O buffers (e.g. 4M)
+   *   - flushbytes=N: flush after at least N bytes
+   *   - flushms=N:    flush at most N ms after the previous flush
+   *   - compress[=codec]: write a block-compressed file (see
+   *                   CompressedFileSerializer), with the given codec
+   *                   ("fast", "zlib", "zstd"; default "fast")
+   *   - frame=N:      uncompressed size of the compressed frames (e.g. 2M)
+   *   - threads=N:    number of compression threads (0: one per core)
+   *  Without async and without flush options every event is flushed;
+   *  with async or compress the default is to flush once per second.
+   */
+  class DLLEXPORT FlushPolicy {
+  public:
+    explicit FlushPolicy(const std::string &params = "");
+    /// Open a (possibly asynchronous) serializer according to the policy
+    FileSerializer *Open(const std::string &fname) const;
+    /// Whether the file should be flushed after reaching filebytes
+    bool FlushDue(uint64_t filebytes);
+
+    bool async, direct;
+    size_t buffersize;
+    CompressionCodec codec;
+    size_t framesize;
+    unsigned threads;
+    uint64_t flushbytes;
+    double flushseconds;
+
+  private:
+    uint64_t m_lastbytes;
+    Time m_lastflush;
   };
 
   class DLLEXPORT FileDeserializer : public Deserializer {
@@ -34,17 +167,88 @@ namespace eudaq {
       buf.read(result);
       return result;
     }
+    /** Read the next event, after skipping the given number of events.
+     *  Version 2 files are skipped without decoding the events.
+     */
     bool ReadEvent(int ver, std::shared_ptr<eudaq::Event> &ev, size_t skip = 0);
+    /// Skip the next len bytes without reading them
+    virtual void Skip(size_t len);
+    /// Offset of the read position from the start of the file
+    virtual uint64_t Position() const;
+    virtual void Seek(uint64_t pos);
+    virtual ~FileDeserializer();
+
+  protected:
+    FileDeserializer();
+    virtual std::shared_ptr<Event> ReadRecord();
+    size_t level() const { return m_stop - m_start; }
+    typedef unsigned char *ptr_t;
+    ptr_t m_start, m_stop;
 
   private:
     virtual void Deserialize(unsigned char *data, size_t len);
     size_t FillBuffer(size_t min = 0);
-    size_t level() const { return m_stop - m_start; }
-    typedef unsigned char *ptr_t;
     FILE *m_file;
     bool m_faileof;
     std::vector<unsigned char> m_buf;
-    ptr_t m_start, m_stop;
+  };
+
+  /** A FileDeserializer reading a complete (closed) file through a memory
+   *  mapping, so that events are decoded straight from the page cache and
+   *  skipping costs nothing. Data blocks of RawDataEvents reference the
+   *  mapping instead of being copied. Data appended to the file after it
+   *  was opened is not seen.
+   */
+  class DLLEXPORT MappedFileDeserializer : public FileDeserializer {
+  public:
+    explicit MappedFileDeserializer(const std::string &fname);
+    virtual bool HasData();
+    virtual const unsigned char *ReadReference(size_t size,
+                                               std::shared_ptr<const void> &owner);
+    virtual uint64_t Position() const;
+    virtual void Seek(uint64_t pos);
+
+  private:
+    virtual std::shared_ptr<Event> ReadRecord();
+    struct Mapping;
+    std::shared_ptr<Mapping> m_map;
+    ptr_t m_prefetched; ///< End of the range already advised for read-ahead
+  };
+
+  /** Reads the files written by CompressedFileSerializer, decompressing one
+   *  frame at a time. Positions are offsets in the uncompressed stream;
+   *  seeking uses the frame index at the end of the file, or the frame
+   *  headers of a file that is still being written.
+   */
+  class DLLEXPORT CompressedFileDeserializer : public FileDeserializer {
+  public:
+    explicit CompressedFileDeserializer(const std::string &fname,
+                                        bool faileof = false);
+    /// Whether the file starts like a compressed container
+    static bool IsCompressed(const std::string &fname);
+    virtual bool HasData();
+    virtual void Skip(size_t len);
+    virtual uint64_t Position() const;
+    virtual void Seek(uint64_t pos);
+    virtual ~CompressedFileDeserializer();
+
+  private:
+    struct FrameInfo {
+      uint64_t rawoffset, fileoffset;
+      uint32_t rawsize;
+    };
+    virtual void Deserialize(unsigned char *data, size_t len);
+    bool LoadIndex();
+    bool ScanFrame(bool wait);
+    bool LoadFrame(size_t i, bool wait);
+    bool ReadFile(uint64_t pos, unsigned char *data, size_t len, bool wait);
+    FILE *m_in;
+    bool m_faileof;
+    std::vector<FrameInfo> m_index;
+    bool m_complete;     ///< All frames are in m_index
+    uint64_t m_scanpos;  ///< File offset of the first frame not in m_index
+    size_t m_current;    ///< Index of the frame in m_raw
+    std::vector<unsigned char> m_raw, m_packed;
   };
 }
 
@@ -7,12 +7,24 @@
 
 namespace eudaq {
 
+  class StandardEvent;
+
   class DLLEXPORT FileWriter {
   public:
     FileWriter();
     virtual void StartRun(unsigned runnumber) = 0;
     virtual void WriteEvent(const DetectorEvent &) = 0;
+    /// True for writers that store StandardEvents
+    virtual bool UsesStandardEvent() const { return false; }
+    /// Write an event that has already been converted, e.g. by a
+    /// ParallelConverter
+    virtual void WriteStandardEvent(const DetectorEvent &dev,
+                                    const StandardEvent &) {
+      WriteEvent(dev);
+    }
     virtual uint64_t FileBytes() const = 0;
+    /// Bytes accepted but not yet written to the file
+    virtual uint64_t PendingBytes() const { return 0; }
     void SetFilePattern(const std::string &p) { m_filepattern = p; }
     virtual ~FileWriter() {}
 
@@ -0,0 +1,148 @@
+#ifndef EUDAQ_INCLUDED_Instrumentation
+#define EUDAQ_INCLUDED_Instrumentation
+
+#include "eudaq/Platform.hh"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace eudaq {
+
+  class Status;
+
+  /** The stages of the data path, from the producer's SendEvent to the
+   *  collector's WriteEvent, that are timed by the Instrumentation.
+   */
+  enum InstrumentationStage {
+    STAGE_SERIALIZE,   ///< Serializing an event in DataSender::SendEvent
+    STAGE_SEND,        ///< Sending the serialized event to the collector
+    STAGE_RECEIVE,     ///< From receiving a packet until it is deserialized
+    STAGE_DESERIALIZE, ///< Creating the event from the packet
+    STAGE_BUILD,       ///< From deserialization until the event is built
+    STAGE_CONVERT,     ///< Conversion to a StandardEvent
+    STAGE_WRITE,       ///< Writing a built event to the file
+    /// From SendEvent until the built event was written, for sub-events
+    /// stamped with Event::FTAG_SENDTIME by a producer on the same host
+    STAGE_TOTAL,
+    NUM_STAGES
+  };
+
+  /** A latency histogram with HDR-style buckets: values below 2^SUB_BITS
+   *  have one bucket each, above that every power of two is split into
+   *  2^SUB_BITS buckets, giving a relative resolution of about 6% from
+   *  nanoseconds to minutes with a fixed, small number of buckets.
+   *  Recording is lock-free and may be done from any thread.
+   */
+  class DLLEXPORT LatencyHistogram {
+  public:
+    static const unsigned SUB_BITS = 4;
+    static const unsigned MAX_BITS = 42; ///< Larger values are clamped
+    static const size_t NUM_BUCKETS = (MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+    /// A copy of the histogram, for computing statistics and differences
+    struct DLLEXPORT Snapshot {
+      Snapshot() : counts(NUM_BUCKETS), count(0), sum(0), max(0) {}
+      std::vector<uint64_t> counts;
+      uint64_t count, sum, max;
+      /// The entries since an older snapshot (max is approximated by the
+      /// highest bucket used)
+      Snapshot Since(const Snapshot &older) const;
+      /// The value below which the fraction q of the entries lie
+      uint64_t Percentile(double q) const;
+      double Mean() const { return count ? (double)sum / count : 0.0; }
+    };
+
+    LatencyHistogram();
+    void Record(uint64_t ns) {
+      m_counts[Bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+      m_count.fetch_add(1, std::memory_order_relaxed);
+      m_sum.fetch_add(ns, std::memory_order_relaxed);
+      uint64_t max = m_max.load(std::memory_order_relaxed);
+      while (ns > max &&
+             !m_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        ;
+    }
+    Snapshot Snap() const;
+    void Reset();
+
+    static size_t Bucket(uint64_t ns);
+    /// The largest value falling into bucket b
+    static uint64_t BucketMax(size_t b);
+
+  private:
+    std::atomic<uint64_t> m_counts[NUM_BUCKETS];
+    std::atomic<uint64_t> m_count, m_sum, m_max;
+  };
+
+  /** Process-wide latency histograms of the data path stages.
+   *  They are always recording (the cost is two clock reads and a few
+   *  relaxed atomic increments per event and stage) unless disabled with
+   *  SetEnabled(false). The statistics are added to the status of every
+   *  CommandReceiver as LAT_<stage> tags, and can be appended periodically
+   *  to a dump file (set with "LatencyDump" and "LatencyDumpInterval" in
+   *  the configuration section of the component), where each block holds
+   *  the latencies of the interval since the previous one.
+   */
+  class DLLEXPORT Instrumentation {
+  public:
+    typedef std::chrono::steady_clock clock;
+
+    static bool Enabled() {
+      return s_enabled.load(std::memory_order_relaxed);
+    }
+    static void SetEnabled(bool enabled) { s_enabled = enabled; }
+    static uint64_t Now() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 clock::now().time_since_epoch()).count();
+    }
+    static LatencyHistogram &Get(InstrumentationStage stage);
+    static void Record(InstrumentationStage stage, uint64_t ns) {
+      Get(stage).Record(ns);
+    }
+    /// Record the time since start (a value of Now()), if enabled
+    static void RecordSince(InstrumentationStage stage, uint64_t start) {
+      if (start && Enabled())
+        Get(stage).Record(Now() - start);
+    }
+    static void Reset();
+    static std::string StageName(InstrumentationStage stage);
+
+    /// Add a LAT_<stage> tag for each stage with entries
+    static void FillStatus(Status &status);
+    /// A table of the statistics of all stages with entries
+    static std::string Report();
+    /// Append the statistics to the file every interval seconds;
+    /// an empty filename stops dumping
+    static void StartDump(const std::string &filename, double interval = 10);
+    static void StopDump();
+
+    /// Count the CPU time of the calling thread, from now until it exits,
+    /// for a stage (for threads that mostly work on that stage)
+    static void SetThreadStage(InstrumentationStage stage);
+    /// The CPU seconds used by the threads of a stage so far (0 on
+    /// platforms without per-thread CPU clocks)
+    static double ThreadCPU(InstrumentationStage stage);
+
+  private:
+    static std::atomic<bool> s_enabled;
+  };
+
+  /** Times a scope and records it for a stage.
+   */
+  class StageTimer {
+  public:
+    explicit StageTimer(InstrumentationStage stage)
+        : m_stage(stage),
+          m_start(Instrumentation::Enabled() ? Instrumentation::Now() : 0) {}
+    ~StageTimer() { Instrumentation::RecordSince(m_stage, m_start); }
+
+  private:
+    StageTimer(const StageTimer &);
+    StageTimer &operator=(const StageTimer &);
+    InstrumentationStage m_stage;
+    uint64_t m_start;
+  };
+}
+
+#endif // EUDAQ_INCLUDED_Instrumentation
@@ -0,0 +1,64 @@
+#ifndef EUDAQ_INCLUDED_MemoryPool
+#define EUDAQ_INCLUDED_MemoryPool
+
+#include "eudaq/Platform.hh"
+#include <cstddef>
+#include <memory>
+
+namespace eudaq {
+
+  /** A process-wide pool of memory blocks in power-of-two size classes.
+   *  Released blocks are kept on lock-free free lists and handed out again,
+   *  so the objects that use it (events, their sub-event and block lists,
+   *  shared_ptr control blocks and the collector's queues) stop going
+   *  through the system allocator once the pool is warm. Other per-event
+   *  allocations, such as tags, strings, packets and the contents of data
+   *  blocks, still use the system allocator.
+   *
+   *  Blocks larger than MAX_SIZE, or released while their free list is full
+   *  or the pool already keeps MAX_RETAINED bytes, go back to the system.
+   */
+  class DLLEXPORT MemoryPool {
+  public:
+    static const size_t MAX_SIZE = 1 << 20;
+    static const size_t MAX_RETAINED = 64 << 20;
+    static void *Allocate(size_t bytes);
+    static void Deallocate(void *p, size_t bytes);
+    /// The number of blocks that had to be taken from the system
+    static uint64_t NumMisses();
+    /// The number of bytes kept on the free lists
+    static uint64_t RetainedBytes();
+    /// Return all free blocks to the system, e.g. at the end of a run
+    static void Trim();
+  };
+
+  /** An std allocator drawing from the MemoryPool.
+   */
+  template <typename T> class PoolAllocator {
+  public:
+    typedef T value_type;
+    PoolAllocator() {}
+    template <typename U> PoolAllocator(const PoolAllocator<U> &) {}
+    template <typename U> struct rebind { typedef PoolAllocator<U> other; };
+    T *allocate(size_t n) {
+      return static_cast<T *>(MemoryPool::Allocate(n * sizeof(T)));
+    }
+    void deallocate(T *p, size_t n) { MemoryPool::Deallocate(p, n * sizeof(T)); }
+  };
+
+  template <typename T, typename U>
+  inline bool operator==(const PoolAllocator<T> &, const PoolAllocator<U> &) {
+    return true;
+  }
+  template <typename T, typename U>
+  inline bool operator!=(const PoolAllocator<T> &, const PoolAllocator<U> &) {
+    return false;
+  }
+
+  /// Take ownership of p with a shared_ptr whose control block is pooled
+  template <typename T> std::shared_ptr<T> MakePooled(T *p) {
+    return std::shared_ptr<T>(p, std::default_delete<T>(), PoolAllocator<T>());
+  }
+}
+
+#endif // EUDAQ_INCLUDED_MemoryPool
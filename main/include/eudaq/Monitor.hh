@@ -4,6 +4,10 @@
 #include "eudaq/StandardEvent.hh"
 #include "eudaq/CommandReceiver.hh"
 #include "eudaq/FileReader.hh"
+#include "eudaq/ParallelConverter.hh"
+#include "eudaq/SharedMemoryRing.hh"
+#include "eudaq/Time.hh"
+#include <atomic>
 #include <string>
 #include <memory>
 using std::shared_ptr;
@@ -18,10 +22,17 @@ namespace eudaq {
      * The constructor.
      * \param runcontrol A string containing the address of the RunControl to
      * connect to.
+     * \param threads The number of threads converting events to
+     * StandardEvents, 1 converts them on the monitor thread.
+     * \param sharedmemory The name of the shared memory ring of the
+     * DataCollector ("SharedMemory" in its configuration) to read the
+     * events from instead of the data files. The monitor attaches to it
+     * when it appears and only gets the events published after that.
      */
     Monitor(const std::string &name, const std::string &runcontrol,
             const unsigned lim, const unsigned skip_,
-            const unsigned int skip_evts, const std::string &datafile = "");
+            const unsigned int skip_evts, const std::string &datafile = "",
+            unsigned threads = 1, const std::string &sharedmemory = "");
     virtual ~Monitor() {}
 
     bool ProcessEvent();
@@ -35,7 +46,9 @@ namespace eudaq {
     shared_ptr<DetectorEvent> LastBore() const { return m_lastbore; }
 
   protected:
-    unsigned m_run;
+    shared_ptr<DetectorEvent> NextSharedEvent();
+
+    std::atomic<unsigned> m_run; ///< Also read by the ring reader thread
     bool m_callstart;
     shared_ptr<FileReader> m_reader;
     shared_ptr<DetectorEvent> m_lastbore;
@@ -43,6 +56,10 @@ namespace eudaq {
     unsigned skip;
     unsigned int skip_events_with_counter;
     unsigned int counter_for_skipping;
+    std::unique_ptr<ParallelConverter> m_converter;
+    std::string m_shmname;
+    std::unique_ptr<SharedMemoryReader> m_shm;
+    Time m_shmretry; ///< When to try attaching to the ring again
   };
 }
 
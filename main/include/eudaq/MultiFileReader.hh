@@ -9,12 +9,21 @@
 #include "FileReader.hh"
 #include "Platform.hh"
 #include "EventSynchronisationBase.hh"
+#include "BoundedQueue.hh"
+#include <atomic>
+#include <thread>
+#include <exception>
 
 namespace eudaq {
 
+  /** Reads several raw files in parallel and synchronises their events.
+   *  Unless readahead is 0, every file is read and deserialized by its own
+   *  thread into a queue of up to readahead events.
+   */
   class DLLEXPORT multiFileReader {
   public:
-    multiFileReader(bool sync = true);
+    multiFileReader(bool sync = true, size_t readahead = 256);
+    ~multiFileReader();
 
     unsigned RunNumber() const;
 
@@ -28,9 +37,26 @@ namespace eudaq {
     void Interrupt();
 
   private:
+    /// Read-ahead state of one input file
+    struct ReadAhead {
+      explicit ReadAhead(size_t size) : queue(size), eof(false) {}
+      void Run(FileReader *reader, const std::atomic<bool> *stop);
+      BoundedQueue<std::shared_ptr<DetectorEvent>> queue;
+      std::atomic<bool> eof; ///< Set after the last event has been queued
+      std::exception_ptr error;
+      std::thread thread;
+    };
+    bool ReadNext(size_t fileID);
+    void StartReadAhead();
+    void StopReadAhead();
+
     std::string m_filename;
     std::shared_ptr<eudaq::DetectorEvent> m_ev;
     std::vector<std::shared_ptr<eudaq::FileReader>> m_fileReaders;
+    std::vector<std::unique_ptr<ReadAhead>> m_readahead;
+    std::vector<std::shared_ptr<DetectorEvent>> m_current;
+    size_t m_readaheadsize;
+    std::atomic<bool> m_stop;
     SyncBase m_sync;
     size_t m_eventsToSync;
     bool m_preaparedForEvents;
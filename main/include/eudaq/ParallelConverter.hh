@@ -0,0 +1,89 @@
+#ifndef EUDAQ_INCLUDED_ParallelConverter
+#define EUDAQ_INCLUDED_ParallelConverter
+
+#include "eudaq/DetectorEvent.hh"
+#include "eudaq/StandardEvent.hh"
+#include "eudaq/Platform.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eudaq {
+
+  class DataConverterPlugin;
+
+  /** Converts DetectorEvents to StandardEvents on a pool of threads.
+   *  Several events are converted at the same time, but the results are
+   *  passed to the callback on the calling thread, in the order in which
+   *  the events were given to Convert().
+   *
+   *  BORE and EORE events are barriers: everything before them is
+   *  delivered first and they are handled on the calling thread, so the
+   *  callback may call PluginManager::Initialize. The BORE is not
+   *  converted, since the plugins are only initialized with it: it is
+   *  passed with a StandardEvent holding just its header.
+   *  Sub-events of plugins that are not thread-safe (see
+   *  DataConverterPlugin::IsThreadSafe) are converted one at a time and in
+   *  event order.
+   */
+  class DLLEXPORT ParallelConverter {
+  public:
+    typedef std::function<void(const DetectorEvent &, const StandardEvent &)>
+        Callback;
+
+    /** threads = 0 uses one thread per core, threads = 1 converts every
+     *  event directly on the calling thread. At most inflight events
+     *  (default 4 per thread) are queued before Convert() blocks.
+     */
+    ParallelConverter(const Callback &callback, unsigned threads = 0,
+                      size_t inflight = 0);
+    ~ParallelConverter();
+
+    void Convert(std::shared_ptr<const DetectorEvent> dev);
+    /// Wait for all events in flight and pass them to the callback
+    void Flush();
+    unsigned NumThreads() const { return (unsigned)m_threads.size(); }
+
+  private:
+    struct Turn {
+      Turn() : issued(0), served(0) {}
+      uint64_t issued, served;
+    };
+    struct Step {
+      const Event *ev;
+      Turn *turn; ///< Null for thread-safe plugins
+      uint64_t ticket;
+    };
+    struct Job {
+      Job() : done(false) {}
+      std::shared_ptr<const DetectorEvent> dev;
+      std::vector<Step> steps;
+      std::unique_ptr<StandardEvent> sev;
+      std::exception_ptr error;
+      bool done;
+    };
+
+    void WorkerThread();
+    void Run(Job &job);
+    void Deliver(size_t keep);
+
+    Callback m_callback;
+    size_t m_maxinflight;
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cvwork, m_cvdone;
+    std::deque<std::shared_ptr<Job>> m_queue;    ///< Waiting for a worker
+    std::deque<std::shared_ptr<Job>> m_inflight; ///< Not yet delivered
+    std::map<const DataConverterPlugin *, Turn> m_turns;
+    bool m_stop;
+  };
+}
+
+#endif // EUDAQ_INCLUDED_ParallelConverter
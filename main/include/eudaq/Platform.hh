@@ -12,6 +12,13 @@
 
 #define EUDAQ_PLATFORM_IS(P) (EUDAQ_PLATFORM == PF_##P)
 
+// host byte order: the serialized data format is little-endian, so on
+// big-endian hosts the bulk (memcpy) serialization paths are disabled
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) &&               \
+    (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define EUDAQ_BIG_ENDIAN 1
+#endif
+
 #ifdef WIN32
 #define DLLEXPORT __declspec(dllexport)
 
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 namespace eudaq {
 
@@ -44,6 +45,9 @@ namespace eudaq {
     static void Initialize(const DetectorEvent &);
     static lcio::LCRunHeader *GetLCRunHeader(const DetectorEvent &);
     static StandardEvent ConvertToStandard(const DetectorEvent &);
+    /// The sub-events in the order ConvertToStandard converts them
+    static std::vector<const Event *>
+    StandardSubEvents(const DetectorEvent &);
     static lcio::LCEvent *ConvertToLCIO(const DetectorEvent &);
 
     static void ConvertStandardSubEvent(StandardEvent &, const Event &);
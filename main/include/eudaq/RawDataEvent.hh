@@ -4,8 +4,10 @@
 #include <sstream>
 
 #include <vector>
+#include <memory>
 #include "eudaq/Event.hh"
 #include "eudaq/Platform.hh"
+#include "eudaq/MemoryPool.hh"
 namespace eudaq {
 
   /** An Event type consisting of just a vector of bytes.
@@ -17,18 +19,42 @@ namespace eudaq {
   public:
     typedef unsigned char byte_t;
     typedef std::vector<byte_t> data_t;
+    /** A data block of the event.
+     *  A block normally owns its payload in \c data. When it is deserialized
+     *  from a shared buffer (see BufferDeserializer) it instead references a
+     *  slice of that buffer, which is kept alive by the block. The slice is
+     *  only copied into \c data when the vector itself is requested.
+     */
     struct DLLEXPORT block_t : public Serializable {
       block_t(unsigned id, const data_t& data)
-          : id(id), data(data) {}
+          : id(id), data(data), m_ref(0), m_reflen(0), m_copied(false) {}
       block_t(unsigned id, data_t&& data)
-	: id(id), data(std::move(data)) {}
+	: id(id), data(std::move(data)), m_ref(0), m_reflen(0), m_copied(false) {}
       block_t()
-	: id(-1), data(data_t()) {}
+	: id(-1), data(data_t()), m_ref(0), m_reflen(0), m_copied(false) {}
       block_t(Deserializer &);
       void Serialize(Serializer &) const;
       void Append(const data_t &data);
+      /// True if the payload references a shared buffer
+      bool IsReference() const { return m_ref != 0; }
+      /// Pointer to the payload bytes (never copies)
+      const byte_t *Bytes() const {
+        return m_ref ? m_ref : (data.empty() ? 0 : &data[0]);
+      }
+      /// Size of the payload in bytes
+      size_t Size() const { return m_ref ? m_reflen : data.size(); }
+      /** The payload as vector; a referenced slice is copied on first use.
+       *  Safe to call from several threads reading the same event.
+       */
+      const data_t &Data() const;
       unsigned id;
-      data_t data;
+      mutable data_t data;
+
+    private:
+      std::shared_ptr<const void> m_owner;
+      const byte_t *m_ref; ///< Only changed by non-const members
+      size_t m_reflen;
+      mutable bool m_copied; ///< data holds a copy of m_ref, see Data()
     };
 
     RawDataEvent(std::string type, unsigned run, unsigned event);
@@ -74,6 +100,10 @@ namespace eudaq {
      *  give different results depending on the endiannes of your mashine.
      */
     const data_t &GetBlock(size_t i) const;
+    /// Pointer to the bytes of block i, without copying a referenced block
+    const byte_t *GetBlockData(size_t i) const;
+    /// Size in bytes of block i
+    size_t GetBlockSize(size_t i) const;
     byte_t GetByte(size_t block, size_t index) const;
 
     /// Return the number of data blocks in the RawDataEvent
@@ -120,7 +150,7 @@ namespace eudaq {
     }
 
     std::string m_type;
-    std::vector<block_t> m_blocks;
+    std::vector<block_t, PoolAllocator<block_t>> m_blocks;
   };
 }
 
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <type_traits>
 #include "eudaq/Serializable.hh"
 
 #include "eudaq/Time.hh"
@@ -16,6 +18,20 @@ namespace eudaq {
     const char *what() const throw() { return "InterruptedException"; }
   };
 
+  // Types whose serialized representation is identical to their in-memory
+  // representation on this host, so that whole vectors of them can be
+  // (de)serialized with a single memcpy-like call.
+  template <typename T> struct IsBulkSerializable {
+#ifdef EUDAQ_BIG_ENDIAN
+    static const bool value = false;
+#else
+    static const bool value =
+        (std::is_integral<T>::value && !std::is_same<T, bool>::value) ||
+        (std::is_floating_point<T>::value &&
+         (sizeof(T) == sizeof(uint32_t) || sizeof(T) == sizeof(uint64_t)));
+#endif
+  };
+
   class DLLEXPORT Serializer {
   public:
     virtual void Flush() {}
@@ -28,14 +44,29 @@ namespace eudaq {
     void append(const unsigned char *data, size_t size) {
       Serialize(data, size);
     }
+    /** Like append(), but the Serializer may keep a pointer to the data
+     *  instead of copying it (see GatherSerializer), so the data must stay
+     *  unchanged until the serialized result has been used. Meant for data
+     *  owned by the object being serialized, such as RawDataEvent blocks.
+     */
+    void append_reference(const unsigned char *data, size_t size) {
+      SerializeReference(data, size);
+    }
 
     virtual uint64_t GetCheckSum() { return 0; }
 
     virtual ~Serializer() {}
 
   private:
+    template <typename T>
+    void write_elements(const std::vector<T> &t, std::true_type);
+    template <typename T>
+    void write_elements(const std::vector<T> &t, std::false_type);
     template <typename T> friend struct WriteHelper;
     virtual void Serialize(const unsigned char *, size_t) = 0;
+    virtual void SerializeReference(const unsigned char *data, size_t len) {
+      Serialize(data, len);
+    }
   };
 
   template <typename T> struct WriteHelper {
@@ -119,7 +150,22 @@ namespace eudaq {
   template <typename T> inline void Serializer::write(const std::vector<T> &t) {
     unsigned len = t.size();
     write(len);
-    for (size_t i = 0; i < len; ++i) {
+    write_elements(
+        t, std::integral_constant<bool, IsBulkSerializable<T>::value>());
+  }
+
+  template <typename T>
+  inline void Serializer::write_elements(const std::vector<T> &t,
+                                         std::true_type) {
+    if (t.size())
+      Serialize(reinterpret_cast<const unsigned char *>(&t[0]),
+                t.size() * sizeof(T));
+  }
+
+  template <typename T>
+  inline void Serializer::write_elements(const std::vector<T> &t,
+                                         std::false_type) {
+    for (size_t i = 0; i < t.size(); ++i) {
       write(t[i]);
     }
   }
@@ -175,12 +221,27 @@ namespace eudaq {
 
     void read(unsigned char *dst, size_t size) { Deserialize(dst, size); }
 
+    /** Consume the next size bytes without copying them.
+     *  Deserializers backed by shared, immutable memory return a pointer to
+     *  the bytes and set owner to an object that keeps them alive. All others
+     *  return 0 and leave the read position unchanged, in which case the
+     *  caller must fall back to read().
+     */
+    virtual const unsigned char *
+    ReadReference(size_t /*size*/, std::shared_ptr<const void> & /*owner*/) {
+      return 0;
+    }
+
     virtual ~Deserializer() {}
 
   protected:
     bool m_interrupting;
 
   private:
+    template <typename T>
+    void read_elements(std::vector<T> &t, unsigned len, std::true_type);
+    template <typename T>
+    void read_elements(std::vector<T> &t, unsigned len, std::false_type);
     template <typename T> friend struct ReadHelper;
     virtual void Deserialize(unsigned char *, size_t) = 0;
   };
@@ -271,7 +332,25 @@ namespace eudaq {
   template <typename T> inline void Deserializer::read(std::vector<T> &t) {
     unsigned len = 0;
     read(len);
-    t.reserve(len);
+    read_elements(
+        t, len, std::integral_constant<bool, IsBulkSerializable<T>::value>());
+  }
+
+  template <typename T>
+  inline void Deserializer::read_elements(std::vector<T> &t, unsigned len,
+                                          std::true_type) {
+    if (!len)
+      return;
+    size_t offset = t.size();
+    t.resize(offset + len);
+    Deserialize(reinterpret_cast<unsigned char *>(&t[offset]),
+                len * sizeof(T));
+  }
+
+  template <typename T>
+  inline void Deserializer::read_elements(std::vector<T> &t, unsigned len,
+                                          std::false_type) {
+    t.reserve(t.size() + len);
     for (size_t i = 0; i < len; ++i) {
       t.push_back(read<T>());
     }
@@ -0,0 +1,89 @@
+#ifndef EUDAQ_INCLUDED_SharedMemoryRing
+#define EUDAQ_INCLUDED_SharedMemoryRing
+
+#include "eudaq/DetectorEvent.hh"
+#include "eudaq/Platform.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace eudaq {
+
+  /** Publishes built DetectorEvents in a POSIX shared memory ring, so that
+   *  monitors on the same host can read them without going through the
+   *  file (see SharedMemoryReader).
+   *
+   *  The ring has a fixed number of slots of a fixed size; each event is
+   *  serialized directly into the next slot, overwriting the oldest event.
+   *  The writer never waits for readers: a reader that falls behind loses
+   *  the events that were overwritten. The last BORE is also kept in a
+   *  slot of its own, for readers that attach during a run.
+   *
+   *  Events that do not fit into a slot are not published.
+   */
+  class DLLEXPORT SharedMemoryRing {
+  public:
+    /// Creates the shared memory object name, throws if it already exists
+    SharedMemoryRing(const std::string &name, size_t slots, size_t slotsize);
+    ~SharedMemoryRing();
+
+    /// Returns false if the event could not be published
+    bool Publish(const DetectorEvent &ev);
+
+    const std::string &Name() const { return m_name; }
+    size_t NumSlots() const { return m_slots; }
+    size_t SlotSize() const { return m_slotsize; }
+    uint64_t NumPublished() const { return m_published; }
+    uint64_t NumTooLarge() const { return m_toolarge; }
+
+  private:
+    SharedMemoryRing(const SharedMemoryRing &);
+    SharedMemoryRing &operator=(const SharedMemoryRing &);
+    /// Returns false, leaving the slot untouched, if ev does not fit
+    bool Write(size_t slot, uint64_t seq, const DetectorEvent &ev);
+
+    std::string m_name;
+    size_t m_slots, m_slotsize;
+    size_t m_mapsize;
+    unsigned char *m_map;
+    /// Read by other threads for the status
+    std::atomic<uint64_t> m_published, m_toolarge;
+  };
+
+  /** Reads the events published by a SharedMemoryRing of another process.
+   *  Events are deserialized straight from the shared memory; one that was
+   *  overwritten while it was being read is dropped.
+   */
+  class DLLEXPORT SharedMemoryReader {
+  public:
+    /// Attaches to the ring name, throws if there is none
+    explicit SharedMemoryReader(const std::string &name);
+    ~SharedMemoryReader();
+
+    /** The next event, or a null pointer if there is no new one. Reading
+     *  starts with the events published after attaching.
+     */
+    std::shared_ptr<DetectorEvent> NextEvent();
+    /// The last BORE published, or a null pointer
+    std::shared_ptr<DetectorEvent> LastBore();
+    /// True once the ring was removed by its writer
+    bool IsClosed() const;
+    /// The number of events lost because they were overwritten
+    uint64_t NumDropped() const { return m_dropped; }
+
+  private:
+    SharedMemoryReader(const SharedMemoryReader &);
+    SharedMemoryReader &operator=(const SharedMemoryReader &);
+    std::shared_ptr<DetectorEvent> Read(size_t slot, uint64_t seq);
+
+    std::string m_name;
+    size_t m_slots, m_slotsize;
+    size_t m_mapsize;
+    const unsigned char *m_map;
+    uint64_t m_next, m_dropped;
+  };
+}
+
+#endif // EUDAQ_INCLUDED_SharedMemoryRing
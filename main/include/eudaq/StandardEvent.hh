@@ -54,7 +54,8 @@ namespace eudaq {
 
     void SetPixelHelper(unsigned index, unsigned x, unsigned y, double pix,
                         bool pivot, unsigned frame);
-    void PushPixelHelper(unsigned x, unsigned y, double pix, bool pivot,
+    /// Also for hits with non-integer coordinates, e.g. read from a file
+    void PushPixelHelper(coord_t x, coord_t y, double pix, bool pivot,
                          unsigned frame);
     double GetPixel(unsigned index, unsigned frame) const;
     double GetPixel(unsigned index) const;
@@ -105,6 +106,7 @@ namespace eudaq {
     void Print(std::ostream &) const;
 
   private:
+    friend class CompactPlane;
     const std::vector<pixel_t> &
     GetFrame(const std::vector<std::vector<pixel_t>> &v, unsigned f) const;
     void SetupResult() const;
@@ -8,8 +8,11 @@
 #include "eudaq/Mutex.hh"
 #include "eudaq/Exception.hh"
 #include "eudaq/BufferSerializer.hh"
+#include "eudaq/BoundedQueue.hh"
 #include <string>
-#include <queue>
+#include <deque>
+#include <mutex>
+#include <atomic>
 #include <iosfwd>
 #include <cstring>
 #include <iostream>
@@ -55,87 +58,106 @@ namespace eudaq {
 
   /** Represents an event such as a connection, or receipt of data on a
    * Transport.
+   * Events are moved, never copied, from the transport to the callback.
    */
   class TransportEvent {
   public:
     enum EventType { CONNECT, DISCONNECT, RECEIVE };
-    TransportEvent(EventType et, ConnectionInfo &i, const std::string &p = "")
-        : etype(et), id(i), packet(p) {}
+    TransportEvent(EventType et, ConnectionInfo &i,
+                   std::string p = std::string())
+        : etype(et), id(i), packet(std::move(p)) {}
+    TransportEvent(TransportEvent &&other)
+        : etype(other.etype), id(other.id), packet(std::move(other.packet)) {}
     EventType etype;    ///< The type of event
     ConnectionInfo &id; ///< The id of the connection
     std::string packet; ///< The packet of data in case of a RECEIVE event
+
+  private:
+    TransportEvent(const TransportEvent &);
+    TransportEvent &operator=(const TransportEvent &);
+  };
+
+  /** The queue between ProcessEvents, which fills it, and the handling of
+   * the events. Events are passed through a lock-free ring (a BoundedQueue)
+   * and only go to a locked overflow list while the ring is full, so that
+   * no event is ever dropped or reordered. There must be only one producer
+   * at a time (ProcessEvents is serialized by the transport's mutex), but
+   * there may be several consumers.
+   */
+  class DLLEXPORT TransportEventQueue {
+  public:
+    struct Item {
+      Item() : etype(TransportEvent::CONNECT), id(0) {}
+      TransportEvent::EventType etype;
+      ConnectionInfo *id;
+      std::string packet;
+    };
+    explicit TransportEventQueue(size_t capacity = 1024);
+    void Push(TransportEvent::EventType et, ConnectionInfo &id,
+              std::string &&packet = std::string());
+    bool Pop(Item &item);
+    bool Empty() const;
+
+  private:
+    BoundedQueue<Item> m_ring;
+    std::atomic<size_t> m_overflowsize;
+    std::deque<Item> m_overflow;
+    std::mutex m_overflowmutex;
   };
 
   /** Represents a callback function for the Transport system.
    * It can hold a pointer to a callback function which can be
    * either a free function or an object and a member function.
-   * It is like a simplified and less flexible version of boost::function.
-   * I didn't use boost::function because I didn't want to rely
-   * on too many external dependencies.
+   * It is like a simplified and less flexible version of std::function,
+   * but it never allocates and is called without a virtual function call.
    */
   class TransportCallback {
-    /** A helper class for TransportCallback.
-     * It specifies an interface from which the actual helpers inherit.
-     */
-    class Helper {
-    public:
-      virtual void call(TransportEvent &) = 0;
-      virtual ~Helper() {}
-      virtual Helper *Clone() const = 0;
-    };
-    /** A helper class for TransportCallback for normal function pointers.
-     * It performs the actual function call for a normal function pointer.
-     */
-    class HelperFunction : public Helper {
-    public:
-      typedef void (*FuncType)(TransportEvent &);
-      HelperFunction(FuncType func) : m_func(func) {}
-      virtual void call(TransportEvent &ev) { m_func(ev); }
-      virtual Helper *Clone() const { return new HelperFunction(*this); }
-
-    private:
-      FuncType m_func; ///< A pointer to the function to call
-    };
-    /** A helper class for TransportCallback for member function pointers.
-     * It performs the actual function call for a member function pointer.
-     * It also stores a pointer to the object on which to call the member
-     * function.
-     */
-    template <typename T> class HelperMember : public Helper {
-    public:
-      typedef T ObjType;
-      typedef void (ObjType::*FuncType)(TransportEvent &);
-      HelperMember(ObjType *obj, FuncType func) : m_obj(obj), m_func(func) {}
-      virtual void call(TransportEvent &ev) { (m_obj->*m_func)(ev); }
-      virtual Helper *Clone() const { return new HelperMember(*this); }
-
-    private:
-      ObjType *m_obj;  ///< A pointer to the object
-      FuncType m_func; ///< A pointer to the member function
+    typedef void (*FuncType)(TransportEvent &);
+    template <typename T> struct Member {
+      typedef void (T::*FuncType)(TransportEvent &);
     };
 
   public:
-    TransportCallback() : m_helper(0) {}
-    TransportCallback(HelperFunction::FuncType funcptr)
-        : m_helper(new HelperFunction(funcptr)) {}
+    TransportCallback() : m_invoke(0), m_obj(0) {}
+    TransportCallback(FuncType funcptr)
+        : m_invoke(funcptr ? &CallFunction : 0), m_obj(0) {
+      Store(funcptr);
+    }
     template <typename T>
-    TransportCallback(T *obj, typename HelperMember<T>::FuncType func)
-        : m_helper(new HelperMember<T>(obj, func)) {}
-    void operator()(TransportEvent &ev) {
-      if (m_helper)
-        m_helper->call(ev);
+    TransportCallback(T *obj, typename Member<T>::FuncType func)
+        : m_invoke(&CallMember<T>), m_obj(obj) {
+      Store(func);
     }
-    TransportCallback(const TransportCallback &other)
-        : m_helper(other.m_helper->Clone()) {}
-    TransportCallback &operator=(const TransportCallback &other) {
-      delete m_helper;
-      m_helper = other.m_helper->Clone();
-      return *this;
+    void operator()(TransportEvent &ev) const {
+      if (m_invoke)
+        m_invoke(*this, ev);
     }
-    ~TransportCallback() { delete m_helper; }
 
   private:
-    Helper *m_helper; ///< The helper class to perform the actual function call
+    template <typename F> void Store(F func) {
+      static_assert(sizeof(F) <= sizeof(m_func),
+                    "Member function pointer too large for TransportCallback");
+      std::memcpy(m_func.bytes, &func, sizeof func);
+    }
+    template <typename F> F Load() const {
+      F func;
+      std::memcpy(&func, m_func.bytes, sizeof func);
+      return func;
+    }
+    static void CallFunction(const TransportCallback &cb, TransportEvent &ev) {
+      cb.Load<FuncType>()(ev);
+    }
+    template <typename T>
+    static void CallMember(const TransportCallback &cb, TransportEvent &ev) {
+      (static_cast<T *>(cb.m_obj)->*cb.Load<typename Member<T>::FuncType>())(
+          ev);
+    }
+    void (*m_invoke)(const TransportCallback &, TransportEvent &);
+    void *m_obj; ///< The object for a member function
+    union {
+      unsigned char bytes[4 * sizeof(void *)];
+      void *align;
+    } m_func; ///< The function or member function pointer
   };
 
   /** A base class from which all types of Transport should inherit.
@@ -176,6 +198,20 @@ namespace eudaq {
                     bool duringconnect = false) {
       SendPacket(&t[0], t.size(), inf, duringconnect);
     }
+    /** Send one packet made up of several segments.
+     * The default implementation concatenates the segments and sends the
+     * result; concrete Transports should override it to send the segments
+     * directly (e.g. with a scatter-gather system call).
+     */
+    virtual void SendPacket(const BufferSegment *segments, size_t nsegments,
+                            const ConnectionInfo &inf = ConnectionInfo::ALL,
+                            bool duringconnect = false);
+    void SendPacket(const GatherSerializer &t,
+                    const ConnectionInfo &inf = ConnectionInfo::ALL,
+                    bool duringconnect = false) {
+      std::vector<BufferSegment> segments = t.Segments();
+      SendPacket(segments.data(), segments.size(), inf, duringconnect);
+    }
 
     /** Pure virtual function to close a connection.
      * This function should be implemented by the concrete Transport class to
@@ -206,11 +242,16 @@ namespace eudaq {
     virtual bool IsNull() const { return false; }
 
   protected:
-    std::queue<TransportEvent>
+    TransportEventQueue
         m_events; ///< A buffer to queue up events until they are handled
     TransportCallback
         m_callback; ///< The callback function to invoke on a transport event
     Mutex m_mutex;
+
+  private:
+    /// An event taken off the queue by ReceivePacket that was not for it
+    TransportEventQueue::Item m_held;
+    bool m_hasheld;
   };
 
   template <typename T>
@@ -14,24 +14,48 @@
 typedef int SOCKET;
 #endif
 
+#if EUDAQ_PLATFORM_IS(LINUX)
+#include <sys/epoll.h>
+#include <deque>
+#include <unordered_map>
+#endif
+
 #include <vector>
 #include <string>
 #include <map>
 
 namespace eudaq {
 
+  /** A TCP connection together with its receive buffer.
+   *  Data are received directly into the free space of the buffer (see
+   *  recvbuffer() and received()). Packets larger than DIRECT_THRESHOLD are
+   *  received straight into the string that getpacket() hands out, so they
+   *  are never copied after leaving the socket.
+   */
   class ConnectionInfoTCP : public ConnectionInfo {
   public:
+    static const size_t DEFAULT_BUFFER_SIZE = 65536;
+    static const size_t DIRECT_THRESHOLD = 16384;
     ConnectionInfoTCP(SOCKET fd, const std::string &host = "")
-        : m_fd(fd), m_host(host), m_len(0), m_buf("") {}
+        : m_fd(fd), m_host(host), m_bufsize(DEFAULT_BUFFER_SIZE), m_begin(0),
+          m_end(0), m_len(0), m_haveheader(false), m_direct(false),
+          m_pktlen(0), m_filled(0) {}
     void append(size_t length, const char *data);
+    /// Space to recv() into; length is set to the number of free bytes
+    char *recvbuffer(size_t &length);
+    /// Announce that length bytes were written into the recvbuffer()
+    void received(size_t length);
+    /// Set the size of the receive buffer (e.g. to match SO_RCVBUF)
+    void SetBufferSize(size_t size);
     bool havepacket() const;
     std::string getpacket();
     SOCKET GetFd() const { return m_fd; }
     void Disable() {
       m_state = -1;
-      m_len = 0;
-      m_buf = "";
+      m_buf = std::vector<char>();
+      m_packet = std::string();
+      m_begin = m_end = m_len = m_pktlen = m_filled = 0;
+      m_haveheader = m_direct = false;
     }
     virtual bool Matches(const ConnectionInfo &other) const;
     virtual void Print(std::ostream &) const;
@@ -41,11 +65,16 @@ namespace eudaq {
     }
 
   private:
-    void update_length(bool = false);
+    void update_length();
     SOCKET m_fd;
     std::string m_host;
-    size_t m_len;
-    std::string m_buf;
+    std::vector<char> m_buf; ///< Staging buffer for headers and small packets
+    size_t m_bufsize, m_begin, m_end;
+    size_t m_len;      ///< Length of the packet at m_begin, if m_haveheader
+    bool m_haveheader; ///< The header at m_begin has been consumed
+    bool m_direct;     ///< A large packet is being received into m_packet
+    std::string m_packet;
+    size_t m_pktlen, m_filled;
   };
 
   class TCPServer : public TransportServer {
@@ -57,6 +86,9 @@ namespace eudaq {
     virtual void SendPacket(const unsigned char *data, size_t len,
                             const ConnectionInfo &id = ConnectionInfo::ALL,
                             bool duringconnect = false);
+    virtual void SendPacket(const BufferSegment *segments, size_t nsegments,
+                            const ConnectionInfo &id = ConnectionInfo::ALL,
+                            bool duringconnect = false);
     virtual void ProcessEvents(int timeout);
 
     virtual std::string ConnectionString() const;
@@ -73,6 +105,50 @@ namespace eudaq {
     // map_t m_map;
   };
 
+#if EUDAQ_PLATFORM_IS(LINUX)
+  /** A TCP server using epoll instead of select().
+   *  It is not limited to FD_SETSIZE descriptors, finds the connection of a
+   *  ready socket in constant time and reads in edge-triggered mode.
+   *  To be fair between many busy connections, at most a fixed quota is
+   *  read from a socket at a time; sockets that still have data wait in a
+   *  round-robin list for their next turn.
+   *  The wire protocol is the same as for TCPServer, so it is used with
+   *  TCPClient on the other side.
+   */
+  class EPOLLServer : public TransportServer {
+  public:
+    EPOLLServer(const std::string &param);
+    virtual ~EPOLLServer();
+
+    virtual void Close(const ConnectionInfo &id);
+    virtual void SendPacket(const unsigned char *data, size_t len,
+                            const ConnectionInfo &id = ConnectionInfo::ALL,
+                            bool duringconnect = false);
+    virtual void SendPacket(const BufferSegment *segments, size_t nsegments,
+                            const ConnectionInfo &id = ConnectionInfo::ALL,
+                            bool duringconnect = false);
+    virtual void ProcessEvents(int timeout);
+
+    virtual std::string ConnectionString() const;
+    static const std::string name;
+
+  private:
+    struct Peer {
+      ConnectionInfoTCP *info;
+      bool ready; ///< In m_ready
+    };
+    void Accept();
+    bool Receive(ConnectionInfoTCP &m, bool &drained);
+    void Remove(ConnectionInfoTCP &m);
+
+    int m_port;
+    SOCKET m_srvsock;
+    int m_epollfd;
+    std::unordered_map<SOCKET, Peer> m_fdmap;
+    std::deque<SOCKET> m_ready; ///< Sockets that may have unread data
+  };
+#endif
+
   class TCPClient : public TransportClient {
   public:
     TCPClient(const std::string &param);
@@ -81,6 +157,9 @@ namespace eudaq {
     virtual void SendPacket(const unsigned char *data, size_t len,
                             const ConnectionInfo &id = ConnectionInfo::ALL,
                             bool = false);
+    virtual void SendPacket(const BufferSegment *segments, size_t nsegments,
+                            const ConnectionInfo &id = ConnectionInfo::ALL,
+                            bool = false);
     virtual void ProcessEvents(int timeout = -1);
 
   private:
@@ -193,6 +193,9 @@ namespace eudaq {
         //STANDARD SUBEVENT
         ///////////////////////////////////////
 
+        // pedestals and noise are accumulated over the events
+        virtual bool IsThreadSafe() const { return false; }
+
         //conversion from Raw to StandardPlane format
         virtual bool GetStandardSubEvent(StandardEvent & sev,const Event & ev) const {
 
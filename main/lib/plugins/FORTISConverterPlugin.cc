@@ -53,6 +53,9 @@ namespace eudaq {
 
       virtual bool GetStandardSubEvent(StandardEvent &, const eudaq::Event &) const;
 
+      // frames are buffered from one event to the next
+      virtual bool IsThreadSafe() const { return false; }
+
     private:
       StandardPlane ConvertPlane(const std::vector<unsigned char> & data, unsigned id) const;
       FORTISConverterPlugin() : DataConverterPlugin("FORTIS"),
@@ -3,6 +3,7 @@
 #include "eudaq/Utils.hh"
 #include "eudaq/Logger.hh"
 
+#include <array>
 #include <bitset>
 #include <boost/format.hpp>
 
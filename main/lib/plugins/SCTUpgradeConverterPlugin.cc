@@ -199,6 +199,9 @@ namespace eudaq {
 
       return returnValue;
     }
+    // The event queue and the last time stamps carry over between events
+    virtual bool IsThreadSafe() const { return false; }
+
     // Here, the data from the RawDataEvent is extracted into a StandardEvent.
     // The return value indicates whether the conversion was successful.
     // Again, this is just an example, adapted it for the actual data layout.
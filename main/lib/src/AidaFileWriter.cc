@@ -26,6 +26,7 @@ namespace eudaq {
     virtual ~AidaFileWriterNative();
 
   private:
+    FlushPolicy m_policy;
     FileSerializer *m_ser;
     FileSerializer *m_idx;
   };
@@ -34,8 +35,8 @@ namespace eudaq {
     static RegisterAidaFileWriter<AidaFileWriterNative> reg("native");
   }
 
-  AidaFileWriterNative::AidaFileWriterNative(const std::string & /*param*/)
-      : m_ser(0), m_idx(0) {
+  AidaFileWriterNative::AidaFileWriterNative(const std::string &param)
+      : m_policy(param), m_ser(0), m_idx(0) {
     // EUDAQ_DEBUG("Constructing AidaFileWriterNative(" + to_string(param) +
     // ")");
   }
@@ -43,12 +44,12 @@ namespace eudaq {
   void AidaFileWriterNative::StartRun(unsigned runnumber) {
     delete m_ser;
     delete m_idx;
-    m_ser = new FileSerializer(FileNamer(m_filepattern)
+    m_ser = m_policy.Open(FileNamer(m_filepattern)
                                    .Set('X', ".raw2")
                                    .Set('S', "_")
                                    .Set('N', 0)
                                    .Set('R', runnumber));
-    m_idx = new FileSerializer(
+    m_idx = m_policy.Open(
         FileNamer(m_filepattern).Set('X', ".idx").Set('R', runnumber));
 
     json header;
@@ -67,12 +68,14 @@ namespace eudaq {
     if (!m_idx)
       EUDAQ_THROW("AidaFileWriterNative: Attempt to write unopened index file");
     m_idx->write(AidaIndexData(*packet, 42 /* fileNo */, m_ser->FileBytes()));
-    m_idx->Flush();
 
     if (!m_ser)
       EUDAQ_THROW("AidaFileWriterNative: Attempt to write unopened file");
     m_ser->write(*packet);
-    m_ser->Flush();
+    if (m_policy.FlushDue(m_ser->FileBytes())) {
+      m_idx->Flush();
+      m_ser->Flush();
+    }
   }
 
   AidaFileWriterNative::~AidaFileWriterNative() {
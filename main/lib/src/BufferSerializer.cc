@@ -29,4 +29,60 @@ namespace eudaq {
     // std::cout << "Remaining: " << (end()-begin()) << /*" \"" << tmp << "\""
     // <<*/ std::endl;
   }
+
+  void BufferDeserializer::Deserialize(unsigned char *data, size_t len) {
+    if (!len)
+      return;
+    if (len > remaining()) {
+      EUDAQ_THROW("Deserialize asked for " + to_string(len) + ", only have " +
+                  to_string(remaining()));
+    }
+    std::copy(m_data + m_offset, m_data + m_offset + len, data);
+    m_offset += len;
+  }
+
+  const unsigned char *
+  BufferDeserializer::ReadReference(size_t len,
+                                    std::shared_ptr<const void> &owner) {
+    if (!m_owner || len > remaining())
+      return 0;
+    const unsigned char *ptr = m_data + m_offset;
+    m_offset += len;
+    owner = m_owner;
+    return ptr;
+  }
+
+  void GatherSerializer::SerializeReference(const unsigned char *data,
+                                            size_t len) {
+    if (len < m_threshold) {
+      Serialize(data, len);
+      return;
+    }
+    m_size += len;
+    Piece p = {data, 0, len};
+    m_pieces.push_back(p);
+  }
+
+  void GatherSerializer::Serialize(const unsigned char *data, size_t len) {
+    if (!len)
+      return;
+    m_size += len;
+    if (m_pieces.empty() || m_pieces.back().ref) {
+      Piece p = {0, m_data.size(), 0};
+      m_pieces.push_back(p);
+    }
+    m_data.insert(m_data.end(), data, data + len);
+    m_pieces.back().size += len;
+  }
+
+  std::vector<BufferSegment> GatherSerializer::Segments() const {
+    std::vector<BufferSegment> result;
+    result.reserve(m_pieces.size());
+    for (size_t i = 0; i < m_pieces.size(); ++i) {
+      const Piece &p = m_pieces[i];
+      result.push_back(
+          BufferSegment(p.ref ? p.ref : &m_data[p.offset], p.size));
+    }
+    return result;
+  }
 }
@@ -0,0 +1,158 @@
+#include "eudaq/Clustering.hh"
+#include "eudaq/StandardEvent.hh"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace eudaq {
+
+  namespace {
+
+    static const unsigned NOLABEL = (unsigned)-1;
+
+    /// The sweep order: frame (if clustered separately), then y, then x
+    struct HitOrder {
+      HitOrder(const int *x, const int *y, const int *f) : x(x), y(y), f(f) {}
+      bool Less(int fa, int ya, int xa, int fb, int yb, int xb) const {
+        if (fa != fb)
+          return fa < fb;
+        if (ya != yb)
+          return ya < yb;
+        return xa < xb;
+      }
+      int F(unsigned i) const { return f ? f[i] : 0; }
+      bool operator()(unsigned a, unsigned b) const {
+        return Less(F(a), y[a], x[a], F(b), y[b], x[b]);
+      }
+      const int *x, *y, *f;
+    };
+  }
+
+  unsigned PixelClusterer::Find(unsigned i) {
+    while (m_parent[i] != i) {
+      m_parent[i] = m_parent[m_parent[i]];
+      i = m_parent[i];
+    }
+    return i;
+  }
+
+  void PixelClusterer::Union(unsigned a, unsigned b) {
+    a = Find(a);
+    b = Find(b);
+    if (a < b)
+      m_parent[b] = a;
+    else if (b < a)
+      m_parent[a] = b;
+  }
+
+  size_t PixelClusterer::Cluster(const int *x, const int *y, const int *frame,
+                                 size_t n, std::vector<unsigned> &labels) {
+    labels.resize(n);
+    if (n == 0)
+      return 0;
+    const int *f = m_opts.separateframes ? frame : 0;
+    HitOrder order(x, y, f);
+    m_parent.resize(n);
+    m_order.resize(n);
+    bool sorted = true;
+    for (unsigned i = 0; i < n; ++i) {
+      m_parent[i] = i;
+      m_order[i] = i;
+      if (i && order(i, i - 1))
+        sorted = false;
+    }
+    if (!sorted)
+      std::sort(m_order.begin(), m_order.end(), order);
+
+    // For each row offset k = 0..maxdy, start[k] is the first hit at or
+    // after (frame, y - k, x - maxdx) of the current hit. These positions
+    // only move forward during the sweep, so each hit is compared with a
+    // bounded number of others.
+    const int maxdx = m_opts.maxdx, maxdy = m_opts.maxdy;
+    const int maxdist = std::max(maxdx, maxdy);
+    std::vector<size_t> start(maxdy + 1, 0);
+    for (size_t p = 0; p < n; ++p) {
+      unsigned h = m_order[p];
+      int fh = order.F(h), yh = y[h], xh = x[h];
+      for (int k = 0; k <= maxdy; ++k) {
+        size_t &q = start[k];
+        while (q < p) {
+          unsigned o = m_order[q];
+          if (!order.Less(order.F(o), y[o], x[o], fh, yh - k, xh - maxdx))
+            break;
+          ++q;
+        }
+        for (size_t r = q; r < p; ++r) {
+          unsigned o = m_order[r];
+          if (order.F(o) != fh || y[o] != yh - k || x[o] > xh + maxdx)
+            break;
+          if (!m_opts.diagonal && k + std::abs(x[o] - xh) > maxdist)
+            continue;
+          Union(o, h);
+        }
+      }
+    }
+
+    // number the clusters in the order of their first hit
+    m_roots.assign(n, NOLABEL);
+    size_t nclusters = 0;
+    for (unsigned i = 0; i < n; ++i) {
+      unsigned &root = m_roots[Find(i)];
+      if (root == NOLABEL)
+        root = (unsigned)nclusters++;
+      labels[i] = root;
+    }
+    return nclusters;
+  }
+
+  size_t PixelClusterer::Cluster(const StandardPlane &plane, unsigned frame,
+                                 std::vector<unsigned> &labels) {
+    const std::vector<StandardPlane::coord_t> &xs = plane.XVector(frame);
+    const std::vector<StandardPlane::coord_t> &ys = plane.YVector(frame);
+    m_x.assign(xs.begin(), xs.end());
+    m_y.assign(ys.begin(), ys.end());
+    return Cluster(m_x.data(), m_y.data(), 0, m_x.size(), labels);
+  }
+
+  size_t PixelClusterer::Cluster(const StandardPlane &plane,
+                                 std::vector<PixelCluster> &clusters) {
+    m_x.clear();
+    m_y.clear();
+    m_frame.clear();
+    m_pix.clear();
+    for (unsigned f = 0; f < plane.NumFrames(); ++f) {
+      const std::vector<StandardPlane::coord_t> &xs = plane.XVector(f);
+      const std::vector<StandardPlane::coord_t> &ys = plane.YVector(f);
+      const std::vector<StandardPlane::pixel_t> &pix = plane.PixVector(f);
+      m_x.insert(m_x.end(), xs.begin(), xs.end());
+      m_y.insert(m_y.end(), ys.begin(), ys.end());
+      m_pix.insert(m_pix.end(), pix.begin(), pix.end());
+      m_frame.resize(m_x.size(), (int)f);
+    }
+    std::vector<unsigned> labels;
+    size_t n = Cluster(m_x.data(), m_y.data(), m_frame.data(), m_x.size(),
+                       labels);
+    clusters.assign(n, PixelCluster());
+    for (size_t i = 0; i < labels.size(); ++i) {
+      PixelCluster &c = clusters[labels[i]];
+      if (c.npixels == 0) {
+        c.frame = (unsigned)m_frame[i];
+        c.xmin = c.xmax = m_x[i];
+        c.ymin = c.ymax = m_y[i];
+      }
+      ++c.npixels;
+      c.x += m_x[i];
+      c.y += m_y[i];
+      c.charge += m_pix[i];
+      c.xmin = std::min(c.xmin, m_x[i]);
+      c.xmax = std::max(c.xmax, m_x[i]);
+      c.ymin = std::min(c.ymin, m_y[i]);
+      c.ymax = std::max(c.ymax, m_y[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+      clusters[i].x /= clusters[i].npixels;
+      clusters[i].y /= clusters[i].npixels;
+    }
+    return n;
+  }
+}
@@ -0,0 +1,554 @@
+#include "eudaq/ColumnarFile.hh"
+#include "eudaq/FileSerializer.hh"
+#include "eudaq/Exception.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace eudaq {
+
+  namespace {
+
+    static const uint32_t FILE_MAGIC = 0x4C4F4345; // "ECOL"
+    // version 1 had no way to tell planes without hits from missing ones
+    static const uint32_t FILE_VERSION = 2;
+    static const uint32_t CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+    static const uint32_t NO_PLANE = 0xffffffff;
+    static const size_t GROUP = 128; // values sharing one bit width
+
+    // How the values of a column are stored before compression
+    enum Encoding {
+      ENC_PACKED = 0, ///< Unsigned integers, bit-packed
+      ENC_ZIGZAG = 1, ///< Signed integers, zigzag encoded and bit-packed
+      ENC_DELTA = 2,  ///< Differences to the previous value, as ENC_ZIGZAG
+      ENC_DOUBLE = 3  ///< Raw little-endian doubles
+    };
+
+    inline uint64_t zigzag(int64_t v) {
+      return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    }
+    inline int64_t unzigzag(uint64_t v) {
+      return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+
+    class BitWriter {
+    public:
+      explicit BitWriter(std::vector<unsigned char> &out)
+          : m_out(out), m_acc(0), m_bits(0) {}
+      void put(uint64_t v, unsigned bits) {
+        if (bits > 32) {
+          put32(v & 0xffffffff, 32);
+          put32(v >> 32, bits - 32);
+        } else {
+          put32(v, bits);
+        }
+      }
+      void flush() {
+        if (m_bits)
+          m_out.push_back((unsigned char)m_acc);
+        m_acc = 0;
+        m_bits = 0;
+      }
+
+    private:
+      void put32(uint64_t v, unsigned bits) {
+        m_acc |= v << m_bits;
+        m_bits += bits;
+        for (; m_bits >= 8; m_bits -= 8) {
+          m_out.push_back((unsigned char)m_acc);
+          m_acc >>= 8;
+        }
+      }
+      std::vector<unsigned char> &m_out;
+      uint64_t m_acc;
+      unsigned m_bits;
+    };
+
+    class BitReader {
+    public:
+      BitReader(const unsigned char *p, const unsigned char *end)
+          : m_p(p), m_end(end), m_acc(0), m_bits(0) {}
+      uint64_t get(unsigned bits) {
+        if (bits > 32) {
+          uint64_t lo = get32(32);
+          return lo | (get32(bits - 32) << 32);
+        }
+        return get32(bits);
+      }
+      void align() {
+        m_acc = 0;
+        m_bits = 0;
+      }
+      unsigned char byte() {
+        if (m_p >= m_end)
+          EUDAQ_THROW("Corrupt columnar data: truncated column");
+        return *m_p++;
+      }
+
+    private:
+      uint64_t get32(unsigned bits) {
+        while (m_bits < bits) {
+          m_acc |= (uint64_t)byte() << m_bits;
+          m_bits += 8;
+        }
+        uint64_t v = m_acc & ((uint64_t(1) << bits) - 1);
+        m_acc >>= bits;
+        m_bits -= bits;
+        return v;
+      }
+      const unsigned char *m_p, *m_end;
+      uint64_t m_acc;
+      unsigned m_bits;
+    };
+
+    unsigned bitwidth(uint64_t v) {
+      unsigned n = 0;
+      for (; v; v >>= 1)
+        ++n;
+      return n;
+    }
+
+    // Groups of GROUP values: one byte with the bit width, then the values
+    void pack(const std::vector<uint64_t> &v, std::vector<unsigned char> &out) {
+      out.clear();
+      BitWriter bw(out);
+      for (size_t g = 0; g < v.size(); g += GROUP) {
+        size_t n = std::min(GROUP, v.size() - g);
+        uint64_t all = 0;
+        for (size_t i = 0; i < n; ++i)
+          all |= v[g + i];
+        unsigned w = bitwidth(all);
+        out.push_back((unsigned char)w);
+        for (size_t i = 0; i < n; ++i)
+          bw.put(v[g + i], w);
+        bw.flush();
+      }
+    }
+
+    void unpack(const unsigned char *p, size_t len, size_t count,
+                std::vector<uint64_t> &v) {
+      v.resize(count);
+      BitReader br(p, p + len);
+      for (size_t g = 0; g < count; g += GROUP) {
+        size_t n = std::min(GROUP, count - g);
+        br.align();
+        unsigned w = br.byte();
+        if (w > 64)
+          EUDAQ_THROW("Corrupt columnar data: bad bit width");
+        for (size_t i = 0; i < n; ++i)
+          v[g + i] = w ? br.get(w) : 0;
+      }
+    }
+
+    struct Block {
+      uint32_t plane;
+      uint8_t column, encoding, codec;
+      uint32_t count, rawbytes;
+      std::vector<unsigned char> data;
+    };
+
+    void encode_ints(const std::vector<uint64_t> &v, Encoding enc,
+                     std::vector<unsigned char> &out) {
+      if (enc == ENC_PACKED) {
+        pack(v, out);
+        return;
+      }
+      std::vector<uint64_t> z(v.size());
+      uint64_t prev = 0;
+      for (size_t i = 0; i < v.size(); ++i) {
+        z[i] = zigzag(int64_t(enc == ENC_DELTA ? v[i] - prev : v[i]));
+        prev = v[i];
+      }
+      pack(z, out);
+    }
+
+    void decode_ints(const unsigned char *p, size_t len, size_t count,
+                     Encoding enc, std::vector<uint64_t> &v) {
+      unpack(p, len, count, v);
+      if (enc == ENC_PACKED)
+        return;
+      uint64_t prev = 0;
+      for (size_t i = 0; i < count; ++i) {
+        uint64_t d = (uint64_t)unzigzag(v[i]);
+        v[i] = enc == ENC_DELTA ? prev + d : d;
+        prev = v[i];
+      }
+    }
+
+    void encode_doubles(const std::vector<double> &v, Block &b) {
+      bool integral = true;
+      for (size_t i = 0; i < v.size() && integral; ++i) {
+        integral = std::fabs(v[i]) < 9007199254740992.0 && // 2^53
+                   v[i] == std::floor(v[i]);
+      }
+      if (integral) {
+        std::vector<uint64_t> iv(v.size());
+        for (size_t i = 0; i < v.size(); ++i)
+          iv[i] = (uint64_t)(int64_t)v[i];
+        std::vector<unsigned char> delta;
+        encode_ints(iv, ENC_ZIGZAG, b.data);
+        encode_ints(iv, ENC_DELTA, delta);
+        b.encoding = ENC_ZIGZAG;
+        if (delta.size() < b.data.size()) {
+          b.data.swap(delta);
+          b.encoding = ENC_DELTA;
+        }
+        return;
+      }
+      b.encoding = ENC_DOUBLE;
+      b.data.resize(v.size() * 8);
+      for (size_t i = 0; i < v.size(); ++i) {
+        uint64_t bits;
+        std::memcpy(&bits, &v[i], 8);
+        for (int k = 0; k < 8; ++k)
+          b.data[i * 8 + k] = (unsigned char)(bits >> (8 * k));
+      }
+    }
+
+    void decode_doubles(const unsigned char *p, size_t len, size_t count,
+                        Encoding enc, std::vector<double> &v) {
+      v.resize(count);
+      if (enc == ENC_DOUBLE) {
+        if (len != count * 8)
+          EUDAQ_THROW("Corrupt columnar data: bad column size");
+        for (size_t i = 0; i < count; ++i) {
+          uint64_t bits = 0;
+          for (int k = 0; k < 8; ++k)
+            bits |= (uint64_t)p[i * 8 + k] << (8 * k);
+          std::memcpy(&v[i], &bits, 8);
+        }
+        return;
+      }
+      std::vector<uint64_t> iv;
+      decode_ints(p, len, count, enc, iv);
+      for (size_t i = 0; i < count; ++i)
+        v[i] = (double)(int64_t)iv[i];
+    }
+  }
+
+  struct ColumnarChunk::Plane {
+    ColumnarPlane meta;
+    std::vector<bool> present;
+    std::vector<uint64_t> counts, frame;
+    std::vector<double> x, y, value;
+  };
+
+  ColumnarChunk::ColumnarChunk() {}
+
+  ColumnarChunk::~ColumnarChunk() {}
+
+  ColumnarChunk::Plane &ColumnarChunk::GetPlane(const StandardPlane &p) {
+    for (size_t i = 0; i < m_planes.size(); ++i) {
+      const ColumnarPlane &m = m_planes[i]->meta;
+      if (m.id == p.ID() && m.type == p.Type() && m.sensor == p.Sensor())
+        return *m_planes[i];
+    }
+    m_planes.push_back(std::unique_ptr<Plane>(new Plane));
+    ColumnarPlane &m = m_planes.back()->meta;
+    m.id = p.ID();
+    m.type = p.Type();
+    m.sensor = p.Sensor();
+    m.xsize = p.XSize();
+    m.ysize = p.YSize();
+    m.frames = p.NumFrames();
+    m.flags = p.GetFlags(~0);
+    return *m_planes.back();
+  }
+
+  void ColumnarChunk::AddEvent(const StandardEvent &ev) {
+    size_t ievent = m_eventnumbers.size();
+    m_eventnumbers.push_back(ev.GetEventNumber());
+    m_timestamps.push_back(ev.GetTimestamp());
+    for (size_t i = 0; i < ev.NumPlanes(); ++i) {
+      const StandardPlane &p = ev.GetPlane(i);
+      Plane &pl = GetPlane(p);
+      pl.meta.frames = std::max(pl.meta.frames, p.NumFrames());
+      pl.counts.resize(ievent + 1, 0);
+      pl.present.resize(ievent + 1, false);
+      pl.present[ievent] = true;
+      for (unsigned f = 0; f < p.NumFrames(); ++f) {
+        unsigned n = p.HitPixels(f);
+        for (unsigned h = 0; h < n; ++h) {
+          pl.x.push_back(p.GetX(h, f));
+          pl.y.push_back(p.GetY(h, f));
+          pl.value.push_back(p.GetPixel(h, f));
+          pl.frame.push_back(f);
+        }
+        pl.counts[ievent] += n;
+      }
+    }
+  }
+
+  void ColumnarChunk::WriteHeader(Serializer &ser, unsigned runnumber) {
+    ser.write(FILE_MAGIC);
+    ser.write(FILE_VERSION);
+    ser.write(runnumber);
+  }
+
+  void ColumnarChunk::Write(Serializer &ser, CompressionCodec codec) {
+    const size_t nevents = m_eventnumbers.size();
+    std::vector<Block> blocks;
+    std::vector<unsigned char> packed;
+    Block b;
+    b.plane = NO_PLANE;
+    b.count = (uint32_t)nevents;
+    b.column = COL_EVENTNUMBER;
+    b.encoding = ENC_DELTA;
+    encode_ints(m_eventnumbers, ENC_DELTA, b.data);
+    blocks.push_back(b);
+    b.column = COL_TIMESTAMP;
+    encode_ints(m_timestamps, ENC_DELTA, b.data);
+    blocks.push_back(b);
+    for (size_t i = 0; i < m_planes.size(); ++i) {
+      Plane &pl = *m_planes[i];
+      // the number of hits + 1, or 0 if the plane was not in the event
+      std::vector<uint64_t> hits(nevents, 0);
+      for (size_t k = 0; k < pl.counts.size(); ++k) {
+        if (pl.present[k])
+          hits[k] = pl.counts[k] + 1;
+      }
+      b.plane = (uint32_t)i;
+      b.count = (uint32_t)nevents;
+      b.column = COL_HITS;
+      b.encoding = ENC_PACKED;
+      encode_ints(hits, ENC_PACKED, b.data);
+      blocks.push_back(b);
+      b.count = (uint32_t)pl.x.size();
+      b.column = COL_FRAME;
+      b.encoding = ENC_PACKED;
+      encode_ints(pl.frame, ENC_PACKED, b.data);
+      blocks.push_back(b);
+      b.column = COL_X;
+      encode_doubles(pl.x, b);
+      blocks.push_back(b);
+      b.column = COL_Y;
+      encode_doubles(pl.y, b);
+      blocks.push_back(b);
+      b.column = COL_VALUE;
+      encode_doubles(pl.value, b);
+      blocks.push_back(b);
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      Block &blk = blocks[i];
+      blk.rawbytes = (uint32_t)blk.data.size();
+      blk.codec = COMPRESS_NONE;
+      if (Compress(codec, blk.data.data(), blk.data.size(), packed)) {
+        blk.codec = (uint8_t)codec;
+        blk.data.swap(packed);
+      }
+    }
+
+    ser.write(CHUNK_MAGIC);
+    ser.write((uint32_t)nevents);
+    ser.write((uint32_t)m_planes.size());
+    for (size_t i = 0; i < m_planes.size(); ++i) {
+      const ColumnarPlane &m = m_planes[i]->meta;
+      ser.write(m.id);
+      ser.write(m.type);
+      ser.write(m.sensor);
+      ser.write(m.xsize);
+      ser.write(m.ysize);
+      ser.write(m.frames);
+      ser.write(m.flags);
+    }
+    ser.write((uint32_t)blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      const Block &blk = blocks[i];
+      ser.write(blk.plane);
+      ser.write(blk.column);
+      ser.write(blk.encoding);
+      ser.write(blk.codec);
+      ser.write(blk.count);
+      ser.write(blk.rawbytes);
+      ser.write((uint32_t)blk.data.size());
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      if (!blocks[i].data.empty())
+        ser.append(blocks[i].data.data(), blocks[i].data.size());
+    }
+
+    m_eventnumbers.clear();
+    m_timestamps.clear();
+    m_planes.clear();
+  }
+
+  ColumnarFileReader::ColumnarFileReader(const std::string &filename,
+                                         int columns,
+                                         const std::vector<unsigned> &planes)
+      : m_des(new FileDeserializer(filename)), m_columns(columns),
+        m_planeids(planes), m_version(0), m_runnumber(0), m_bytesread(0) {
+    if (m_columns & (COL_FRAME | COL_X | COL_Y | COL_VALUE))
+      m_columns |= COL_HITS;
+    m_columns |= COL_EVENTNUMBER | COL_TIMESTAMP;
+    uint32_t magic = 0;
+    m_des->read(magic);
+    m_des->read(m_version);
+    if (magic != FILE_MAGIC)
+      EUDAQ_THROW("Not a columnar file: " + filename);
+    if (m_version < 1 || m_version > FILE_VERSION)
+      EUDAQ_THROW("Unsupported columnar file version " +
+                  to_string(m_version));
+    m_des->read(m_runnumber);
+  }
+
+  ColumnarFileReader::~ColumnarFileReader() {}
+
+  bool ColumnarFileReader::NextChunk() {
+    m_eventnumbers.clear();
+    m_timestamps.clear();
+    m_planes.clear();
+    if (!m_des->HasData())
+      return false;
+    uint32_t magic = 0, nevents = 0, nplanes = 0, nblocks = 0;
+    m_des->read(magic);
+    if (magic != CHUNK_MAGIC)
+      EUDAQ_THROW("Corrupt columnar file: bad chunk header");
+    m_des->read(nevents);
+    m_des->read(nplanes);
+    std::vector<ColumnarPlane> planes(nplanes);
+    std::vector<bool> wanted(nplanes, true);
+    for (size_t i = 0; i < nplanes; ++i) {
+      ColumnarPlane &m = planes[i];
+      m_des->read(m.id);
+      m_des->read(m.type);
+      m_des->read(m.sensor);
+      m_des->read(m.xsize);
+      m_des->read(m.ysize);
+      m_des->read(m.frames);
+      m_des->read(m.flags);
+      if (!m_planeids.empty())
+        wanted[i] = std::find(m_planeids.begin(), m_planeids.end(), m.id) !=
+                    m_planeids.end();
+    }
+    m_des->read(nblocks);
+    std::vector<Block> blocks(nblocks);
+    std::vector<uint32_t> stored(nblocks);
+    for (size_t i = 0; i < nblocks; ++i) {
+      Block &blk = blocks[i];
+      m_des->read(blk.plane);
+      m_des->read(blk.column);
+      m_des->read(blk.encoding);
+      m_des->read(blk.codec);
+      m_des->read(blk.count);
+      m_des->read(blk.rawbytes);
+      m_des->read(stored[i]);
+      if (blk.plane != NO_PLANE && blk.plane >= nplanes)
+        EUDAQ_THROW("Corrupt columnar file: bad plane index");
+    }
+
+    std::vector<unsigned char> raw;
+    for (size_t i = 0; i < nblocks; ++i) {
+      Block &blk = blocks[i];
+      if (!(m_columns & blk.column) ||
+          (blk.plane != NO_PLANE && !wanted[blk.plane])) {
+        m_des->Skip(stored[i]);
+        continue;
+      }
+      blk.data.resize(stored[i]);
+      if (stored[i])
+        m_des->read(&blk.data[0], stored[i]);
+      m_bytesread += stored[i];
+      raw.resize(blk.rawbytes);
+      Decompress((CompressionCodec)blk.codec, blk.data.data(), stored[i],
+                 raw.data(), raw.size());
+      const Encoding enc = (Encoding)blk.encoding;
+      std::vector<uint64_t> iv;
+      if (blk.plane == NO_PLANE) {
+        if (blk.count != nevents)
+          EUDAQ_THROW("Corrupt columnar file: bad event column");
+        decode_ints(raw.data(), raw.size(), blk.count, enc,
+                    blk.column == COL_EVENTNUMBER ? m_eventnumbers
+                                                  : m_timestamps);
+        continue;
+      }
+      ColumnarPlane &m = planes[blk.plane];
+      switch (blk.column) {
+      case COL_HITS:
+        if (blk.count != nevents)
+          EUDAQ_THROW("Corrupt columnar file: bad hits column");
+        decode_ints(raw.data(), raw.size(), blk.count, enc, iv);
+        m.offsets.resize(iv.size() + 1);
+        m.present.assign(iv.size(), true);
+        m.offsets[0] = 0;
+        for (size_t k = 0; k < iv.size(); ++k) {
+          uint64_t n = iv[k];
+          if (m_version >= 2) {
+            m.present[k] = n != 0;
+            n = n ? n - 1 : 0;
+          }
+          m.offsets[k + 1] = m.offsets[k] + (uint32_t)n;
+        }
+        break;
+      case COL_FRAME:
+        decode_ints(raw.data(), raw.size(), blk.count, enc, iv);
+        m.frame.assign(iv.begin(), iv.end());
+        break;
+      case COL_X:
+        decode_doubles(raw.data(), raw.size(), blk.count, enc, m.x);
+        break;
+      case COL_Y:
+        decode_doubles(raw.data(), raw.size(), blk.count, enc, m.y);
+        break;
+      case COL_VALUE:
+        decode_doubles(raw.data(), raw.size(), blk.count, enc, m.value);
+        break;
+      }
+    }
+    if (m_eventnumbers.size() != nevents || m_timestamps.size() != nevents)
+      EUDAQ_THROW("Corrupt columnar file: missing event column");
+    for (size_t i = 0; i < nplanes; ++i) {
+      if (!wanted[i])
+        continue;
+      const ColumnarPlane &m = planes[i];
+      if (m_columns & COL_HITS) {
+        if (m.offsets.size() != nevents + 1)
+          EUDAQ_THROW("Corrupt columnar file: missing hits column");
+        const size_t nhits = m.offsets.back();
+        if ((!m.frame.empty() && m.frame.size() != nhits) ||
+            (!m.x.empty() && m.x.size() != nhits) ||
+            (!m.y.empty() && m.y.size() != nhits) ||
+            (!m.value.empty() && m.value.size() != nhits))
+          EUDAQ_THROW("Corrupt columnar file: hit columns do not match");
+      }
+      m_planes.push_back(planes[i]);
+    }
+    return true;
+  }
+
+  const ColumnarPlane *ColumnarFileReader::FindPlane(unsigned id) const {
+    for (size_t i = 0; i < m_planes.size(); ++i) {
+      if (m_planes[i].id == id)
+        return &m_planes[i];
+    }
+    return 0;
+  }
+
+  StandardEvent ColumnarFileReader::GetStandardEvent(size_t i) const {
+    if (i >= NumEvents())
+      EUDAQ_THROW("No event " + to_string(i) + " in the chunk");
+    StandardEvent sev(m_runnumber, GetEventNumber(i), GetTimestamp(i));
+    for (size_t ip = 0; ip < m_planes.size(); ++ip) {
+      const ColumnarPlane &m = m_planes[ip];
+      if (!m.present.empty() && !m.present[i])
+        continue;
+      StandardPlane plane(m.id, m.type, m.sensor);
+      // pivot flags are not stored, and every frame has its own hits
+      int flags = m.flags & ~StandardPlane::FLAG_WITHPIVOT;
+      if (m.frames > 1)
+        flags |= StandardPlane::FLAG_DIFFCOORDS;
+      plane.SetSizeZS(m.xsize, m.ysize, 0, m.frames, flags);
+      if (!m.offsets.empty()) {
+        // the coordinates may be fractional (ENC_DOUBLE)
+        for (uint32_t h = m.offsets[i]; h < m.offsets[i + 1]; ++h) {
+          plane.PushPixelHelper(m.x.empty() ? 0.0 : m.x[h],
+                                m.y.empty() ? 0.0 : m.y[h],
+                                m.value.empty() ? 0.0 : m.value[h], false,
+                                m.frame.empty() ? 0 : m.frame[h]);
+        }
+      }
+      sev.AddPlane(plane);
+    }
+    return sev;
+  }
+}
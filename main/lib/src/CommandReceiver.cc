@@ -6,6 +6,7 @@
 #include "eudaq/Logger.hh"
 #include "eudaq/Utils.hh"
 #include "eudaq/CommandReceiver.hh"
+#include "eudaq/Instrumentation.hh"
 #include <iostream>
 #include <ostream>
 
@@ -144,6 +145,18 @@ namespace eudaq {
         if (m_name != "")
           section += "." + m_name;
         Configuration conf(param, section);
+        // the dump is shared by all components in the process, so it is
+        // only started (or stopped, with an empty name) where it is set
+        std::string dump;
+        bool setdump = true;
+        try {
+          dump = conf["LatencyDump"];
+        } catch (const Exception &) {
+          setdump = false;
+        }
+        if (setdump)
+          Instrumentation::StartDump(dump,
+                                     conf.Get("LatencyDumpInterval", 10.0));
         OnConfigure(conf);
       } else if (cmd == "PREPARE") {
         OnPrepareRun(from_string(param, 0));
@@ -157,6 +170,7 @@ namespace eudaq {
         OnReset();
       } else if (cmd == "STATUS") {
         OnStatus();
+        Instrumentation::FillStatus(m_status);
       } else if (cmd == "DATA") {
         OnData(param);
       } else if (cmd == "LOG") {
@@ -0,0 +1,335 @@
+#include "eudaq/CompactStandardEvent.hh"
+#include "eudaq/Exception.hh"
+
+#include <limits>
+
+namespace eudaq {
+
+  EUDAQ_DEFINE_EVENT(CompactStandardEvent, str2id("_STC"));
+
+  namespace {
+
+    // Concatenate the frames, recording where each one starts
+    template <typename T, typename U>
+    void flatten(const std::vector<std::vector<T>> &frames,
+                 std::vector<uint32_t> &offsets, std::vector<U> &flat) {
+      size_t total = 0;
+      for (size_t f = 0; f < frames.size(); ++f) {
+        total += frames[f].size();
+      }
+      offsets.resize(frames.size() + 1);
+      flat.resize(0);
+      flat.reserve(total);
+      offsets[0] = 0;
+      for (size_t f = 0; f < frames.size(); ++f) {
+        flat.insert(flat.end(), frames[f].begin(), frames[f].end());
+        offsets[f + 1] = (uint32_t)flat.size();
+      }
+    }
+
+    template <typename T, typename U>
+    void unflatten(const std::vector<uint32_t> &offsets,
+                   const std::vector<U> &flat,
+                   std::vector<std::vector<T>> &frames) {
+      frames.resize(offsets.empty() ? 0 : offsets.size() - 1);
+      for (size_t f = 0; f < frames.size(); ++f) {
+        frames[f].assign(flat.begin() + offsets[f],
+                         flat.begin() + offsets[f + 1]);
+      }
+    }
+
+    template <typename T> bool fits(const std::vector<double> &values) {
+      for (size_t i = 0; i < values.size(); ++i) {
+        const double v = values[i];
+        if (!(v >= std::numeric_limits<T>::min() &&
+              v <= std::numeric_limits<T>::max() && v == (double)(T)v))
+          return false;
+      }
+      return true;
+    }
+
+    bool binary(const std::vector<double> &values) {
+      for (size_t i = 0; i < values.size(); ++i) {
+        if (values[i] != 1.0)
+          return false;
+      }
+      return true;
+    }
+  }
+
+  CompactPlane::CompactPlane()
+      : m_id(0), m_tluevent(0), m_xsize(0), m_ysize(0), m_flags(0),
+        m_pivotpixel(0), m_pixtype(PIX_BINARY), m_widecoords(false),
+        m_pixoffsets(1, 0), m_coordoffsets(1, 0) {}
+
+  CompactPlane::CompactPlane(const StandardPlane &plane)
+      : m_type(plane.m_type), m_sensor(plane.m_sensor), m_id(plane.m_id),
+        m_tluevent(plane.m_tluevent), m_xsize(plane.m_xsize),
+        m_ysize(plane.m_ysize), m_flags(plane.m_flags),
+        m_pivotpixel(plane.m_pivotpixel), m_pixtype(PIX_BINARY),
+        m_widecoords(false), m_mat(plane.m_mat) {
+    if (plane.m_x.size() != plane.m_y.size())
+      EUDAQ_THROW("CompactPlane: X and Y have different numbers of frames");
+    for (size_t f = 0; f < plane.m_x.size(); ++f) {
+      if (plane.m_x[f].size() != plane.m_y[f].size())
+        EUDAQ_THROW("CompactPlane: X and Y have different sizes");
+    }
+    std::vector<double> flat;
+    flatten(plane.m_x, m_coordoffsets, flat);
+    std::vector<uint32_t> offsets;
+    std::vector<double> flaty;
+    flatten(plane.m_y, offsets, flaty);
+    if (fits<uint16_t>(flat) && fits<uint16_t>(flaty)) {
+      m_x.assign(flat.begin(), flat.end());
+      m_y.assign(flaty.begin(), flaty.end());
+    } else {
+      m_widecoords = true;
+      m_xd.swap(flat);
+      m_yd.swap(flaty);
+    }
+
+    flatten(plane.m_pix, m_pixoffsets, flat);
+    if (binary(flat)) {
+      m_pixtype = PIX_BINARY;
+    } else if (fits<uint8_t>(flat)) {
+      m_pixtype = PIX_UINT8;
+      m_pix8.assign(flat.begin(), flat.end());
+    } else if (fits<uint16_t>(flat)) {
+      m_pixtype = PIX_UINT16;
+      m_pix16.assign(flat.begin(), flat.end());
+    } else if (fits<int32_t>(flat)) {
+      m_pixtype = PIX_INT32;
+      m_pix32.assign(flat.begin(), flat.end());
+    } else {
+      m_pixtype = PIX_DOUBLE;
+      m_pixd.swap(flat);
+    }
+
+    flatten(plane.m_pivot, m_pivotoffsets, m_pivot);
+  }
+
+  CompactPlane::CompactPlane(Deserializer &ds) {
+    ds.read(m_type);
+    ds.read(m_sensor);
+    ds.read(m_id);
+    ds.read(m_tluevent);
+    ds.read(m_xsize);
+    ds.read(m_ysize);
+    ds.read(m_flags);
+    ds.read(m_pivotpixel);
+    ds.read(m_pixtype);
+    ds.read(m_widecoords);
+    ds.read(m_coordoffsets);
+    if (m_widecoords) {
+      ds.read(m_xd);
+      ds.read(m_yd);
+    } else {
+      ds.read(m_x);
+      ds.read(m_y);
+    }
+    ds.read(m_pixoffsets);
+    switch (m_pixtype) {
+    case PIX_BINARY:
+      break;
+    case PIX_UINT8:
+      ds.read(m_pix8);
+      break;
+    case PIX_UINT16:
+      ds.read(m_pix16);
+      break;
+    case PIX_INT32:
+      ds.read(m_pix32);
+      break;
+    case PIX_DOUBLE:
+      ds.read(m_pixd);
+      break;
+    default:
+      EUDAQ_THROW("CompactPlane: Unknown pixel type " +
+                  to_string((unsigned)m_pixtype));
+    }
+    ds.read(m_pivotoffsets);
+    ds.read(m_pivot);
+    ds.read(m_mat);
+    if (m_pixoffsets.empty() || m_coordoffsets.empty())
+      EUDAQ_THROW("CompactPlane: Corrupt frame offsets");
+  }
+
+  void CompactPlane::Serialize(Serializer &ser) const {
+    ser.write(m_type);
+    ser.write(m_sensor);
+    ser.write(m_id);
+    ser.write(m_tluevent);
+    ser.write(m_xsize);
+    ser.write(m_ysize);
+    ser.write(m_flags);
+    ser.write(m_pivotpixel);
+    ser.write(m_pixtype);
+    ser.write(m_widecoords);
+    ser.write(m_coordoffsets);
+    if (m_widecoords) {
+      ser.write(m_xd);
+      ser.write(m_yd);
+    } else {
+      ser.write(m_x);
+      ser.write(m_y);
+    }
+    ser.write(m_pixoffsets);
+    switch (m_pixtype) {
+    case PIX_UINT8:
+      ser.write(m_pix8);
+      break;
+    case PIX_UINT16:
+      ser.write(m_pix16);
+      break;
+    case PIX_INT32:
+      ser.write(m_pix32);
+      break;
+    case PIX_DOUBLE:
+      ser.write(m_pixd);
+      break;
+    }
+    ser.write(m_pivotoffsets);
+    ser.write(m_pivot);
+    ser.write(m_mat);
+  }
+
+  StandardPlane CompactPlane::ToStandard() const {
+    StandardPlane plane(m_id, m_type, m_sensor);
+    plane.m_tluevent = m_tluevent;
+    plane.m_xsize = m_xsize;
+    plane.m_ysize = m_ysize;
+    plane.m_flags = m_flags;
+    plane.m_pivotpixel = m_pivotpixel;
+    if (m_widecoords) {
+      unflatten(m_coordoffsets, m_xd, plane.m_x);
+      unflatten(m_coordoffsets, m_yd, plane.m_y);
+    } else {
+      unflatten(m_coordoffsets, m_x, plane.m_x);
+      unflatten(m_coordoffsets, m_y, plane.m_y);
+    }
+    switch (m_pixtype) {
+    case PIX_BINARY:
+      plane.m_pix.resize(NumFrames());
+      for (unsigned f = 0; f < NumFrames(); ++f) {
+        plane.m_pix[f].assign(HitPixels(f), 1.0);
+      }
+      break;
+    case PIX_UINT8:
+      unflatten(m_pixoffsets, m_pix8, plane.m_pix);
+      break;
+    case PIX_UINT16:
+      unflatten(m_pixoffsets, m_pix16, plane.m_pix);
+      break;
+    case PIX_INT32:
+      unflatten(m_pixoffsets, m_pix32, plane.m_pix);
+      break;
+    case PIX_DOUBLE:
+      unflatten(m_pixoffsets, m_pixd, plane.m_pix);
+      break;
+    }
+    plane.m_pivot.resize(m_pivotoffsets.empty() ? 0
+                                                : m_pivotoffsets.size() - 1);
+    for (size_t f = 0; f < plane.m_pivot.size(); ++f) {
+      plane.m_pivot[f].assign(m_pivot.begin() + m_pivotoffsets[f],
+                              m_pivot.begin() + m_pivotoffsets[f + 1]);
+    }
+    plane.m_mat = m_mat;
+    return plane;
+  }
+
+  unsigned CompactPlane::HitPixels(unsigned frame) const {
+    if (frame >= NumFrames())
+      EUDAQ_THROW("Bad frame number " + to_string(frame) + " in HitPixels");
+    return m_pixoffsets[frame + 1] - m_pixoffsets[frame];
+  }
+
+  size_t CompactPlane::CoordIndex(unsigned index, unsigned frame) const {
+    if (!GetFlags(StandardPlane::FLAG_DIFFCOORDS))
+      frame = 0;
+    if (frame + 1 >= m_coordoffsets.size() ||
+        index >= m_coordoffsets[frame + 1] - m_coordoffsets[frame])
+      EUDAQ_THROW("Bad pixel " + to_string(index) + " in frame " +
+                  to_string(frame));
+    return m_coordoffsets[frame] + index;
+  }
+
+  double CompactPlane::GetX(unsigned index, unsigned frame) const {
+    const size_t i = CoordIndex(index, frame);
+    return m_widecoords ? m_xd[i] : m_x[i];
+  }
+
+  double CompactPlane::GetY(unsigned index, unsigned frame) const {
+    const size_t i = CoordIndex(index, frame);
+    return m_widecoords ? m_yd[i] : m_y[i];
+  }
+
+  double CompactPlane::GetPixel(unsigned index, unsigned frame) const {
+    if (index >= HitPixels(frame))
+      EUDAQ_THROW("Bad pixel " + to_string(index) + " in frame " +
+                  to_string(frame));
+    const size_t i = m_pixoffsets[frame] + index;
+    switch (m_pixtype) {
+    case PIX_UINT8:
+      return m_pix8[i];
+    case PIX_UINT16:
+      return m_pix16[i];
+    case PIX_INT32:
+      return m_pix32[i];
+    case PIX_DOUBLE:
+      return m_pixd[i];
+    }
+    return 1.0;
+  }
+
+  bool CompactPlane::GetPivot(unsigned index, unsigned frame) const {
+    if (!GetFlags(StandardPlane::FLAG_DIFFCOORDS))
+      frame = 0;
+    if (frame + 1 >= m_pivotoffsets.size() ||
+        index >= m_pivotoffsets[frame + 1] - m_pivotoffsets[frame])
+      EUDAQ_THROW("Bad pixel " + to_string(index) + " in frame " +
+                  to_string(frame));
+    return m_pivot[m_pivotoffsets[frame] + index] != 0;
+  }
+
+  void CompactPlane::Print(std::ostream &os) const {
+    static const char *const PIXTYPES[] = {"binary", "uint8", "uint16",
+                                           "int32", "double"};
+    os << m_id << ", " << m_type << ":" << m_sensor << ", " << m_xsize << "x"
+       << m_ysize << "x" << NumFrames() << " ("
+       << (NumFrames() ? HitPixels(0) : 0) << "), tlu=" << m_tluevent
+       << ", pivot=" << m_pivotpixel << ", " << PIXTYPES[m_pixtype];
+  }
+
+  CompactStandardEvent::CompactStandardEvent(const StandardEvent &sev)
+      : Event(sev) {
+    m_planes.reserve(sev.NumPlanes());
+    for (size_t i = 0; i < sev.NumPlanes(); ++i) {
+      m_planes.push_back(CompactPlane(sev.GetPlane(i)));
+    }
+  }
+
+  CompactStandardEvent::CompactStandardEvent(Deserializer &ds) : Event(ds) {
+    ds.read(m_planes);
+  }
+
+  void CompactStandardEvent::Serialize(Serializer &ser) const {
+    Event::Serialize(ser);
+    ser.write(m_planes);
+  }
+
+  StandardEvent CompactStandardEvent::ToStandard() const {
+    StandardEvent sev(*this);
+    for (size_t i = 0; i < m_planes.size(); ++i) {
+      sev.AddPlane(m_planes[i].ToStandard());
+    }
+    return sev;
+  }
+
+  void CompactStandardEvent::Print(std::ostream &os) const {
+    Event::Print(os);
+    os << ", " << m_planes.size() << " planes:\n";
+    for (size_t i = 0; i < m_planes.size(); ++i) {
+      os << "  " << m_planes[i] << "\n";
+    }
+  }
+}
@@ -0,0 +1,269 @@
+#include "eudaq/Compression.hh"
+#include "eudaq/Exception.hh"
+#include "eudaq/Utils.hh"
+
+#include <cstring>
+
+#ifdef EUDAQ_USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef EUDAQ_USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace eudaq {
+
+  namespace {
+
+    // The built-in codec writes a sequence of
+    //   token, [literal length], literals, offset, [match length]
+    // where the token holds the literal length in the high and the match
+    // length - 4 in the low nibble, 15 meaning that more length bytes
+    // follow (each adding up to 255). The data ends after a match or with
+    // a sequence without one.
+    static const size_t MIN_MATCH = 4;
+    static const size_t HASH_BITS = 14;
+    static const size_t MAX_OFFSET = 65535;
+
+    inline uint32_t read32(const unsigned char *p) {
+      uint32_t v;
+      std::memcpy(&v, p, sizeof v);
+      return v;
+    }
+
+    inline size_t hash(uint32_t v) {
+      return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    void put_length(std::vector<unsigned char> &out, size_t len) {
+      for (; len >= 255; len -= 255)
+        out.push_back(255);
+      out.push_back((unsigned char)len);
+    }
+
+    void put_sequence(std::vector<unsigned char> &out,
+                      const unsigned char *lit, size_t nlit, size_t offset,
+                      size_t matchlen) {
+      size_t ml = matchlen ? matchlen - MIN_MATCH : 0;
+      out.push_back((unsigned char)(((nlit < 15 ? nlit : 15) << 4) |
+                                    (ml < 15 ? ml : 15)));
+      if (nlit >= 15)
+        put_length(out, nlit - 15);
+      out.insert(out.end(), lit, lit + nlit);
+      if (!matchlen)
+        return;
+      out.push_back((unsigned char)(offset & 0xff));
+      out.push_back((unsigned char)(offset >> 8));
+      if (ml >= 15)
+        put_length(out, ml - 15);
+    }
+
+    void fast_compress(const unsigned char *in, size_t len,
+                       std::vector<unsigned char> &out) {
+      out.clear();
+      if (len == 0)
+        return;
+      out.reserve(len);
+      // positions + 1, so that 0 means empty
+      std::vector<size_t> table(size_t(1) << HASH_BITS, 0);
+      size_t i = 0, anchor = 0;
+      while (len >= MIN_MATCH && i <= len - MIN_MATCH) {
+        uint32_t seq = read32(in + i);
+        size_t &slot = table[hash(seq)];
+        size_t ref = slot;
+        slot = i + 1;
+        if (ref && i - (ref - 1) <= MAX_OFFSET && read32(in + ref - 1) == seq) {
+          --ref;
+          size_t n = MIN_MATCH;
+          while (i + n < len && in[ref + n] == in[i + n])
+            ++n;
+          put_sequence(out, in + anchor, i - anchor, i - ref, n);
+          i += n;
+          anchor = i;
+          if (out.size() >= len)
+            return; // not worth it, the caller checks the size
+        } else {
+          ++i;
+        }
+      }
+      if (anchor < len)
+        put_sequence(out, in + anchor, len - anchor, 0, 0);
+    }
+
+    size_t get_length(const unsigned char *&ip, const unsigned char *end) {
+      size_t len = 0;
+      unsigned char b;
+      do {
+        if (ip >= end)
+          EUDAQ_THROW("Corrupt compressed data: truncated length");
+        b = *ip++;
+        len += b;
+      } while (b == 255);
+      return len;
+    }
+
+    void fast_decompress(const unsigned char *ip, size_t len,
+                         unsigned char *out, size_t rawlen) {
+      const unsigned char *end = ip + len;
+      size_t op = 0;
+      while (op < rawlen) {
+        if (ip >= end)
+          EUDAQ_THROW("Corrupt compressed data: truncated sequence");
+        unsigned char token = *ip++;
+        size_t nlit = token >> 4;
+        if (nlit == 15)
+          nlit += get_length(ip, end);
+        if (nlit > size_t(end - ip) || nlit > rawlen - op)
+          EUDAQ_THROW("Corrupt compressed data: literals out of range");
+        std::memcpy(out + op, ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (op == rawlen)
+          break;
+        if (end - ip < 2)
+          EUDAQ_THROW("Corrupt compressed data: truncated offset");
+        size_t offset = ip[0] | (size_t(ip[1]) << 8);
+        ip += 2;
+        size_t n = (token & 15);
+        if (n == 15)
+          n += get_length(ip, end);
+        n += MIN_MATCH;
+        if (offset == 0 || offset > op || n > rawlen - op)
+          EUDAQ_THROW("Corrupt compressed data: match out of range");
+        // byte by byte, the match may overlap the output
+        const unsigned char *src = out + op - offset;
+        for (size_t k = 0; k < n; ++k)
+          out[op + k] = src[k];
+        op += n;
+      }
+      if (ip != end)
+        EUDAQ_THROW("Corrupt compressed data: trailing bytes");
+    }
+  }
+
+  bool CompressionAvailable(CompressionCodec codec) {
+    switch (codec) {
+    case COMPRESS_NONE:
+    case COMPRESS_FAST:
+      return true;
+#ifdef EUDAQ_USE_ZLIB
+    case COMPRESS_ZLIB:
+      return true;
+#endif
+#ifdef EUDAQ_USE_ZSTD
+    case COMPRESS_ZSTD:
+      return true;
+#endif
+    default:
+      return false;
+    }
+  }
+
+  CompressionCodec DefaultCompression() {
+    // always available, so files can be read by every build
+    return COMPRESS_FAST;
+  }
+
+  CompressionCodec CompressionFromName(const std::string &name) {
+    std::string n = lcase(name);
+    CompressionCodec codec;
+    if (n == "")
+      return DefaultCompression();
+    else if (n == "none")
+      codec = COMPRESS_NONE;
+    else if (n == "fast")
+      codec = COMPRESS_FAST;
+    else if (n == "zlib")
+      codec = COMPRESS_ZLIB;
+    else if (n == "zstd")
+      codec = COMPRESS_ZSTD;
+    else
+      EUDAQ_THROW("Unknown compression: " + name);
+    if (!CompressionAvailable(codec))
+      EUDAQ_THROW("Compression not available in this build: " + name);
+    return codec;
+  }
+
+  std::string CompressionName(CompressionCodec codec) {
+    switch (codec) {
+    case COMPRESS_NONE:
+      return "none";
+    case COMPRESS_FAST:
+      return "fast";
+    case COMPRESS_ZLIB:
+      return "zlib";
+    case COMPRESS_ZSTD:
+      return "zstd";
+    }
+    return "unknown(" + to_string((int)codec) + ")";
+  }
+
+  bool Compress(CompressionCodec codec, const unsigned char *data, size_t len,
+                std::vector<unsigned char> &out) {
+    switch (codec) {
+    case COMPRESS_NONE:
+      return false;
+    case COMPRESS_FAST:
+      fast_compress(data, len, out);
+      break;
+#ifdef EUDAQ_USE_ZLIB
+    case COMPRESS_ZLIB: {
+      uLongf size = compressBound(len);
+      out.resize(size);
+      if (compress2(&out[0], &size, data, len, Z_BEST_SPEED) != Z_OK)
+        EUDAQ_THROW("zlib compression failed");
+      out.resize(size);
+      break;
+    }
+#endif
+#ifdef EUDAQ_USE_ZSTD
+    case COMPRESS_ZSTD: {
+      out.resize(ZSTD_compressBound(len));
+      size_t size = ZSTD_compress(&out[0], out.size(), data, len, 1);
+      if (ZSTD_isError(size))
+        EUDAQ_THROW(std::string("zstd compression failed: ") +
+                    ZSTD_getErrorName(size));
+      out.resize(size);
+      break;
+    }
+#endif
+    default:
+      EUDAQ_THROW("Compression not available in this build: " +
+                  CompressionName(codec));
+    }
+    return out.size() < len;
+  }
+
+  void Decompress(CompressionCodec codec, const unsigned char *data,
+                  size_t len, unsigned char *out, size_t rawlen) {
+    switch (codec) {
+    case COMPRESS_NONE:
+      if (len != rawlen)
+        EUDAQ_THROW("Corrupt data: size mismatch");
+      std::memcpy(out, data, len);
+      break;
+    case COMPRESS_FAST:
+      fast_decompress(data, len, out, rawlen);
+      break;
+#ifdef EUDAQ_USE_ZLIB
+    case COMPRESS_ZLIB: {
+      uLongf size = rawlen;
+      if (uncompress(out, &size, data, len) != Z_OK || size != rawlen)
+        EUDAQ_THROW("Corrupt zlib compressed data");
+      break;
+    }
+#endif
+#ifdef EUDAQ_USE_ZSTD
+    case COMPRESS_ZSTD: {
+      size_t size = ZSTD_decompress(out, rawlen, data, len);
+      if (ZSTD_isError(size) || size != rawlen)
+        EUDAQ_THROW("Corrupt zstd compressed data");
+      break;
+    }
+#endif
+    default:
+      EUDAQ_THROW("Compression not available in this build: " +
+                  CompressionName(codec));
+    }
+  }
+}
@@ -2,7 +2,10 @@
 #include "eudaq/TransportFactory.hh"
 #include "eudaq/BufferSerializer.hh"
 #include "eudaq/DetectorEvent.hh"
+#include "eudaq/TLUEvent.hh"
+#include "eudaq/PluginManager.hh"
 #include "eudaq/Logger.hh"
+#include "eudaq/Instrumentation.hh"
 #include "eudaq/Utils.hh"
 #include <iostream>
 #include <ostream>
@@ -13,10 +16,58 @@ namespace eudaq {
 
     void *DataCollector_thread(void *arg) {
       DataCollector *dc = static_cast<DataCollector *>(arg);
+      Instrumentation::SetThreadStage(STAGE_RECEIVE);
       dc->DataThread();
       return 0;
     }
 
+    void *DataCollector_deserializethread(void *arg) {
+      DataCollector *dc = static_cast<DataCollector *>(arg);
+      Instrumentation::SetThreadStage(STAGE_DESERIALIZE);
+      dc->DeserializeThread();
+      return 0;
+    }
+
+    void *DataCollector_builderthread(void *arg) {
+      DataCollector *dc = static_cast<DataCollector *>(arg);
+      Instrumentation::SetThreadStage(STAGE_BUILD);
+      dc->BuilderThread();
+      return 0;
+    }
+
+    void *DataCollector_writerthread(void *arg) {
+      DataCollector *dc = static_cast<DataCollector *>(arg);
+      Instrumentation::SetThreadStage(STAGE_WRITE);
+      dc->WriterThread();
+      return 0;
+    }
+
+    /// The latency from SendEvent of the sub-events stamped by producers
+    void RecordTotal(const DetectorEvent &ev) {
+      uint64_t now = Instrumentation::Now();
+      for (size_t i = 0; i < ev.NumEvents(); ++i) {
+        uint64_t sent = ev.GetEvent(i)->GetFastTag(Event::FTAG_SENDTIME);
+        // a stamp from the clock of another host may well be in the future
+        if (sent && sent <= now)
+          Instrumentation::Record(STAGE_TOTAL, now - sent);
+      }
+    }
+
+    static const size_t RXQUEUE_SIZE = 4096;
+    static const size_t BUILDQUEUE_SIZE = 4096;
+    static const size_t WRITEQUEUE_SIZE = 1024;
+
+    static const size_t DEFAULT_RINGSIZE = 4096;
+    static const int DEFAULT_MAXBUFFERED = 65536;
+    static const int DEFAULT_BUILDTIMEOUT = 1000; // ms
+    static const int DEFAULT_SHMSLOTS = 64;
+    static const int DEFAULT_SHMSLOTSIZE = 1 << 20; // bytes
+
+    static unsigned NumDeserializeThreads() {
+      unsigned n = std::thread::hardware_concurrency() / 2;
+      return n < 1 ? 1 : (n > 4 ? 4 : n);
+    }
+
   } // anonymous namespace
 
   DataCollector::DataCollector(const std::string &name,
@@ -26,12 +77,27 @@ namespace eudaq {
       : CommandReceiver("DataCollector", name, runcontrol, false),
         m_runnumberfile(runnumberfile), m_done(false), m_listening(true),
         m_dataserver(TransportFactory::CreateServer(listenaddress)), m_thread(),
+        m_rxqueue(RXQUEUE_SIZE), m_buildqueue(BUILDQUEUE_SIZE),
+        m_writequeue(WRITEQUEUE_SIZE), m_seqqueued(0), m_seqbuilt(0),
+        m_numqueued(0), m_numwritten(0), m_triggermode(false),
+        m_ringsize(DEFAULT_RINGSIZE),
+        m_buildtimeout(DEFAULT_BUILDTIMEOUT / 1e3), m_numincomplete(0),
+        m_numlate(0), m_maxbuffered(DEFAULT_MAXBUFFERED), m_numdropped(0),
         m_numwaiting(0), m_itlu((size_t)-1),
         m_runnumber(ReadFromFile(runnumberfile, 0U)), m_eventnumber(0),
-        m_runstart(0) {
+        m_runstart(0), m_filebytes(0), m_filequeue(0), m_runpoolmisses(0),
+        m_lastfilebytes(0), m_laststatus(0) {
     m_dataserver->SetCallback(
         TransportCallback(this, &DataCollector::DataHandler));
     EUDAQ_DEBUG("Instantiated datacollector with name: " + name);
+    m_writerthread = std::unique_ptr<std::thread>(
+        new std::thread(DataCollector_writerthread, this));
+    m_builderthread = std::unique_ptr<std::thread>(
+        new std::thread(DataCollector_builderthread, this));
+    for (unsigned i = 0; i < NumDeserializeThreads(); ++i) {
+      m_workers.push_back(std::unique_ptr<std::thread>(
+          new std::thread(DataCollector_deserializethread, this)));
+    }
     m_thread = std::unique_ptr<std::thread>(
         new std::thread(DataCollector_thread, this));
     EUDAQ_DEBUG("Listen address=" +
@@ -42,6 +108,11 @@ namespace eudaq {
   DataCollector::~DataCollector() {
     m_done = true;
     m_thread->join();
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+      m_workers[i]->join();
+    }
+    m_builderthread->join();
+    m_writerthread->join();
     delete m_dataserver;
   }
 
@@ -58,7 +129,10 @@ namespace eudaq {
     EUDAQ_INFO("Connection from " + to_string(id));
     Info info;
     info.id = std::shared_ptr<ConnectionInfo>(id.Clone());
+    if (m_triggermode)
+      info.ring.resize(m_ringsize);
     m_buffer.push_back(info);
+    m_infoidx[&id] = m_buffer.size() - 1;
     if (id.GetType() == "Producer" && id.GetName() == "TLU") {
       m_itlu = m_buffer.size() - 1;
     }
@@ -67,6 +141,15 @@ namespace eudaq {
   void DataCollector::OnDisconnect(const ConnectionInfo &id) {
     EUDAQ_INFO("Disconnected: " + to_string(id));
     size_t i = GetInfo(id);
+    if (m_triggermode) {
+      // the slot counts assume a fixed set of producers
+      FlushTriggers(true);
+    }
+    m_infoidx.erase(&id);
+    for (auto it = m_infoidx.begin(); it != m_infoidx.end(); ++it) {
+      if (it->second > i)
+        --it->second;
+    }
     if (i == m_itlu) {
       m_itlu = (size_t)-1;
     } else if (i < m_itlu) {
@@ -77,21 +160,68 @@ namespace eudaq {
   }
 
   void DataCollector::OnConfigure(const Configuration &param) {
+    if (!WaitForPipeline("configuring"))
+      return;
+    std::lock_guard<std::mutex> buildlock(m_buildmutex);
+    std::lock_guard<std::mutex> writerlock(m_writermutex);
     m_config = param;
     m_writer = std::shared_ptr<eudaq::FileWriter>(
         FileWriterFactory::Create(m_config.Get("FileType", "")));
+    m_filebytes = 0;
+    m_filequeue = 0;
     m_writer->SetFilePattern(m_config.Get("FilePattern", ""));
+    m_triggermode = m_config.Get("EventBuilding", "sequential") == "trigger";
+    int ringsize = m_config.Get("TriggerRingSize", (int)DEFAULT_RINGSIZE);
+    m_ringsize = ringsize < 1 ? 1 : ringsize;
+    m_buildtimeout = m_config.Get("BuildTimeout", DEFAULT_BUILDTIMEOUT) / 1e3;
+    int maxbuffered = m_config.Get("MaxBufferedEvents", DEFAULT_MAXBUFFERED);
+    m_maxbuffered = maxbuffered < 1 ? 1 : maxbuffered;
+    ResetTriggers();
+    ConfigureSharedMemory();
+  }
+
+  void DataCollector::ConfigureSharedMemory() {
+    std::string name = m_config.Get("SharedMemory", "");
+    int slots = m_config.Get("SharedMemorySlots", DEFAULT_SHMSLOTS);
+    int slotsize = m_config.Get("SharedMemorySlotSize", DEFAULT_SHMSLOTSIZE);
+    if (slots < 1)
+      slots = 1;
+    if (slotsize < 1024)
+      slotsize = 1024;
+    // keep the ring (and the monitors attached to it) if nothing changed
+    if (m_ring && name != "" && m_ring->NumSlots() == (size_t)slots &&
+        m_ring->SlotSize() == (size_t)slotsize &&
+        (m_ring->Name() == name || m_ring->Name() == "/" + name))
+      return;
+    m_ring.reset();
+    if (name == "")
+      return;
+    try {
+      m_ring.reset(new SharedMemoryRing(name, slots, slotsize));
+      EUDAQ_INFO("Publishing events in shared memory " + m_ring->Name());
+    } catch (const Exception &e) {
+      EUDAQ_ERROR(std::string("Unable to publish events in shared memory: ") +
+                  e.what());
+    }
   }
 
   void DataCollector::OnPrepareRun(unsigned runnumber) {
     // if (runnumber == m_runnumber && m_ser.get()) return false;
     EUDAQ_INFO("Preparing for run " + to_string(runnumber));
+    // make sure everything from the previous run has reached the old file
+    if (!WaitForPipeline("starting run " + to_string(runnumber)))
+      return;
+    std::lock_guard<std::mutex> buildlock(m_buildmutex);
+    std::lock_guard<std::mutex> writerlock(m_writermutex);
     m_runstart = Time::Current();
     try {
       if (!m_writer) {
         EUDAQ_THROW("You must configure before starting a run");
       }
       m_writer->StartRun(runnumber);
+      m_filebytes = m_writer->FileBytes();
+      m_filequeue = m_writer->PendingBytes();
+      m_runpoolmisses = MemoryPool::NumMisses();
       WriteToFile(m_runnumberfile, runnumber);
       m_runnumber = runnumber;
       m_eventnumber = 0;
@@ -105,6 +235,8 @@ namespace eudaq {
         }
       }
       m_numwaiting = 0;
+      m_numdropped = 0;
+      ResetTriggers();
 
       SetStatus(Status::LVL_OK);
     } catch (const Exception &e) {
@@ -123,7 +255,20 @@ namespace eudaq {
 
   void DataCollector::OnReceive(const ConnectionInfo &id,
                                 std::shared_ptr<Event> ev) {
-    Info &inf = m_buffer[GetInfo(id)];
+    size_t index = GetInfo(id);
+    if (m_triggermode && !ev->IsBORE() && !ev->IsEORE()) {
+      OnReceiveTriggered(index, ev);
+      return;
+    }
+    Info &inf = m_buffer[index];
+    // the others are not sending, keep the BORE and EORE to stay in step
+    if (inf.events.size() >= m_maxbuffered && !ev->IsBORE() && !ev->IsEORE()) {
+      if (m_numdropped++ == 0)
+        EUDAQ_ERROR("Dropping events from " + to_string(id) + ", " +
+                    to_string(m_maxbuffered) +
+                    " are waiting for the other producers");
+      return;
+    }
     inf.events.push_back(ev);
 
     // Print if the received event is the EORE of this producer:
@@ -141,18 +286,50 @@ namespace eudaq {
 
     // std::cout << "Waiting buffers: " << m_numwaiting << " out of " <<
     // m_buffer.size() << std::endl;
-    if (tmp)
+    if (tmp) {
+      // everything triggered before the end of run belongs before the EORE
+      if (m_triggermode)
+        FlushTriggers(true);
       OnCompleteEvent();
+    }
   }
 
   void DataCollector::OnStatus() {
     std::string evt;
-    if (m_eventnumber > 0)
-      evt = to_string(m_eventnumber - 1);
+    unsigned eventnumber = m_eventnumber;
+    if (eventnumber > 0)
+      evt = to_string(eventnumber - 1);
     m_status.SetTag("EVENT", evt);
     m_status.SetTag("RUN", to_string(m_runnumber));
-    if (m_writer.get())
-      m_status.SetTag("FILEBYTES", to_string(m_writer->FileBytes()));
+    // the writer thread's counters, so as not to wait for a slow write
+    if (m_writer.get()) {
+      uint64_t bytes = m_filebytes;
+      Time now = Time::Current();
+      double dt = Time(now - m_laststatus).Seconds();
+      if (bytes >= m_lastfilebytes && dt > 0)
+        m_status.SetTag("FILERATE", to_string((bytes - m_lastfilebytes) / dt));
+      m_lastfilebytes = bytes;
+      m_laststatus = now;
+      m_status.SetTag("FILEBYTES", to_string(bytes));
+      m_status.SetTag("FILEQUEUE", to_string(m_filequeue.load()));
+    }
+    m_status.SetTag("RXQUEUE", to_string(m_rxqueue.Size()));
+    m_status.SetTag("BUILDQUEUE", to_string(m_buildqueue.Size()));
+    m_status.SetTag("WRITEQUEUE", to_string(m_writequeue.Size()));
+    m_status.SetTag("POOLMISSES",
+                    to_string(MemoryPool::NumMisses() - m_runpoolmisses));
+    m_status.SetTag("POOLBYTES", to_string(MemoryPool::RetainedBytes()));
+    if (!m_triggermode)
+      m_status.SetTag("DROPPED", to_string(m_numdropped.load()));
+    if (m_ring) {
+      // only replaced in OnConfigure, on this thread
+      m_status.SetTag("SHMPUBLISHED", to_string(m_ring->NumPublished()));
+      m_status.SetTag("SHMTOOLARGE", to_string(m_ring->NumTooLarge()));
+    }
+    if (m_triggermode) {
+      m_status.SetTag("INCOMPLETE", to_string(m_numincomplete.load()));
+      m_status.SetTag("LATE", to_string(m_numlate.load()));
+    }
   }
 
   void DataCollector::OnCompleteEvent() {
@@ -173,8 +350,9 @@ namespace eudaq {
         n_ev = ev->GetEventNumber();
         n_ts = ev->GetTimestamp();
       }
-      DetectorEvent ev(n_run, n_ev, n_ts);
-      unsigned tluev = 0;
+      std::shared_ptr<DetectorEvent> evptr =
+          MakePooled(new DetectorEvent(n_run, n_ev, n_ts));
+      DetectorEvent &ev = *evptr;
       for (size_t i = 0; i < m_buffer.size(); ++i) {
         if (m_buffer[i].events.front()->GetRunNumber() != m_runnumber) {
           EUDAQ_ERROR("Run number mismatch in event " +
@@ -191,7 +369,7 @@ namespace eudaq {
                   "Event number mismatch > 1 in event " +
                   to_string(ev.GetEventNumber()) + " " +
                   to_string(m_buffer[i].events.front()->GetEventNumber()) +
-                  " " + to_string(m_eventnumber));
+                  " " + to_string(m_eventnumber.load()));
             if (m_buffer[i].events.front()->GetEventNumber() == 0)
               EUDAQ_WARN("Event number mismatch > 1 in event " +
                          to_string(ev.GetEventNumber()));
@@ -204,38 +382,157 @@ namespace eudaq {
           more = false;
         }
       }
-      if (ev.IsBORE()) {
-        ev.SetTag("STARTTIME", m_runstart.Formatted());
-        ev.SetTag("CONFIG", to_string(m_config));
-        found_bore = true;
-      }
-      if (ev.IsEORE()) {
-        ev.SetTag("STOPTIME", Time::Current().Formatted());
-        EUDAQ_INFO("Run " + to_string(ev.GetRunNumber()) + ", EORE = " +
-                   to_string(ev.GetEventNumber()));
+      FinishEvent(ev, found_bore);
+      QueueForWriting(evptr);
+    }
+  }
+
+  void DataCollector::FinishEvent(DetectorEvent &ev, bool &found_bore) {
+    if (ev.IsBORE()) {
+      ev.SetTag("STARTTIME", m_runstart.Formatted());
+      ev.SetTag("CONFIG", to_string(m_config));
+      found_bore = true;
+    }
+    if (ev.IsEORE()) {
+      ev.SetTag("STOPTIME", Time::Current().Formatted());
+      EUDAQ_INFO("Run " + to_string(ev.GetRunNumber()) + ", EORE = " +
+                 to_string(ev.GetEventNumber()));
+    }
+
+    // Only increase the internal event counter for non-BORE events.
+    // This is required since all producers start sending data with event ID 0
+    // but the data collector would already be at 1, since BORE was 0.
+    if (!found_bore)
+      ++m_eventnumber;
+  }
+
+  unsigned DataCollector::TriggerID(const Event &ev) const {
+    // the TLU numbers its events by trigger
+    if (const TLUEvent *tlu = dynamic_cast<const TLUEvent *>(&ev))
+      return tlu->GetEventNumber();
+    if (ev.HasFastTag(Event::FTAG_TRIGGERID))
+      return (unsigned)ev.GetFastTag(Event::FTAG_TRIGGERID);
+    unsigned tid = (unsigned)-1;
+    try {
+      tid = PluginManager::GetTriggerID(ev);
+    } catch (const Exception &) {
+      // no converter plugin for this event type
+    }
+    // fall back to the event number for producers that do not decode the
+    // trigger ID
+    return tid == (unsigned)-1 ? ev.GetEventNumber() : tid;
+  }
+
+  void DataCollector::OnReceiveTriggered(size_t index,
+                                         std::shared_ptr<Event> ev) {
+    unsigned tid = TriggerID(*ev);
+    size_t s = tid % m_ringsize;
+    TriggerSlot &slot = m_slots[s];
+    if (slot.tid != tid) {
+      if (slot.tid != (unsigned)-1 && (int)(tid - slot.tid) < 0) {
+        // older than everything the ring can hold
+        ++m_numlate;
+        return;
       }
-      if (m_writer.get()) {
-        try {
-          m_writer->WriteEvent(ev);
-        } catch (const Exception &e) {
-          std::string msg = "Exception writing to file: ";
-          msg += e.what();
-          EUDAQ_ERROR(msg);
-          SetStatus(Status::LVL_ERROR, msg);
-        }
+      // the ring has wrapped: write out the old trigger to make room
+      if (!slot.done)
+        EmitTrigger(s);
+    } else if (slot.done) {
+      // this trigger has already been written (timed out)
+      ++m_numlate;
+      return;
+    }
+    Info &inf = m_buffer[index];
+    if (inf.ring[s]) {
+      EUDAQ_WARN("Duplicate trigger ID " + to_string(tid) + " from " +
+                 to_string(*inf.id));
+      return;
+    }
+    if (slot.count == 0) {
+      slot.tid = tid;
+      slot.done = false;
+      slot.arrival = Time::Current();
+      m_pendingslots.push_back(std::make_pair(s, tid));
+    }
+    inf.ring[s] = ev;
+    if (++slot.count == m_buffer.size()) {
+      EmitTrigger(s);
+    }
+    FlushTriggers(false);
+  }
+
+  void DataCollector::EmitTrigger(size_t s) {
+    TriggerSlot &slot = m_slots[s];
+    unsigned n_ev = slot.tid;
+    uint64_t n_ts = (uint64_t)-1;
+    if (m_itlu != (size_t)-1 && m_buffer[m_itlu].ring[s]) {
+      const TLUEvent *tlu =
+          static_cast<const TLUEvent *>(m_buffer[m_itlu].ring[s].get());
+      n_ev = tlu->GetEventNumber();
+      n_ts = tlu->GetTimestamp();
+    }
+    std::shared_ptr<DetectorEvent> evptr =
+        MakePooled(new DetectorEvent(m_runnumber, n_ev, n_ts));
+    size_t missing = 0;
+    for (size_t i = 0; i < m_buffer.size(); ++i) {
+      std::shared_ptr<Event> &sub = m_buffer[i].ring[s];
+      if (sub) {
+        evptr->AddEvent(sub);
+        sub.reset();
       } else {
-        EUDAQ_ERROR("Event received before start of run");
+        ++missing;
       }
+    }
+    if (missing) {
+      evptr->SetTag("MISSING", to_string(missing));
+      ++m_numincomplete;
+    }
+    slot.count = 0;
+    slot.done = true;
+    bool found_bore = false;
+    FinishEvent(*evptr, found_bore);
+    QueueForWriting(evptr);
+  }
 
-      // Only increase the internal event counter for non-BORE events.
-      // This is required since all producers start sending data with event ID 0
-      // but the data collector would already be at 1, since BORE was 0.
-      if (!found_bore)
-        ++m_eventnumber;
+  void DataCollector::FlushTriggers(bool all) {
+    Time now = Time::Current();
+    while (!m_pendingslots.empty()) {
+      const std::pair<size_t, unsigned> &front = m_pendingslots.front();
+      TriggerSlot &slot = m_slots[front.first];
+      if (slot.tid == front.second && !slot.done) {
+        if (!all && Time(now - slot.arrival).Seconds() < m_buildtimeout)
+          break;
+        EmitTrigger(front.first);
+      }
+      m_pendingslots.pop_front();
     }
   }
 
+  void DataCollector::ResetTriggers() {
+    m_slots.assign(m_triggermode ? m_ringsize : 0, TriggerSlot());
+    m_pendingslots.clear();
+    for (size_t i = 0; i < m_buffer.size(); ++i) {
+      m_buffer[i].ring.assign(m_triggermode ? m_ringsize : 0,
+                              std::shared_ptr<Event>());
+    }
+    m_numincomplete = m_numlate = 0;
+  }
+
+  void DataCollector::QueueForWriting(const std::shared_ptr<DetectorEvent> &ev) {
+    if (!m_writer.get()) {
+      EUDAQ_ERROR("Event received before start of run");
+      return;
+    }
+    std::shared_ptr<DetectorEvent> item(ev);
+    ++m_numqueued;
+    if (!m_writequeue.Push(std::move(item), m_done))
+      --m_numqueued;
+  }
+
   size_t DataCollector::GetInfo(const ConnectionInfo &id) {
+    auto it = m_infoidx.find(&id);
+    if (it != m_infoidx.end())
+      return it->second;
     for (size_t i = 0; i < m_buffer.size(); ++i) {
       // std::cout << "Checking " << *m_buffer[i].id << " == " << id<<
       // std::endl;
@@ -260,7 +557,8 @@ namespace eudaq {
       break;
     case (TransportEvent::DISCONNECT):
       // std::cout << "Disconnect: " << ev.id << std::endl;
-      OnDisconnect(ev.id);
+      if (m_conns.count(&ev.id))
+        QueueItem(Item::DISCONNECT, ev.id);
       break;
     case (TransportEvent::RECEIVE):
       if (ev.id.GetState() == 0) { // waiting for identification
@@ -298,7 +596,7 @@ namespace eudaq {
         // std::cout << "client replied, sending OK" << std::endl;
         m_dataserver->SendPacket("OK", ev.id, true);
         ev.id.SetState(1); // successfully identified
-        OnConnect(ev.id);
+        QueueItem(Item::CONNECT, ev.id);
       } else {
         // std::cout << "Receive: " << ev.id << " " << ev.packet.size() <<
         // std::endl;
@@ -306,12 +604,11 @@ namespace eudaq {
         //    std::cout << to_hex(ev.packet[i], 2) << ' ';
         //}
         // std::cout << ")" << std::endl;
-        BufferSerializer ser(ev.packet.begin(), ev.packet.end());
-        // std::cout << "Deserializing" << std::endl;
-        std::shared_ptr<Event> event(EventFactory::Create(ser));
-        // std::cout << "Done" << std::endl;
-        OnReceive(ev.id, event);
-        // std::cout << "End" << std::endl;
+        // take over the packet so that data blocks can reference it directly
+        // instead of copying their payload
+        QueueItem(Item::RECEIVE, ev.id,
+                  std::allocate_shared<const std::string>(
+                      PoolAllocator<std::string>(), std::move(ev.packet)));
       }
       break;
     default:
@@ -319,6 +616,157 @@ namespace eudaq {
     }
   }
 
+  void DataCollector::QueueItem(Item::Type type, const ConnectionInfo &id,
+                                std::shared_ptr<const std::string> packet) {
+    Item item;
+    item.type = type;
+    item.seq = m_seqqueued;
+    item.packet = packet;
+    if (packet && Instrumentation::Enabled())
+      item.stamp = Instrumentation::Now();
+    if (type == Item::CONNECT) {
+      m_conns[&id] = std::shared_ptr<ConnectionInfo>(id.Clone());
+    }
+    item.id = m_conns[&id];
+    if (type == Item::DISCONNECT) {
+      m_conns.erase(&id);
+    }
+    if (m_rxqueue.Push(std::move(item), m_done))
+      ++m_seqqueued;
+  }
+
+  void DataCollector::DeserializeThread() {
+    Item item;
+    while (m_rxqueue.Pop(item, m_done)) {
+      if (item.type == Item::RECEIVE) {
+        Instrumentation::RecordSince(STAGE_RECEIVE, item.stamp);
+        try {
+          StageTimer timer(STAGE_DESERIALIZE);
+          BufferDeserializer ser(item.packet);
+          item.event = MakePooled(EventFactory::Create(ser));
+        } catch (const std::exception &e) {
+          // still pass the item on, so that the builder does not wait for it
+          EUDAQ_ERROR("Unable to deserialize event from " +
+                      to_string(*item.id) + ": " + e.what());
+        }
+        item.packet.reset();
+        if (item.stamp)
+          item.stamp = Instrumentation::Now();
+      }
+      if (!m_buildqueue.Push(std::move(item), m_done))
+        break;
+    }
+  }
+
+  void DataCollector::BuilderThread() {
+    // items arrive from several workers, so put them back in receive order
+    typedef std::map<uint64_t, Item, std::less<uint64_t>,
+                     PoolAllocator<std::pair<const uint64_t, Item>>> pending_t;
+    pending_t pending;
+    Item item;
+    for (unsigned tries = 0; !m_done; ++tries) {
+      if (!m_buildqueue.TryPop(item)) {
+        if (m_triggermode && tries % 64 == 63) {
+          // write out triggers that timed out while no data arrived
+          std::lock_guard<std::mutex> lock(m_buildmutex);
+          FlushTriggers(false);
+        }
+        BoundedQueue<Item>::Backoff(tries);
+        continue;
+      }
+      tries = 0;
+      uint64_t seq = item.seq;
+      pending[seq] = std::move(item);
+      pending_t::iterator it;
+      while ((it = pending.find(m_seqbuilt)) != pending.end()) {
+        try {
+          HandleItem(it->second);
+        } catch (const std::exception &e) {
+          EUDAQ_ERROR(std::string("Error building event: ") + e.what());
+        }
+        pending.erase(it);
+        ++m_seqbuilt;
+      }
+    }
+  }
+
+  void DataCollector::HandleItem(Item &item) {
+    std::lock_guard<std::mutex> lock(m_buildmutex);
+    switch (item.type) {
+    case Item::CONNECT:
+      OnConnect(*item.id);
+      break;
+    case Item::DISCONNECT:
+      OnDisconnect(*item.id);
+      break;
+    case Item::RECEIVE:
+      if (item.event)
+        OnReceive(*item.id, item.event);
+      Instrumentation::RecordSince(STAGE_BUILD, item.stamp);
+      break;
+    default:
+      break;
+    }
+  }
+
+  void DataCollector::WriterThread() {
+    std::shared_ptr<DetectorEvent> ev;
+    while (m_writequeue.Pop(ev, m_done)) {
+      {
+        std::lock_guard<std::mutex> lock(m_writermutex);
+        try {
+          // before the file, it may block on a slow disk
+          if (m_ring)
+            m_ring->Publish(*ev);
+          if (m_writer.get()) {
+            StageTimer timer(STAGE_WRITE);
+            m_writer->WriteEvent(*ev);
+            m_filebytes = m_writer->FileBytes();
+            m_filequeue = m_writer->PendingBytes();
+            if (Instrumentation::Enabled())
+              RecordTotal(*ev);
+          }
+        } catch (const Exception &e) {
+          std::string msg = "Exception writing to file: ";
+          msg += e.what();
+          EUDAQ_ERROR(msg);
+          SetStatus(Status::LVL_ERROR, msg);
+        }
+      }
+      bool eore = ev->IsEORE();
+      ev.reset();
+      if (eore) {
+        EUDAQ_INFO("Memory pool misses during the run: " +
+                   to_string(MemoryPool::NumMisses() - m_runpoolmisses));
+        // do not keep the run's peak memory until the next run
+        MemoryPool::Trim();
+      }
+      ++m_numwritten;
+    }
+  }
+
+  bool DataCollector::WaitForPipeline(const std::string &what) {
+    // wait (with a timeout) until everything received so far has been built
+    // and written
+    uint64_t queued = m_seqqueued;
+    for (unsigned tries = 0; m_seqbuilt < queued && tries < 10000; ++tries)
+      mSleep(1);
+    uint64_t towrite = m_numqueued;
+    for (unsigned tries = 0; m_numwritten < towrite && tries < 10000; ++tries)
+      mSleep(1);
+    uint64_t built = m_seqbuilt, written = m_numwritten;
+    if (built >= queued && written >= towrite)
+      return true;
+    // going on would put the remaining events into the wrong file
+    std::string msg =
+        "Not " + what + ", the previous events are still being processed (" +
+        to_string(built < queued ? queued - built : 0) + " to build, " +
+        to_string(written < towrite ? towrite - written : 0) + " to write)";
+    EUDAQ_ERROR(msg);
+    SetStatus(Status::LVL_ERROR, msg);
+    return false;
+  }
+
   void DataCollector::DataThread() {
     try {
       while (!m_done) {
@@ -6,6 +6,7 @@
 #include "eudaq/BufferSerializer.hh"
 #include "eudaq/Logger.hh"
 #include "eudaq/DataSender.hh"
+#include "eudaq/Instrumentation.hh"
 
 namespace eudaq {
 
@@ -60,9 +61,14 @@ namespace eudaq {
     if (!m_dataclient)
       EUDAQ_THROW("Transport not connected error");
     // EUDAQ_DEBUG("Serializing event");
-    BufferSerializer ser;
-    ev.Serialize(ser);
+    // large data blocks are sent straight from the event, without a copy
+    GatherSerializer ser;
+    {
+      StageTimer timer(STAGE_SERIALIZE);
+      ev.Serialize(ser);
+    }
     // EUDAQ_DEBUG("Sending event");
+    StageTimer timer(STAGE_SEND);
     m_dataclient->SendPacket(ser);
     // EUDAQ_DEBUG("Sent event");
   }
@@ -12,9 +12,9 @@ namespace eudaq {
     unsigned n;
     ds.read(n);
     // std::cout << "Num=" << n << std::endl;
+    m_events.reserve(n);
     for (size_t i = 0; i < n; ++i) {
-      std::shared_ptr<Event> ev(EventFactory::Create(ds));
-      m_events.push_back(ev);
+      m_events.push_back(MakePooled(EventFactory::Create(ds)));
     }
   }
 
@@ -11,6 +11,40 @@ namespace eudaq {
     static const char *const FLAGNAMES[] = {"BORE",   "EORE",   "HITS",
                                             "FAKE",   "SIMU",   "EUDAQ2",
                                             "PACKET", "BROKEN", "STATUS"};
+
+    static const char *const FASTTAGNAMES[] = {"", "TRIGGERID", "FRAMECOUNT",
+                                               "TSBEGIN", "TSEND", "SENDTIME"};
+
+    // the fast tags travel as one binary string tag with this name
+    static const char *const FASTTAG_KEY = "_FASTTAGS";
+    static const size_t FASTTAG_SIZE = 12; // 4 bytes id, 8 bytes value
+
+    std::string pack_fasttags(
+        const std::vector<std::pair<unsigned, uint64_t>> &tags) {
+      std::string result(tags.size() * FASTTAG_SIZE, '\0');
+      for (size_t i = 0; i < tags.size(); ++i) {
+        for (size_t b = 0; b < 4; ++b)
+          result[i * FASTTAG_SIZE + b] = char(tags[i].first >> (8 * b));
+        for (size_t b = 0; b < 8; ++b)
+          result[i * FASTTAG_SIZE + 4 + b] = char(tags[i].second >> (8 * b));
+      }
+      return result;
+    }
+
+    void unpack_fasttags(const std::string &str,
+                         std::vector<std::pair<unsigned, uint64_t>> &tags) {
+      const unsigned char *p =
+          reinterpret_cast<const unsigned char *>(str.data());
+      tags.resize(str.size() / FASTTAG_SIZE);
+      for (size_t i = 0; i < tags.size(); ++i, p += FASTTAG_SIZE) {
+        tags[i].first = 0;
+        tags[i].second = 0;
+        for (size_t b = 0; b < 4; ++b)
+          tags[i].first |= unsigned(p[b]) << (8 * b);
+        for (size_t b = 0; b < 8; ++b)
+          tags[i].second |= uint64_t(p[4 + b]) << (8 * b);
+      }
+    }
   }
 
   Event::Event(Deserializer &ds) {
@@ -33,7 +67,18 @@ namespace eudaq {
 
       ds.read(m_timestamp);
     }
-    ds.read(m_tags);
+    unsigned ntags = 0;
+    ds.read(ntags);
+    for (unsigned i = 0; i < ntags; ++i) {
+      std::string name, val;
+      ds.read(name);
+      ds.read(val);
+      if (name == FASTTAG_KEY) {
+        unpack_fasttags(val, m_fasttags);
+      } else {
+        m_tags.insert(m_tags.end(), std::make_pair(name, val));
+      }
+    }
 
     if (!additional_timeStamps.empty()) {
       SetTag("TimeStamps", additional_timeStamps);
@@ -47,7 +92,45 @@ namespace eudaq {
     ser.write(m_runnumber);
     ser.write(m_eventnumber);
     ser.write(m_timestamp);
-    ser.write(m_tags);
+    if (m_fasttags.empty()) {
+      ser.write(m_tags);
+    } else {
+      // as if FASTTAG_KEY was one more string tag
+      ser.write((unsigned)m_tags.size() + 1);
+      ser.write(std::string(FASTTAG_KEY));
+      ser.write(pack_fasttags(m_fasttags));
+      for (map_t::const_iterator i = m_tags.begin(); i != m_tags.end(); ++i) {
+        ser.write(i->first);
+        ser.write(i->second);
+      }
+    }
+  }
+
+  Event &Event::SetFastTag(unsigned id, uint64_t val) {
+    for (size_t i = 0; i < m_fasttags.size(); ++i) {
+      if (m_fasttags[i].first == id) {
+        m_fasttags[i].second = val;
+        return *this;
+      }
+    }
+    m_fasttags.push_back(std::make_pair(id, val));
+    return *this;
+  }
+
+  bool Event::HasFastTag(unsigned id) const {
+    for (size_t i = 0; i < m_fasttags.size(); ++i) {
+      if (m_fasttags[i].first == id)
+        return true;
+    }
+    return false;
+  }
+
+  uint64_t Event::GetFastTag(unsigned id, uint64_t def) const {
+    for (size_t i = 0; i < m_fasttags.size(); ++i) {
+      if (m_fasttags[i].first == id)
+        return m_fasttags[i].second;
+    }
+    return def;
   }
 
   void Event::Print(std::ostream &os) const {
@@ -75,6 +158,16 @@ namespace eudaq {
       }
       os << "}";
     }
+    for (size_t i = 0; i < m_fasttags.size(); ++i) {
+      unsigned id = m_fasttags[i].first;
+      os << (i == 0 ? ", [" : ", ")
+         << (id < sizeof FASTTAGNAMES / sizeof *FASTTAGNAMES
+                 ? std::string(FASTTAGNAMES[id])
+                 : to_string(id))
+         << "=" << m_fasttags[i].second;
+      if (i + 1 == m_fasttags.size())
+        os << "]";
+    }
   }
 
   unsigned Event::str2id(const std::string &str) {
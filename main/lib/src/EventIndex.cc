@@ -0,0 +1,109 @@
+#include "eudaq/EventIndex.hh"
+#include "eudaq/Event.hh"
+#include "eudaq/FileSerializer.hh"
+#include "eudaq/Exception.hh"
+#include <algorithm>
+#include <cstdio>
+
+namespace eudaq {
+
+  EventIndexEntry::EventIndexEntry(const Event &ev, uint64_t off)
+      : eventnumber(ev.GetEventNumber()), flags(ev.GetFlags()), offset(off),
+        timestamp(ev.GetTimestamp()) {}
+
+  void EventIndexEntry::Serialize(Serializer &ser) const {
+    ser.write(eventnumber);
+    ser.write(flags);
+    ser.write(offset);
+    ser.write(timestamp);
+  }
+
+  void EventIndexEntry::Deserialize(Deserializer &ds) {
+    ds.read(eventnumber);
+    ds.read(flags);
+    ds.read(offset);
+    ds.read(timestamp);
+  }
+
+  bool EventIndex::Load(const std::string &filename) {
+    FILE *fd = fopen(filename.c_str(), "rb");
+    if (!fd)
+      return false;
+    fclose(fd);
+    FileDeserializer ds(filename, true);
+    if (!ds.HasData() || ds.read<unsigned>() != Event::str2id("IDX1"))
+      EUDAQ_THROWX(FileReadException, "Not an event index: " + filename);
+    m_entries.clear();
+    m_byevent.clear();
+    m_data.clear();
+    m_bore = m_eore = (size_t)-1;
+    m_bytime.clear();
+    try {
+      while (ds.HasData()) {
+        EventIndexEntry entry;
+        entry.Deserialize(ds);
+        Add(entry);
+      }
+    } catch (const FileReadException &) {
+      // the last entry is incomplete if the writer was still running
+    }
+    return true;
+  }
+
+  void EventIndex::Add(const EventIndexEntry &entry) {
+    size_t i = m_entries.size();
+    m_entries.push_back(entry);
+    if ((entry.flags & Event::FLAG_BORE) && m_bore == (size_t)-1)
+      m_bore = i;
+    if ((entry.flags & Event::FLAG_EORE) && m_eore == (size_t)-1)
+      m_eore = i;
+    if (entry.flags & (Event::FLAG_BORE | Event::FLAG_EORE))
+      return;
+    m_byevent.insert(std::make_pair(entry.eventnumber, i));
+    m_data.push_back(i);
+    if (m_bytime.size() &&
+        m_entries[m_bytime.back()].timestamp > entry.timestamp)
+      m_sorted = false;
+    m_bytime.push_back(i);
+  }
+
+  const EventIndexEntry *EventIndex::FindEvent(unsigned eventnumber) const {
+    auto it = m_byevent.find(eventnumber);
+    return it == m_byevent.end() ? 0 : &m_entries[it->second];
+  }
+
+  const EventIndexEntry *EventIndex::FindTimestamp(uint64_t ts) const {
+    if (!m_sorted) {
+      std::stable_sort(m_bytime.begin(), m_bytime.end(),
+                       [this](size_t a, size_t b) {
+                         return m_entries[a].timestamp < m_entries[b].timestamp;
+                       });
+      m_sorted = true;
+    }
+    auto it = std::lower_bound(m_bytime.begin(), m_bytime.end(), ts,
+                               [this](size_t a, uint64_t t) {
+                                 return m_entries[a].timestamp < t;
+                               });
+    return it == m_bytime.end() ? 0 : &m_entries[*it];
+  }
+
+  const EventIndexEntry *EventIndex::DataEntry(size_t n) const {
+    return n < m_data.size() ? &m_entries[m_data[n]] : 0;
+  }
+
+  const EventIndexEntry *EventIndex::FindBORE() const {
+    return m_bore < m_entries.size() ? &m_entries[m_bore] : 0;
+  }
+
+  const EventIndexEntry *EventIndex::FindEORE() const {
+    return m_eore < m_entries.size() ? &m_entries[m_eore] : 0;
+  }
+
+  void EventIndex::WriteHeader(Serializer &ser) {
+    ser.write(Event::str2id("IDX1"));
+  }
+
+  void EventIndex::Append(Serializer &ser, const Event &ev, uint64_t offset) {
+    EventIndexEntry(ev, offset).Serialize(ser);
+  }
+}
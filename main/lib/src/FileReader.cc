@@ -10,10 +10,24 @@
 namespace eudaq {
 
   FileReader::FileReader(const std::string &file,
-                         const std::string &filepattern)
+                         const std::string &filepattern, bool mapped)
       : m_filename(
             FileNamer(filepattern).Set('X', ".raw").SetReplace('R', file)),
-        m_des(m_filename), m_ev(EventFactory::Create(m_des)), m_ver(1) {
+        m_des(Open(m_filename, mapped)), m_ver(1) {
+    // files written by FileWriterNative2 start with a version tag instead of
+    // the id of the first event
+    unsigned id = m_des->read<unsigned>();
+    if (id == Event::str2id("VER2")) {
+      m_ver = 2;
+      BufferSerializer buf;
+      m_des->read(buf);
+      m_ev = std::shared_ptr<eudaq::Event>(EventFactory::Create(buf));
+    } else {
+      EventFactory::event_creator cr = EventFactory::GetCreator(id);
+      if (!cr)
+        EUDAQ_THROW("Unrecognised Event type (" + Event::id2str(id) + ")");
+      m_ev = std::shared_ptr<eudaq::Event>(cr(*m_des));
+    }
 
     // 		m_ev->SetTag("longTimeDelay",longTimeDelay);
     // 		m_ev->SetTag("NumberOfEvents",syncEvents);
@@ -37,15 +51,71 @@ namespace eudaq {
   //   }
   FileReader::~FileReader() {}
 
+  FileDeserializer *FileReader::Open(const std::string &filename,
+                                     bool mapped) {
+    if (CompressedFileDeserializer::IsCompressed(filename))
+      return new CompressedFileDeserializer(filename);
+    if (mapped) {
+      try {
+        return new MappedFileDeserializer(filename);
+      } catch (const FileReadException &) {
+        // fall back to normal reading
+      }
+    }
+    return new FileDeserializer(filename);
+  }
+
   bool FileReader::NextEvent(size_t skip) {
     std::shared_ptr<eudaq::Event> ev = nullptr;
 
-    bool result = m_des.ReadEvent(m_ver, ev, skip);
+    bool result = m_des->ReadEvent(m_ver, ev, skip);
     if (ev)
       m_ev = ev;
     return result;
   }
 
+  const EventIndex &FileReader::Index() {
+    if (m_index)
+      return *m_index;
+    m_index.reset(new EventIndex);
+    if (m_index->Load(EventIndex::IndexName(m_filename)))
+      return *m_index;
+    // no index written with the file, so build one by reading it once
+    EUDAQ_INFO("Indexing " + m_filename);
+    uint64_t pos = m_des->Position();
+    m_des->Seek(m_ver < 2 ? 0 : sizeof(unsigned));
+    for (;;) {
+      uint64_t offset = m_des->Position();
+      std::shared_ptr<eudaq::Event> ev;
+      if (!m_des->HasData() || !m_des->ReadEvent(m_ver, ev) || !ev)
+        break;
+      m_index->Add(EventIndexEntry(*ev, offset));
+    }
+    m_des->Seek(pos);
+    return *m_index;
+  }
+
+  bool FileReader::SeekTo(const EventIndexEntry *entry) {
+    if (!entry)
+      return false;
+    m_des->Seek(entry->offset);
+    return NextEvent();
+  }
+
+  bool FileReader::SeekEvent(unsigned eventnumber) {
+    return SeekTo(Index().FindEvent(eventnumber));
+  }
+
+  bool FileReader::SeekTimestamp(uint64_t timestamp) {
+    return SeekTo(Index().FindTimestamp(timestamp));
+  }
+
+  bool FileReader::SeekData(size_t n) { return SeekTo(Index().DataEntry(n)); }
+
+  bool FileReader::SeekBORE() { return SeekTo(Index().FindBORE()); }
+
+  bool FileReader::SeekEORE() { return SeekTo(Index().FindEORE()); }
+
   unsigned FileReader::RunNumber() const { return m_ev->GetRunNumber(); }
 
   const Event &FileReader::GetEvent() const { return *m_ev; }
@@ -5,12 +5,130 @@
 #include "eudaq/Event.hh"
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#if EUDAQ_PLATFORM_IS(WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 namespace eudaq {
 
+  namespace {
+
+    // alignment of the buffers and of the writes in direct mode
+    static const size_t IO_ALIGN = 4096;
+
+#if EUDAQ_PLATFORM_IS(WIN32)
+    int file_open(const std::string &fname, bool /*direct*/) {
+      return _open(fname.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                   _S_IREAD | _S_IWRITE);
+    }
+    int file_write(int fd, const unsigned char *data, size_t len) {
+      return _write(fd, data, (unsigned)len);
+    }
+    int file_sync(int fd) { return _commit(fd); }
+    int file_seek(FILE *f, int64_t pos, int whence) {
+      return _fseeki64(f, pos, whence);
+    }
+    int64_t file_tell(FILE *f) { return _ftelli64(f); }
+    int file_close(int fd) { return _close(fd); }
+    void file_undirect(int /*fd*/) {}
+#else
+    int file_open(const std::string &fname, bool direct) {
+      int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+      if (direct)
+        flags |= O_DIRECT;
+#else
+      (void)direct;
+#endif
+      return open(fname.c_str(), flags, 0644);
+    }
+    ssize_t file_write(int fd, const unsigned char *data, size_t len) {
+      return write(fd, data, len);
+    }
+    int file_sync(int fd) { return fsync(fd); }
+    int file_seek(FILE *f, int64_t pos, int whence) {
+      return fseeko(f, pos, whence);
+    }
+    int64_t file_tell(FILE *f) { return ftello(f); }
+    int file_close(int fd) { return close(fd); }
+    // needed before writing a tail that is not a multiple of the block size
+    void file_undirect(int fd) {
+#ifdef O_DIRECT
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+#else
+      (void)fd;
+#endif
+    }
+#endif
+
+    // writes everything, returns an error message or an empty string
+    std::string write_all(int fd, const unsigned char *data, size_t len) {
+      while (len > 0) {
+        auto n = file_write(fd, data, len);
+        if (n < 0) {
+          if (errno == EINTR)
+            continue;
+          return to_string(errno) + ", " + strerror(errno);
+        }
+        data += n;
+        len -= n;
+      }
+      return "";
+    }
+
+    // amount of the mapped file to advise the kernel to read ahead
+    static const size_t PREFETCH_SIZE = 16 << 20;
+
+    // parses a size with an optional k/M/G suffix
+    uint64_t parse_bytes(const std::string &str) {
+      std::string num = trim(str);
+      uint64_t mult = 1;
+      if (num.size() > 0) {
+        switch (num[num.size() - 1]) {
+        case 'k': case 'K': mult = 1ULL << 10; break;
+        case 'm': case 'M': mult = 1ULL << 20; break;
+        case 'g': case 'G': mult = 1ULL << 30; break;
+        }
+        if (mult != 1)
+          num.erase(num.size() - 1);
+      }
+      return from_string(num, (uint64_t)0) * mult;
+    }
+
+    // compressed container: "ZRAW", version, then frames of
+    // "ZFRM", codec, raw size, stored size, data;
+    // closed by the frame index "ZIDX", n, n * (raw offset, file offset, raw
+    // size), followed by the offset of the index and "ZEND"
+    static const uint32_t CMP_VERSION = 1;
+    static const size_t CMP_HEADER = 8;
+    static const size_t FRAME_HEADER = 16;
+    static const size_t INDEX_ENTRY = 20;
+    static const size_t INDEX_TRAILER = 12;
+
+    void put_le(std::vector<unsigned char> &out, uint64_t v, int bytes) {
+      for (int i = 0; i < bytes; ++i)
+        out.push_back((unsigned char)(v >> (8 * i)));
+    }
+
+    uint64_t get_le(const unsigned char *p, int bytes) {
+      uint64_t v = 0;
+      for (int i = bytes - 1; i >= 0; --i)
+        v = (v << 8) | p[i];
+      return v;
+    }
+
+  } // anonymous namespace
+
   FileSerializer::FileSerializer(const std::string &fname, bool overwrite)
-      : m_file(0), m_filebytes(0) {
+      : m_filebytes(0), m_file(0) {
     if (!overwrite) {
       FILE *fd = fopen(fname.c_str(), "rb");
       if (fd) {
@@ -23,6 +141,8 @@ namespace eudaq {
       EUDAQ_THROWX(FileNotFoundException, "Unable to open file: " + fname);
   }
 
+  FileSerializer::FileSerializer() : m_filebytes(0), m_file(0) {}
+
   FileSerializer::~FileSerializer() {
     if (m_file) {
       fclose(m_file);
@@ -41,10 +161,421 @@ namespace eudaq {
 
   void FileSerializer::Flush() { fflush(m_file); }
 
+  void FileSerializer::Sync() {
+    Flush();
+#if EUDAQ_PLATFORM_IS(WIN32)
+    _commit(_fileno(m_file));
+#else
+    fsync(fileno(m_file));
+#endif
+  }
+
+  AsyncFileSerializer::AsyncFileSerializer(const std::string &fname,
+                                           size_t buffersize, bool direct,
+                                           bool overwrite)
+      : m_fd(-1), m_direct(direct),
+        m_capacity((buffersize + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN),
+        m_fill(0), m_used(0), m_ioready(0), m_stop(false), m_written(0) {
+    if (!overwrite) {
+      FILE *fd = fopen(fname.c_str(), "rb");
+      if (fd) {
+        fclose(fd);
+        EUDAQ_THROWX(FileExistsException, "File already exists: " + fname);
+      }
+    }
+    if (m_capacity == 0)
+      m_capacity = IO_ALIGN;
+    m_fd = file_open(fname, direct);
+    if (m_fd < 0 && direct) {
+      // not all file systems support O_DIRECT
+      m_direct = false;
+      m_fd = file_open(fname, false);
+    }
+    if (m_fd < 0)
+      EUDAQ_THROWX(FileNotFoundException, "Unable to open file: " + fname);
+    for (int i = 0; i < 2; ++i) {
+      m_mem[i].resize(m_capacity + IO_ALIGN);
+      uintptr_t addr = reinterpret_cast<uintptr_t>(&m_mem[i][0]);
+      m_buf[i] = &m_mem[i][0] + (IO_ALIGN - addr % IO_ALIGN) % IO_ALIGN;
+    }
+    m_thread = std::thread(&AsyncFileSerializer::IOThread, this);
+  }
+
+  AsyncFileSerializer::~AsyncFileSerializer() {
+    try {
+      Sync();
+    } catch (const std::exception &e) {
+      std::cerr << "Error closing file: " << e.what() << std::endl;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+    file_close(m_fd);
+  }
+
+  void AsyncFileSerializer::Serialize(const unsigned char *data, size_t len) {
+    m_filebytes += len;
+    while (len > 0) {
+      size_t n = std::min(len, m_capacity - m_used);
+      memcpy(m_buf[m_fill] + m_used, data, n);
+      m_used += n;
+      data += n;
+      len -= n;
+      if (m_used == m_capacity)
+        Submit(false);
+    }
+  }
+
+  void AsyncFileSerializer::WaitIdle(std::unique_lock<std::mutex> &lock) {
+    while (m_ioready)
+      m_cond.wait(lock);
+    if (m_error != "") {
+      std::string msg = m_error;
+      m_error = "";
+      EUDAQ_THROW("Error writing to file: " + msg);
+    }
+  }
+
+  void AsyncFileSerializer::Submit(bool all) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    WaitIdle(lock);
+    size_t size = m_used, tail = 0;
+    if (m_direct && !all) {
+      // keep the incomplete block for the next write
+      tail = size % IO_ALIGN;
+      size -= tail;
+    }
+    if (size == 0)
+      return;
+    int next = 1 - m_fill;
+    memcpy(m_buf[next], m_buf[m_fill] + size, tail);
+    m_ioready = size;
+    m_fill = next;
+    m_used = tail;
+    m_cond.notify_all();
+  }
+
+  void AsyncFileSerializer::Flush() { Submit(false); }
+
+  void AsyncFileSerializer::Sync() {
+    if (m_direct && m_used % IO_ALIGN) {
+      // the tail cannot be written with O_DIRECT, so continue without it
+      std::unique_lock<std::mutex> lock(m_mutex);
+      WaitIdle(lock);
+      file_undirect(m_fd);
+      m_direct = false;
+    }
+    Submit(true);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    WaitIdle(lock);
+    if (file_sync(m_fd) != 0) {
+      EUDAQ_THROW("Error syncing file: " + to_string(errno) + ", " +
+                  strerror(errno));
+    }
+  }
+
+  uint64_t AsyncFileSerializer::PendingBytes() const {
+    return m_filebytes - m_written;
+  }
+
+  void AsyncFileSerializer::IOThread() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      while (!m_ioready && !m_stop)
+        m_cond.wait(lock);
+      if (!m_ioready)
+        break;
+      // the buffer not being filled is owned by this thread until m_ioready
+      // is cleared
+      const unsigned char *data = m_buf[1 - m_fill];
+      size_t size = m_ioready;
+      lock.unlock();
+      std::string err = write_all(m_fd, data, size);
+      lock.lock();
+      if (err != "")
+        m_error = err;
+      m_written += size;
+      m_ioready = 0;
+      m_cond.notify_all();
+    }
+  }
+
+  struct CompressedFileSerializer::Frame {
+    enum State { QUEUED, BUSY, DONE };
+    std::vector<unsigned char> raw, packed;
+    CompressionCodec codec;
+    State state;
+  };
+
+  CompressedFileSerializer::CompressedFileSerializer(const std::string &fname,
+                                                     CompressionCodec codec,
+                                                     size_t framesize,
+                                                     unsigned threads,
+                                                     bool overwrite)
+      : m_out(0), m_codec(codec), m_framesize(framesize ? framesize : 1),
+        m_current(new Frame), m_fileoffset(0), m_stop(false), m_written(0) {
+    if (!CompressionAvailable(codec))
+      EUDAQ_THROW("Compression not available in this build: " +
+                  CompressionName(codec));
+    if (!overwrite) {
+      FILE *fd = fopen(fname.c_str(), "rb");
+      if (fd) {
+        fclose(fd);
+        EUDAQ_THROWX(FileExistsException, "File already exists: " + fname);
+      }
+    }
+    m_out = fopen(fname.c_str(), "wb");
+    if (!m_out)
+      EUDAQ_THROWX(FileNotFoundException, "Unable to open file: " + fname);
+    std::vector<unsigned char> header;
+    put_le(header, Event::str2id("ZRAW"), 4);
+    put_le(header, CMP_VERSION, 4);
+    fwrite(&header[0], 1, header.size(), m_out);
+    fflush(m_out);
+    m_fileoffset = header.size();
+    m_current->raw.reserve(m_framesize);
+    if (threads == 0)
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    m_maxframes = 2 * threads + 2;
+    for (unsigned i = 0; i < threads; ++i)
+      m_workers.push_back(std::thread(&CompressedFileSerializer::Worker, this));
+    m_writer = std::thread(&CompressedFileSerializer::Writer, this);
+  }
+
+  CompressedFileSerializer::~CompressedFileSerializer() {
+    try {
+      Sync();
+    } catch (const std::exception &e) {
+      std::cerr << "Error closing file: " << e.what() << std::endl;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_cond.notify_all();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+      m_workers[i].join();
+    m_writer.join();
+    WriteIndex();
+    fclose(m_out);
+  }
+
+  void CompressedFileSerializer::Serialize(const unsigned char *data,
+                                           size_t len) {
+    m_filebytes += len;
+    while (len > 0) {
+      size_t n = std::min(len, m_framesize - m_current->raw.size());
+      m_current->raw.insert(m_current->raw.end(), data, data + n);
+      data += n;
+      len -= n;
+      if (m_current->raw.size() == m_framesize)
+        Seal();
+    }
+  }
+
+  void CompressedFileSerializer::Seal() {
+    if (m_current->raw.empty())
+      return;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_frames.size() >= m_maxframes && m_error == "")
+      m_cond.wait(lock);
+    if (m_error != "") {
+      std::string msg = m_error;
+      m_error = "";
+      EUDAQ_THROW("Error writing to file: " + msg);
+    }
+    m_current->state = Frame::QUEUED;
+    m_frames.push_back(m_current);
+    if (m_free.empty()) {
+      m_current.reset(new Frame);
+      m_current->raw.reserve(m_framesize);
+    } else {
+      m_current = m_free.back();
+      m_free.pop_back();
+      m_current->raw.clear();
+    }
+    m_cond.notify_all();
+  }
+
+  void CompressedFileSerializer::WaitWritten(
+      std::unique_lock<std::mutex> &lock) {
+    while (!m_frames.empty() && m_error == "")
+      m_cond.wait(lock);
+    if (m_error != "") {
+      std::string msg = m_error;
+      m_error = "";
+      EUDAQ_THROW("Error writing to file: " + msg);
+    }
+  }
+
+  void CompressedFileSerializer::Flush() { Seal(); }
+
+  void CompressedFileSerializer::Sync() {
+    Seal();
+    std::unique_lock<std::mutex> lock(m_mutex);
+    WaitWritten(lock);
+#if EUDAQ_PLATFORM_IS(WIN32)
+    _commit(_fileno(m_out));
+#else
+    fsync(fileno(m_out));
+#endif
+  }
+
+  uint64_t CompressedFileSerializer::PendingBytes() const {
+    return m_filebytes - m_written;
+  }
+
+  void CompressedFileSerializer::Worker() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      std::shared_ptr<Frame> frame;
+      for (size_t i = 0; i < m_frames.size() && !frame; ++i) {
+        if (m_frames[i]->state == Frame::QUEUED)
+          frame = m_frames[i];
+      }
+      if (!frame) {
+        if (m_stop)
+          break;
+        m_cond.wait(lock);
+        continue;
+      }
+      frame->state = Frame::BUSY;
+      lock.unlock();
+      frame->codec = m_codec;
+      if (!Compress(m_codec, frame->raw.data(), frame->raw.size(),
+                    frame->packed))
+        frame->codec = COMPRESS_NONE;
+      lock.lock();
+      frame->state = Frame::DONE;
+      m_cond.notify_all();
+    }
+  }
+
+  void CompressedFileSerializer::Writer() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::vector<unsigned char> header;
+    for (;;) {
+      while (!(m_stop && m_frames.empty()) &&
+             (m_frames.empty() || m_frames.front()->state != Frame::DONE))
+        m_cond.wait(lock);
+      if (m_frames.empty())
+        break;
+      // frames are only removed by this thread
+      std::shared_ptr<Frame> frame = m_frames.front();
+      lock.unlock();
+      const std::vector<unsigned char> &data =
+          frame->codec == COMPRESS_NONE ? frame->raw : frame->packed;
+      header.clear();
+      put_le(header, Event::str2id("ZFRM"), 4);
+      put_le(header, frame->codec, 4);
+      put_le(header, frame->raw.size(), 4);
+      put_le(header, data.size(), 4);
+      std::string err;
+      if (fwrite(&header[0], 1, header.size(), m_out) != header.size() ||
+          fwrite(&data[0], 1, data.size(), m_out) != data.size() ||
+          fflush(m_out) != 0)
+        err = to_string(errno) + ", " + strerror(errno);
+      lock.lock();
+      if (err != "")
+        m_error = err;
+      m_index.push_back(m_written);
+      m_index.push_back(m_fileoffset);
+      m_index.push_back(frame->raw.size());
+      m_fileoffset += header.size() + data.size();
+      m_written += frame->raw.size();
+      m_frames.pop_front();
+      m_free.push_back(frame);
+      m_cond.notify_all();
+    }
+  }
+
+  void CompressedFileSerializer::WriteIndex() {
+    std::vector<unsigned char> buf;
+    put_le(buf, Event::str2id("ZIDX"), 4);
+    put_le(buf, m_index.size() / 3, 4);
+    for (size_t i = 0; i < m_index.size(); i += 3) {
+      put_le(buf, m_index[i], 8);
+      put_le(buf, m_index[i + 1], 8);
+      put_le(buf, m_index[i + 2], 4);
+    }
+    put_le(buf, m_fileoffset, 8);
+    put_le(buf, Event::str2id("ZEND"), 4);
+    if (fwrite(&buf[0], 1, buf.size(), m_out) != buf.size())
+      std::cerr << "Error writing frame index: " << strerror(errno)
+                << std::endl;
+  }
+
+  FlushPolicy::FlushPolicy(const std::string &params)
+      : async(false), direct(false), buffersize(1 << 22),
+        codec(COMPRESS_NONE), framesize(1 << 21), threads(0), flushbytes(0),
+        flushseconds(0), m_lastbytes(0), m_lastflush(Time::Current()) {
+    std::vector<std::string> opts = split(params, ",");
+    for (size_t i = 0; i < opts.size(); ++i) {
+      std::string opt = trim(opts[i]), val;
+      size_t eq = opt.find('=');
+      if (eq != std::string::npos) {
+        val = trim(opt.substr(eq + 1));
+        opt = trim(opt.substr(0, eq));
+      }
+      if (opt == "") {
+        continue;
+      } else if (opt == "async") {
+        async = true;
+      } else if (opt == "direct") {
+        async = direct = true;
+      } else if (opt == "buffer") {
+        buffersize = parse_bytes(val);
+      } else if (opt == "flushbytes") {
+        flushbytes = parse_bytes(val);
+      } else if (opt == "flushms") {
+        flushseconds = from_string(val, 0.0) / 1e3;
+      } else if (opt == "compress") {
+        codec = CompressionFromName(val);
+      } else if (opt == "frame") {
+        framesize = parse_bytes(val);
+      } else if (opt == "threads") {
+        threads = from_string(val, 0u);
+      } else {
+        EUDAQ_THROW("Unknown file writer option: " + opt);
+      }
+    }
+    // small compressed frames would compress badly
+    if ((async || codec != COMPRESS_NONE) && flushbytes == 0 &&
+        flushseconds == 0)
+      flushseconds = 1.0;
+  }
+
+  FileSerializer *FlushPolicy::Open(const std::string &fname) const {
+    if (codec != COMPRESS_NONE)
+      return new CompressedFileSerializer(fname, codec, framesize, threads);
+    if (async)
+      return new AsyncFileSerializer(fname, buffersize, direct);
+    return new FileSerializer(fname);
+  }
+
+  bool FlushPolicy::FlushDue(uint64_t filebytes) {
+    if (flushbytes == 0 && flushseconds == 0)
+      return true;
+    bool due = flushbytes && filebytes - m_lastbytes >= flushbytes;
+    Time now = Time::Current();
+    if (flushseconds > 0 &&
+        Time(now - m_lastflush).Seconds() >= flushseconds)
+      due = true;
+    if (due) {
+      m_lastbytes = filebytes;
+      m_lastflush = now;
+    }
+    return due;
+  }
+
   FileDeserializer::FileDeserializer(const std::string &fname, bool faileof,
                                      size_t buffersize)
-      : m_file(0), m_faileof(faileof), m_buf(buffersize), m_start(&m_buf[0]),
-        m_stop(m_start) {
+      : m_start(0), m_stop(0), m_file(0), m_faileof(faileof),
+        m_buf(buffersize) {
+    m_start = m_stop = &m_buf[0];
     m_file = fopen(fname.c_str(), "rb");
     if (!m_file)
       EUDAQ_THROWX(FileNotFoundException, "Unable to open file: " + fname);
@@ -59,6 +590,14 @@ namespace eudaq {
     }
   }
 
+  FileDeserializer::FileDeserializer()
+      : m_start(0), m_stop(0), m_file(0), m_faileof(true) {}
+
+  FileDeserializer::~FileDeserializer() {
+    if (m_file)
+      fclose(m_file);
+  }
+
   bool FileDeserializer::HasData() {
     if (level() == 0)
       FillBuffer();
@@ -66,6 +605,11 @@ namespace eudaq {
   }
 
   size_t FileDeserializer::FillBuffer(size_t min) {
+    if (!m_file) {
+      if (level() < min)
+        throw FileReadException("End of File encountered");
+      return 0;
+    }
     clearerr(m_file);
     if (level() == 0)
       m_start = m_stop = &m_buf[0];
@@ -140,14 +684,343 @@ namespace eudaq {
         ev = std::shared_ptr<eudaq::Event>(EventFactory::Create(*this));
       }
     } else {
-      BufferSerializer buf;
-      for (size_t i = 0; i <= skip; ++i) {
+      // records are length-prefixed, so they can be skipped undecoded
+      for (size_t i = 0; i < skip; ++i) {
         if (!HasData())
-          break;
-        read(buf);
+          return false;
+        Skip(read<unsigned>());
+      }
+      if (!HasData())
+        return false;
+      ev = ReadRecord();
+    }
+    return true;
+  }
+
+  std::shared_ptr<Event> FileDeserializer::ReadRecord() {
+    BufferSerializer buf;
+    read(buf);
+    return std::shared_ptr<eudaq::Event>(eudaq::EventFactory::Create(buf));
+  }
+
+  void FileDeserializer::Skip(size_t len) {
+    if (len <= level()) {
+      m_start += len;
+      return;
+    }
+    len -= level();
+    m_start = m_stop;
+    if (!m_file || file_seek(m_file, len, SEEK_CUR) != 0) {
+      EUDAQ_THROWX(FileReadException, "Unable to skip " + to_string(len) +
+                                          " bytes");
+    }
+  }
+
+  uint64_t FileDeserializer::Position() const {
+    return m_file ? (uint64_t)file_tell(m_file) - level() : 0;
+  }
+
+  void FileDeserializer::Seek(uint64_t pos) {
+    if (!m_file || file_seek(m_file, pos, SEEK_SET) != 0) {
+      EUDAQ_THROWX(FileReadException,
+                   "Unable to seek to position " + to_string(pos));
+    }
+    m_start = m_stop = &m_buf[0];
+  }
+
+  struct MappedFileDeserializer::Mapping {
+    Mapping() : data(0), size(0) {}
+    ~Mapping() {
+#if !EUDAQ_PLATFORM_IS(WIN32)
+      if (data)
+        munmap(data, size);
+#endif
+    }
+    void *data;
+    size_t size;
+  };
+
+  MappedFileDeserializer::MappedFileDeserializer(const std::string &fname)
+      : m_map(new Mapping), m_prefetched(0) {
+#if EUDAQ_PLATFORM_IS(WIN32)
+    EUDAQ_THROWX(FileReadException,
+                 "Memory mapped files are not supported on this platform");
+#else
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+      EUDAQ_THROWX(FileNotFoundException, "Unable to open file: " + fname);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      EUDAQ_THROWX(FileReadException, "Unable to stat file: " + fname);
+    }
+    m_map->size = st.st_size;
+    if (m_map->size > 0) {
+      void *data = mmap(0, m_map->size, PROT_READ, MAP_SHARED, fd, 0);
+      if (data == MAP_FAILED) {
+        close(fd);
+        EUDAQ_THROWX(FileReadException, "Unable to map file: " + fname);
+      }
+      m_map->data = data;
+      madvise(data, m_map->size, MADV_SEQUENTIAL);
+    }
+    // the mapping stays valid after closing the descriptor
+    close(fd);
+    // the data is only ever read through m_start
+    m_start = static_cast<ptr_t>(m_map->data);
+    m_stop = m_start + m_map->size;
+    m_prefetched = m_start;
+#endif
+  }
+
+  bool MappedFileDeserializer::HasData() {
+#if !EUDAQ_PLATFORM_IS(WIN32)
+    if (m_start + PREFETCH_SIZE / 2 > m_prefetched && m_prefetched < m_stop) {
+      // keep the next part of the file on its way into the page cache
+      size_t pagesize = sysconf(_SC_PAGESIZE);
+      ptr_t base = static_cast<ptr_t>(m_map->data);
+      ptr_t from = base + (m_start - base) / pagesize * pagesize;
+      ptr_t to = std::min(m_start + PREFETCH_SIZE, m_stop);
+      madvise(from, to - from, MADV_WILLNEED);
+      m_prefetched = to;
+    }
+#endif
+    return level() > 0;
+  }
+
+  const unsigned char *
+  MappedFileDeserializer::ReadReference(size_t size,
+                                        std::shared_ptr<const void> &owner) {
+    if (size > level())
+      throw FileReadException("End of File encountered");
+    const unsigned char *result = m_start;
+    m_start += size;
+    owner = m_map;
+    return result;
+  }
+
+  uint64_t MappedFileDeserializer::Position() const {
+    return m_start - static_cast<ptr_t>(m_map->data);
+  }
+
+  void MappedFileDeserializer::Seek(uint64_t pos) {
+    if (pos > m_map->size) {
+      EUDAQ_THROWX(FileReadException,
+                   "Unable to seek to position " + to_string(pos));
+    }
+    m_start = static_cast<ptr_t>(m_map->data) + pos;
+    m_prefetched = m_start;
+  }
+
+  std::shared_ptr<Event> MappedFileDeserializer::ReadRecord() {
+    unsigned len = read<unsigned>();
+    if (len > level())
+      throw FileReadException("End of File encountered");
+    // decode in place; data blocks keep the mapping alive
+    BufferDeserializer des(m_start, len, m_map);
+    m_start += len;
+    return std::shared_ptr<eudaq::Event>(eudaq::EventFactory::Create(des));
+  }
+
+  CompressedFileDeserializer::CompressedFileDeserializer(
+      const std::string &fname, bool faileof)
+      : m_in(0), m_faileof(faileof), m_complete(false), m_scanpos(CMP_HEADER),
+        m_current(size_t(-1)) {
+    m_in = fopen(fname.c_str(), "rb");
+    if (!m_in)
+      EUDAQ_THROWX(FileNotFoundException, "Unable to open file: " + fname);
+    unsigned char header[CMP_HEADER];
+    if (!ReadFile(0, header, CMP_HEADER, false) ||
+        get_le(header, 4) != Event::str2id("ZRAW"))
+      EUDAQ_THROWX(FileReadException, "Not a compressed file: " + fname);
+    if (get_le(header + 4, 4) != CMP_VERSION)
+      EUDAQ_THROWX(FileReadException,
+                   "Unsupported compressed file version in " + fname);
+    LoadIndex();
+  }
+
+  CompressedFileDeserializer::~CompressedFileDeserializer() {
+    if (m_in)
+      fclose(m_in);
+  }
+
+  bool CompressedFileDeserializer::IsCompressed(const std::string &fname) {
+    FILE *f = fopen(fname.c_str(), "rb");
+    if (!f)
+      return false;
+    unsigned char magic[4];
+    bool result = fread(magic, 1, 4, f) == 4 &&
+                  get_le(magic, 4) == Event::str2id("ZRAW");
+    fclose(f);
+    return result;
+  }
+
+  bool CompressedFileDeserializer::ReadFile(uint64_t pos, unsigned char *data,
+                                            size_t len, bool wait) {
+    for (;;) {
+      clearerr(m_in);
+      if (file_seek(m_in, pos, SEEK_SET) == 0 &&
+          fread(data, 1, len, m_in) == len)
+        return true;
+      if (!wait)
+        return false;
+      if (m_interrupting) {
+        m_interrupting = false;
+        throw InterruptedException();
       }
-      ev = std::shared_ptr<eudaq::Event>(eudaq::EventFactory::Create(buf));
+      // the file is still being written
+      mSleep(10);
     }
+  }
+
+  bool CompressedFileDeserializer::LoadIndex() {
+    if (file_seek(m_in, 0, SEEK_END) != 0)
+      return false;
+    uint64_t size = file_tell(m_in);
+    unsigned char trailer[INDEX_TRAILER];
+    if (size < CMP_HEADER + 8 + INDEX_TRAILER ||
+        !ReadFile(size - INDEX_TRAILER, trailer, INDEX_TRAILER, false) ||
+        get_le(trailer + 8, 4) != Event::str2id("ZEND"))
+      return false; // not closed yet, the frames are found by ScanFrame
+    uint64_t pos = get_le(trailer, 8);
+    unsigned char head[8];
+    if (pos < CMP_HEADER || pos > size - INDEX_TRAILER - 8 ||
+        !ReadFile(pos, head, 8, false) ||
+        get_le(head, 4) != Event::str2id("ZIDX"))
+      return false;
+    size_t n = get_le(head + 4, 4);
+    if (pos + 8 + n * INDEX_ENTRY + INDEX_TRAILER != size)
+      return false;
+    std::vector<unsigned char> buf(n * INDEX_ENTRY);
+    if (n && !ReadFile(pos + 8, &buf[0], buf.size(), false))
+      return false;
+    m_index.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      const unsigned char *p = &buf[i * INDEX_ENTRY];
+      m_index[i].rawoffset = get_le(p, 8);
+      m_index[i].fileoffset = get_le(p + 8, 8);
+      m_index[i].rawsize = (uint32_t)get_le(p + 16, 4);
+    }
+    m_scanpos = pos;
+    m_complete = true;
     return true;
   }
+
+  bool CompressedFileDeserializer::ScanFrame(bool wait) {
+    if (m_complete)
+      return false;
+    unsigned char header[FRAME_HEADER];
+    if (!ReadFile(m_scanpos, header, 4, wait))
+      return false;
+    uint64_t magic = get_le(header, 4);
+    if (magic == Event::str2id("ZIDX")) {
+      m_complete = true;
+      return false;
+    }
+    if (magic != Event::str2id("ZFRM"))
+      EUDAQ_THROWX(FileReadException, "Corrupt compressed file at offset " +
+                                          to_string(m_scanpos));
+    if (!ReadFile(m_scanpos, header, FRAME_HEADER, wait))
+      return false;
+    FrameInfo info;
+    info.rawoffset = m_index.empty() ? 0 : m_index.back().rawoffset +
+                                               m_index.back().rawsize;
+    info.fileoffset = m_scanpos;
+    info.rawsize = (uint32_t)get_le(header + 8, 4);
+    m_index.push_back(info);
+    m_scanpos += FRAME_HEADER + get_le(header + 12, 4);
+    return true;
+  }
+
+  bool CompressedFileDeserializer::LoadFrame(size_t i, bool wait) {
+    const FrameInfo &info = m_index[i];
+    unsigned char header[FRAME_HEADER];
+    if (!ReadFile(info.fileoffset, header, FRAME_HEADER, wait))
+      return false;
+    m_packed.resize(get_le(header + 12, 4));
+    if (!m_packed.empty() && !ReadFile(info.fileoffset + FRAME_HEADER,
+                                       &m_packed[0], m_packed.size(), wait))
+      return false;
+    m_raw.resize(info.rawsize);
+    Decompress((CompressionCodec)get_le(header + 4, 4), m_packed.data(),
+               m_packed.size(), m_raw.data(), m_raw.size());
+    m_current = i;
+    m_start = m_raw.data();
+    m_stop = m_start + m_raw.size();
+    return true;
+  }
+
+  bool CompressedFileDeserializer::HasData() {
+    if (level() > 0)
+      return true;
+    size_t next = m_current == size_t(-1) ? 0 : m_current + 1;
+    while (next >= m_index.size()) {
+      if (!ScanFrame(false))
+        return false;
+    }
+    return LoadFrame(next, false) && level() > 0;
+  }
+
+  void CompressedFileDeserializer::Deserialize(unsigned char *data,
+                                               size_t len) {
+    while (len > 0) {
+      if (level() == 0) {
+        size_t next = m_current == size_t(-1) ? 0 : m_current + 1;
+        while (next >= m_index.size()) {
+          if (!ScanFrame(!m_faileof))
+            throw FileReadException("End of File encountered");
+        }
+        if (!LoadFrame(next, !m_faileof))
+          throw FileReadException("End of File encountered");
+      }
+      size_t n = std::min(len, level());
+      memcpy(data, m_start, n);
+      m_start += n;
+      data += n;
+      len -= n;
+    }
+  }
+
+  void CompressedFileDeserializer::Skip(size_t len) {
+    if (len <= level()) {
+      m_start += len;
+      return;
+    }
+    Seek(Position() + len);
+  }
+
+  uint64_t CompressedFileDeserializer::Position() const {
+    if (m_current == size_t(-1))
+      return 0;
+    return m_index[m_current].rawoffset + (m_start - m_raw.data());
+  }
+
+  void CompressedFileDeserializer::Seek(uint64_t pos) {
+    while (m_index.empty() ||
+           m_index.back().rawoffset + m_index.back().rawsize <= pos) {
+      if (!ScanFrame(false))
+        break;
+    }
+    if (pos == 0 && m_index.empty()) {
+      m_current = size_t(-1);
+      m_start = m_stop = 0;
+      return;
+    }
+    // the last frame starting at or before pos
+    size_t lo = 0, hi = m_index.size();
+    while (hi - lo > 1) {
+      size_t mid = (lo + hi) / 2;
+      if (m_index[mid].rawoffset <= pos)
+        lo = mid;
+      else
+        hi = mid;
+    }
+    if (m_index.empty() || pos > m_index[lo].rawoffset + m_index[lo].rawsize)
+      EUDAQ_THROWX(FileReadException,
+                   "Unable to seek to position " + to_string(pos));
+    if (lo != m_current && !LoadFrame(lo, false))
+      EUDAQ_THROWX(FileReadException,
+                   "Unable to read frame at position " + to_string(pos));
+    m_start = m_raw.data() + (pos - m_index[lo].rawoffset);
+  }
 }
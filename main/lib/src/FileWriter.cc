@@ -21,11 +21,19 @@ namespace eudaq {
 
   FileWriter *FileWriterFactory::Create(const std::string &name,
                                         const std::string &params) {
+    // parameters may also be given as "type:params"
+    std::string type = name, param = params;
+    size_t colon = name.find(':');
+    if (colon != std::string::npos) {
+      type = name.substr(0, colon);
+      if (param == "")
+        param = name.substr(colon + 1);
+    }
     map_t::const_iterator it =
-        FileWriterMap().find(name == "" ? "native" : name);
+        FileWriterMap().find(type == "" ? "native" : type);
     if (it == FileWriterMap().end())
-      EUDAQ_THROW("Unknown file writer: " + name);
-    return (it->second)(params);
+      EUDAQ_THROW("Unknown file writer: " + type);
+    return (it->second)(param);
   }
 
   std::vector<std::string> FileWriterFactory::GetTypes() {
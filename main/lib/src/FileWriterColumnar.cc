@@ -0,0 +1,107 @@
+#include "eudaq/FileNamer.hh"
+#include "eudaq/FileWriter.hh"
+#include "eudaq/FileSerializer.hh"
+#include "eudaq/PluginManager.hh"
+#include "eudaq/ColumnarFile.hh"
+
+namespace eudaq {
+
+  /** Writes the hits of StandardEvents column by column (see ColumnarFile).
+   *  The parameters are a comma separated list of:
+   *   - none, fast, zlib or zstd: the compression (default: fast)
+   *   - chunk=N: the number of events per chunk (default 1000)
+   */
+  class FileWriterColumnar : public FileWriter {
+  public:
+    FileWriterColumnar(const std::string &);
+    virtual void StartRun(unsigned);
+    virtual void WriteEvent(const DetectorEvent &);
+    virtual bool UsesStandardEvent() const { return true; }
+    virtual void WriteStandardEvent(const DetectorEvent &,
+                                    const StandardEvent &);
+    virtual uint64_t FileBytes() const;
+    virtual ~FileWriterColumnar();
+
+  private:
+    void Add(const StandardEvent &);
+    void Close();
+    FileSerializer *m_ser;
+    ColumnarChunk m_chunk;
+    CompressionCodec m_codec;
+    size_t m_chunksize;
+  };
+
+  namespace {
+    static RegisterFileWriter<FileWriterColumnar> reg("columnar");
+  }
+
+  FileWriterColumnar::FileWriterColumnar(const std::string &param)
+      : m_ser(0), m_codec(DefaultCompression()), m_chunksize(1000) {
+    std::vector<std::string> opts = split(param, ",", true);
+    for (size_t i = 0; i < opts.size(); ++i) {
+      if (opts[i] == "") {
+        continue;
+      } else if (opts[i].compare(0, 6, "chunk=") == 0) {
+        m_chunksize = from_string(opts[i].substr(6), m_chunksize);
+        if (m_chunksize == 0)
+          EUDAQ_THROW("FileWriterColumnar: bad chunk size: " + opts[i]);
+      } else {
+        m_codec = CompressionFromName(opts[i]);
+      }
+    }
+  }
+
+  void FileWriterColumnar::StartRun(unsigned runnumber) {
+    Close();
+    m_ser = new FileSerializer(
+        FileNamer(m_filepattern).Set('X', ".col").Set('R', runnumber));
+    ColumnarChunk::WriteHeader(*m_ser, runnumber);
+  }
+
+  void FileWriterColumnar::WriteEvent(const DetectorEvent &ev) {
+    if (!m_ser)
+      EUDAQ_THROW("FileWriterColumnar: Attempt to write unopened file");
+    if (ev.IsBORE()) {
+      PluginManager::Initialize(ev);
+      return;
+    } else if (ev.IsEORE()) {
+      if (m_chunk.NumEvents())
+        m_chunk.Write(*m_ser, m_codec);
+      m_ser->Flush();
+      return;
+    }
+    Add(PluginManager::ConvertToStandard(ev));
+  }
+
+  void FileWriterColumnar::WriteStandardEvent(const DetectorEvent &ev,
+                                              const StandardEvent &sev) {
+    if (ev.IsBORE() || ev.IsEORE()) {
+      WriteEvent(ev); // handled without the converted event
+      return;
+    }
+    if (!m_ser)
+      EUDAQ_THROW("FileWriterColumnar: Attempt to write unopened file");
+    Add(sev);
+  }
+
+  void FileWriterColumnar::Add(const StandardEvent &sev) {
+    m_chunk.AddEvent(sev);
+    if (m_chunk.NumEvents() >= m_chunksize) {
+      m_chunk.Write(*m_ser, m_codec);
+      m_ser->Flush();
+    }
+  }
+
+  void FileWriterColumnar::Close() {
+    if (m_ser && m_chunk.NumEvents())
+      m_chunk.Write(*m_ser, m_codec);
+    delete m_ser;
+    m_ser = 0;
+  }
+
+  FileWriterColumnar::~FileWriterColumnar() { Close(); }
+
+  uint64_t FileWriterColumnar::FileBytes() const {
+    return m_ser ? m_ser->FileBytes() : 0;
+  }
+}
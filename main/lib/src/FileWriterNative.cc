@@ -1,6 +1,7 @@
 #include "eudaq/FileNamer.hh"
 #include "eudaq/FileWriter.hh"
 #include "eudaq/FileSerializer.hh"
+#include "eudaq/EventIndex.hh"
 //#include "eudaq/Logger.hh"
 
 namespace eudaq {
@@ -11,9 +12,12 @@ namespace eudaq {
     virtual void StartRun(unsigned);
     virtual void WriteEvent(const DetectorEvent &);
     virtual uint64_t FileBytes() const;
+    virtual uint64_t PendingBytes() const;
     virtual ~FileWriterNative();
 
   private:
+    FlushPolicy m_policy;
+    FileSerializer *m_idx; ///< Event index next to the raw file
     FileSerializer *m_ser;
   };
 
@@ -21,26 +25,52 @@ namespace eudaq {
     static RegisterFileWriter<FileWriterNative> reg("native");
   }
 
-  FileWriterNative::FileWriterNative(const std::string & /*param*/) : m_ser(0) {
+  FileWriterNative::FileWriterNative(const std::string &param)
+      : m_policy(param), m_idx(0), m_ser(0) {
     // EUDAQ_DEBUG("Constructing FileWriterNative(" + to_string(param) + ")");
   }
 
   void FileWriterNative::StartRun(unsigned runnumber) {
     delete m_ser;
-    m_ser = new FileSerializer(
-        FileNamer(m_filepattern).Set('X', ".raw").Set('R', runnumber));
+    m_ser = 0;
+    delete m_idx;
+    m_idx = 0;
+    std::string fname =
+        FileNamer(m_filepattern).Set('X', ".raw").Set('R', runnumber);
+    m_ser = m_policy.Open(fname);
+    // the raw file is new, so an index already there is stale
+    m_idx = new FileSerializer(EventIndex::IndexName(fname), true);
+    EventIndex::WriteHeader(*m_idx);
   }
 
   void FileWriterNative::WriteEvent(const DetectorEvent &ev) {
     if (!m_ser)
       EUDAQ_THROW("FileWriterNative: Attempt to write unopened file");
+    if (m_idx)
+      EventIndex::Append(*m_idx, ev, m_ser->FileBytes());
     m_ser->write(ev);
-    m_ser->Flush();
+    if (ev.IsEORE()) {
+      // make sure the complete run is on disk
+      m_ser->Sync();
+      if (m_idx)
+        m_idx->Flush();
+    } else if (m_policy.FlushDue(m_ser->FileBytes())) {
+      m_ser->Flush();
+      if (m_idx)
+        m_idx->Flush();
+    }
   }
 
-  FileWriterNative::~FileWriterNative() { delete m_ser; }
+  FileWriterNative::~FileWriterNative() {
+    delete m_ser;
+    delete m_idx;
+  }
 
   uint64_t FileWriterNative::FileBytes() const {
     return m_ser ? m_ser->FileBytes() : 0;
   }
+
+  uint64_t FileWriterNative::PendingBytes() const {
+    return m_ser ? m_ser->PendingBytes() : 0;
+  }
 }
@@ -17,6 +17,9 @@ namespace eudaq {
     FileWriterRootC(const std::string &);
     virtual void StartRun(unsigned);
     virtual void WriteEvent(const DetectorEvent &);
+    virtual bool UsesStandardEvent() const { return true; }
+    virtual void WriteStandardEvent(const DetectorEvent &,
+                                    const StandardEvent &);
     virtual uint64_t FileBytes() const;
     virtual ~FileWriterRootC();
 
@@ -66,7 +69,15 @@ namespace eudaq {
       return;
     } else if (ev.IsEORE()) {
     }
-    StandardEvent sev = eudaq::PluginManager::ConvertToStandard(ev);
+    WriteStandardEvent(ev, eudaq::PluginManager::ConvertToStandard(ev));
+  }
+
+  void FileWriterRootC::WriteStandardEvent(const DetectorEvent &ev,
+                                           const StandardEvent &sev) {
+    if (ev.IsBORE()) {
+      WriteEvent(ev); // handled without the converted event
+      return;
+    }
     for (size_t iplane = 0; iplane < sev.NumPlanes(); ++iplane) {
 
       const eudaq::StandardPlane &plane = sev.GetPlane(iplane);
@@ -2,6 +2,7 @@
 #include "eudaq/FileWriter.hh"
 #include "eudaq/FileSerializer.hh"
 #include "eudaq/PluginManager.hh"
+#include "eudaq/CompactStandardEvent.hh"
 //#include "eudaq/Logger.hh"
 
 namespace eudaq {
@@ -11,19 +12,24 @@ namespace eudaq {
     FileWriterStandard(const std::string &);
     virtual void StartRun(unsigned);
     virtual void WriteEvent(const DetectorEvent &);
+    virtual bool UsesStandardEvent() const { return true; }
+    virtual void WriteStandardEvent(const DetectorEvent &,
+                                    const StandardEvent &);
     virtual uint64_t FileBytes() const;
     virtual ~FileWriterStandard();
 
   private:
+    void Write(const StandardEvent &);
     FileSerializer *m_ser;
+    bool m_compact; ///< Write CompactStandardEvents
   };
 
   namespace {
     static RegisterFileWriter<FileWriterStandard> reg("standard");
   }
 
-  FileWriterStandard::FileWriterStandard(const std::string & /*param*/)
-      : m_ser(0) {
+  FileWriterStandard::FileWriterStandard(const std::string &param)
+      : m_ser(0), m_compact(param == "compact") {
     // EUDAQ_DEBUG("Constructing FileWriterStandard(" + to_string(param) + ")");
   }
 
@@ -38,7 +44,26 @@ namespace eudaq {
       EUDAQ_THROW("FileWriterStandard: Attempt to write unopened file");
     if (ev.IsBORE())
       PluginManager::Initialize(ev);
-    m_ser->write(PluginManager::ConvertToStandard(ev));
+    Write(PluginManager::ConvertToStandard(ev));
+  }
+
+  void FileWriterStandard::WriteStandardEvent(const DetectorEvent &ev,
+                                              const StandardEvent &sev) {
+    if (ev.IsBORE()) {
+      WriteEvent(ev); // converted again after initializing the plugins
+      return;
+    }
+    if (!m_ser)
+      EUDAQ_THROW("FileWriterStandard: Attempt to write unopened file");
+    Write(sev);
+  }
+
+  void FileWriterStandard::Write(const StandardEvent &sev) {
+    if (m_compact) {
+      m_ser->write(CompactStandardEvent(sev));
+    } else {
+      m_ser->write(sev);
+    }
     m_ser->Flush();
   }
 
@@ -11,6 +11,9 @@ namespace eudaq {
     FileWriterTextCompact(const std::string &);
     virtual void StartRun(unsigned);
     virtual void WriteEvent(const DetectorEvent &);
+    virtual bool UsesStandardEvent() const { return true; }
+    virtual void WriteStandardEvent(const DetectorEvent &,
+                                    const StandardEvent &);
     virtual uint64_t FileBytes() const;
     virtual ~FileWriterTextCompact();
 
@@ -59,7 +62,16 @@ namespace eudaq {
     } else if (devent.IsEORE()) {
       return;
     }
-    StandardEvent sev = eudaq::PluginManager::ConvertToStandard(devent);
+    WriteStandardEvent(devent,
+                       eudaq::PluginManager::ConvertToStandard(devent));
+  }
+
+  void FileWriterTextCompact::WriteStandardEvent(const DetectorEvent &devent,
+                                                 const StandardEvent &sev) {
+    if (devent.IsBORE() || devent.IsEORE()) {
+      WriteEvent(devent); // handled without the converted event
+      return;
+    }
 
     if (firstEvent) {
       if (sev.NumPlanes() == 0) // only TLU Events
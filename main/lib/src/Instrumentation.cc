@@ -0,0 +1,346 @@
+#include "eudaq/Instrumentation.hh"
+#include "eudaq/Status.hh"
+#include "eudaq/Time.hh"
+#include "eudaq/Logger.hh"
+#include "eudaq/Utils.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#if !EUDAQ_PLATFORM_IS(WIN32)
+#include <pthread.h>
+#include <time.h>
+#endif
+
+namespace eudaq {
+
+  std::atomic<bool> Instrumentation::s_enabled(true);
+
+  namespace {
+
+    static const char *STAGE_NAMES[NUM_STAGES] = {
+        "SERIALIZE", "SEND",    "RECEIVE", "DESERIALIZE",
+        "BUILD",     "CONVERT", "WRITE",   "TOTAL"};
+
+    LatencyHistogram *Histograms() {
+      // never destroyed: events may still be handled during static
+      // destruction
+      static LatencyHistogram *histos = new LatencyHistogram[NUM_STAGES];
+      return histos;
+    }
+
+    std::string Micro(uint64_t ns) {
+      std::ostringstream s;
+      s << std::fixed << std::setprecision(ns < 10000 ? 2 : 0) << ns / 1e3;
+      return s.str();
+    }
+
+    void WriteTable(std::ostream &os, const LatencyHistogram::Snapshot *snaps) {
+      os << std::left << std::setw(12) << "stage" << std::right
+         << std::setw(12) << "count" << std::setw(12) << "mean/us"
+         << std::setw(12) << "p50/us" << std::setw(12) << "p90/us"
+         << std::setw(12) << "p99/us" << std::setw(12) << "max/us" << "\n";
+      for (int i = 0; i < NUM_STAGES; ++i) {
+        const LatencyHistogram::Snapshot &s = snaps[i];
+        if (!s.count)
+          continue;
+        os << std::left << std::setw(12) << STAGE_NAMES[i] << std::right
+           << std::setw(12) << s.count << std::setw(12)
+           << Micro((uint64_t)s.Mean()) << std::setw(12)
+           << Micro(s.Percentile(0.5)) << std::setw(12)
+           << Micro(s.Percentile(0.9)) << std::setw(12)
+           << Micro(s.Percentile(0.99)) << std::setw(12) << Micro(s.max)
+           << "\n";
+      }
+    }
+
+    /// Appends the statistics of each interval to a file
+    class Dumper {
+    public:
+      Dumper() : m_interval(10), m_done(true) {}
+      ~Dumper() { Stop(); }
+      void Start(const std::string &filename, double interval) {
+        Stop();
+        if (filename == "")
+          return;
+        m_filename = filename;
+        m_interval = interval > 0 ? interval : 10;
+        m_done = false;
+        for (int i = 0; i < NUM_STAGES; ++i)
+          m_last[i] = Histograms()[i].Snap();
+        m_thread.reset(new std::thread(&Dumper::Run, this));
+      }
+      void Stop() {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_done = true;
+        }
+        m_cond.notify_all();
+        if (m_thread) {
+          m_thread->join();
+          m_thread.reset();
+          Dump(); // the last interval
+        }
+      }
+
+    private:
+      void Run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_done) {
+          m_cond.wait_for(lock, std::chrono::milliseconds(
+                                    (long long)(m_interval * 1e3)));
+          if (!m_done)
+            Dump();
+        }
+      }
+      void Dump() {
+        LatencyHistogram::Snapshot diff[NUM_STAGES];
+        for (int i = 0; i < NUM_STAGES; ++i) {
+          LatencyHistogram::Snapshot now = Histograms()[i].Snap();
+          diff[i] = now.Since(m_last[i]);
+          m_last[i] = now;
+        }
+        std::ofstream file(m_filename.c_str(), std::ios::app);
+        if (!file) {
+          EUDAQ_WARN("Unable to write latency dump to " + m_filename);
+          return;
+        }
+        file << "# " << Time::Current().Formatted() << "\n";
+        WriteTable(file, diff);
+        file << "\n";
+      }
+      std::string m_filename;
+      double m_interval;
+      bool m_done;
+      LatencyHistogram::Snapshot m_last[NUM_STAGES];
+      std::unique_ptr<std::thread> m_thread;
+      std::mutex m_mutex;
+      std::condition_variable m_cond;
+    };
+
+    Dumper &GetDumper() {
+      static Dumper dumper;
+      return dumper;
+    }
+
+#if !EUDAQ_PLATFORM_IS(WIN32)
+    double CPUSeconds(clockid_t clock) {
+      timespec ts;
+      if (clock_gettime(clock, &ts) != 0)
+        return 0;
+      return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+
+    /// The CPU clocks of the threads given to SetThreadStage, and the time
+    /// of the threads of each stage that already exited
+    struct ThreadClocks {
+      ThreadClocks() {
+        for (int i = 0; i < NUM_STAGES; ++i)
+          exited[i] = 0;
+      }
+      std::mutex mutex;
+      std::vector<std::pair<InstrumentationStage, clockid_t>> live;
+      double exited[NUM_STAGES];
+    };
+
+    ThreadClocks &Clocks() {
+      // never destroyed, threads may exit during static destruction
+      static ThreadClocks *clocks = new ThreadClocks;
+      return *clocks;
+    }
+
+    /// Moves the thread's time to the exited ones when the thread ends
+    class ThreadClock {
+    public:
+      ThreadClock() : m_registered(false) {}
+      ~ThreadClock() {
+        if (m_registered)
+          Unregister();
+      }
+      void Register(InstrumentationStage stage) {
+        if (m_registered)
+          Unregister();
+        if (pthread_getcpuclockid(pthread_self(), &m_clock) != 0)
+          return;
+        ThreadClocks &clocks = Clocks();
+        std::lock_guard<std::mutex> lock(clocks.mutex);
+        // only the time from now on
+        m_stage = stage;
+        clocks.exited[stage] -= CPUSeconds(m_clock);
+        clocks.live.push_back(std::make_pair(stage, m_clock));
+        m_registered = true;
+      }
+
+    private:
+      void Unregister() {
+        ThreadClocks &clocks = Clocks();
+        std::lock_guard<std::mutex> lock(clocks.mutex);
+        clocks.exited[m_stage] += CPUSeconds(m_clock);
+        for (size_t i = 0; i < clocks.live.size(); ++i) {
+          if (clocks.live[i].second == m_clock) {
+            clocks.live.erase(clocks.live.begin() + i);
+            break;
+          }
+        }
+        m_registered = false;
+      }
+      bool m_registered;
+      InstrumentationStage m_stage;
+      clockid_t m_clock;
+    };
+#endif
+  }
+
+  LatencyHistogram::LatencyHistogram() { Reset(); }
+
+  size_t LatencyHistogram::Bucket(uint64_t ns) {
+    if (ns < (1u << SUB_BITS))
+      return (size_t)ns;
+    unsigned msb = 63;
+    while (!(ns >> msb))
+      --msb;
+    if (msb >= MAX_BITS)
+      return NUM_BUCKETS - 1;
+    return ((size_t)(msb - SUB_BITS + 1) << SUB_BITS) +
+           (size_t)((ns >> (msb - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+  }
+
+  uint64_t LatencyHistogram::BucketMax(size_t b) {
+    if (b < (1u << SUB_BITS))
+      return b;
+    unsigned msb = (unsigned)(b >> SUB_BITS) + SUB_BITS - 1;
+    uint64_t sub = b & ((1u << SUB_BITS) - 1);
+    uint64_t width = uint64_t(1) << (msb - SUB_BITS);
+    return (((uint64_t(1) << SUB_BITS) + sub) << (msb - SUB_BITS)) + width - 1;
+  }
+
+  LatencyHistogram::Snapshot LatencyHistogram::Snap() const {
+    Snapshot s;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
+      s.counts[i] = m_counts[i].load(std::memory_order_relaxed);
+    s.count = m_count.load(std::memory_order_relaxed);
+    s.sum = m_sum.load(std::memory_order_relaxed);
+    s.max = m_max.load(std::memory_order_relaxed);
+    return s;
+  }
+
+  void LatencyHistogram::Reset() {
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
+      m_counts[i] = 0;
+    m_count = m_sum = m_max = 0;
+  }
+
+  LatencyHistogram::Snapshot
+  LatencyHistogram::Snapshot::Since(const Snapshot &older) const {
+    Snapshot s(*this);
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
+      s.counts[i] -= older.counts[i];
+    s.count -= older.count;
+    s.sum -= older.sum;
+    // the maximum is only known for all entries, so bound it by the highest
+    // bucket used in the interval
+    size_t top = NUM_BUCKETS;
+    while (top > 0 && !s.counts[top - 1])
+      --top;
+    s.max = top ? std::min(BucketMax(top - 1), max) : 0;
+    return s;
+  }
+
+  uint64_t LatencyHistogram::Snapshot::Percentile(double q) const {
+    // the bucket counts and the total are read separately while recording
+    // goes on, so count from the buckets themselves
+    uint64_t total = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i)
+      total += counts[i];
+    if (!total)
+      return 0;
+    uint64_t rank = (uint64_t)(q * total);
+    if (rank >= total)
+      rank = total - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+      seen += counts[i];
+      if (seen > rank)
+        return std::min(BucketMax(i), max);
+    }
+    return max;
+  }
+
+  LatencyHistogram &Instrumentation::Get(InstrumentationStage stage) {
+    return Histograms()[stage];
+  }
+
+  void Instrumentation::Reset() {
+    for (int i = 0; i < NUM_STAGES; ++i)
+      Histograms()[i].Reset();
+  }
+
+  std::string Instrumentation::StageName(InstrumentationStage stage) {
+    if (stage < 0 || stage >= NUM_STAGES)
+      return "UNKNOWN";
+    return STAGE_NAMES[stage];
+  }
+
+  void Instrumentation::FillStatus(Status &status) {
+    for (int i = 0; i < NUM_STAGES; ++i) {
+      LatencyHistogram::Snapshot s = Histograms()[i].Snap();
+      if (!s.count)
+        continue;
+      status.SetTag(std::string("LAT_") + STAGE_NAMES[i],
+                    "n=" + to_string(s.count) + " mean=" +
+                        Micro((uint64_t)s.Mean()) + " p50=" +
+                        Micro(s.Percentile(0.5)) + " p99=" +
+                        Micro(s.Percentile(0.99)) + " max=" + Micro(s.max) +
+                        "us");
+    }
+  }
+
+  std::string Instrumentation::Report() {
+    LatencyHistogram::Snapshot snaps[NUM_STAGES];
+    for (int i = 0; i < NUM_STAGES; ++i)
+      snaps[i] = Histograms()[i].Snap();
+    std::ostringstream s;
+    WriteTable(s, snaps);
+    return s.str();
+  }
+
+  void Instrumentation::StartDump(const std::string &filename,
+                                  double interval) {
+    GetDumper().Start(filename, interval);
+  }
+
+  void Instrumentation::StopDump() { GetDumper().Stop(); }
+
+  void Instrumentation::SetThreadStage(InstrumentationStage stage) {
+#if !EUDAQ_PLATFORM_IS(WIN32)
+    static thread_local ThreadClock clock;
+    if (stage >= 0 && stage < NUM_STAGES)
+      clock.Register(stage);
+#else
+    (void)stage;
+#endif
+  }
+
+  double Instrumentation::ThreadCPU(InstrumentationStage stage) {
+#if !EUDAQ_PLATFORM_IS(WIN32)
+    if (stage < 0 || stage >= NUM_STAGES)
+      return 0;
+    ThreadClocks &clocks = Clocks();
+    std::lock_guard<std::mutex> lock(clocks.mutex);
+    double cpu = clocks.exited[stage];
+    for (size_t i = 0; i < clocks.live.size(); ++i) {
+      if (clocks.live[i].first == stage)
+        cpu += CPUSeconds(clocks.live[i].second);
+    }
+    return cpu;
+#else
+    (void)stage;
+    return 0;
+#endif
+  }
+}
@@ -0,0 +1,91 @@
+#include "eudaq/MemoryPool.hh"
+#include "eudaq/BoundedQueue.hh"
+
+#include <atomic>
+#include <new>
+
+namespace eudaq {
+
+  namespace {
+
+    static const size_t MIN_SHIFT = 4; // 16 bytes
+    static const size_t NUM_CLASSES = 17; // up to MemoryPool::MAX_SIZE
+    static const size_t CACHED_BYTES = 16 << 20; // per size class
+
+    struct SizeClasses {
+      SizeClasses() : misses(0), retained(0) {
+        for (size_t i = 0; i < NUM_CLASSES; ++i) {
+          size_t n = CACHED_BYTES >> (i + MIN_SHIFT);
+          lists[i].reset(
+              new BoundedQueue<void *>(n < 16 ? 16 : (n > 32768 ? 32768 : n)));
+        }
+      }
+      std::unique_ptr<BoundedQueue<void *>> lists[NUM_CLASSES];
+      std::atomic<uint64_t> misses;
+      std::atomic<uint64_t> retained; ///< Bytes on the free lists
+    };
+
+    SizeClasses &Classes() {
+      // never destroyed: events may still be released during static
+      // destruction
+      static SizeClasses *classes = new SizeClasses;
+      return *classes;
+    }
+
+    size_t ClassOf(size_t bytes) {
+      size_t c = 0;
+      while ((size_t(1) << (c + MIN_SHIFT)) < bytes)
+        ++c;
+      return c;
+    }
+  }
+
+  void *MemoryPool::Allocate(size_t bytes) {
+    SizeClasses &classes = Classes();
+    if (bytes > MAX_SIZE) {
+      ++classes.misses;
+      return ::operator new(bytes);
+    }
+    size_t c = ClassOf(bytes);
+    void *p = 0;
+    if (classes.lists[c]->TryPop(p)) {
+      classes.retained -= size_t(1) << (c + MIN_SHIFT);
+      return p;
+    }
+    ++classes.misses;
+    return ::operator new(size_t(1) << (c + MIN_SHIFT));
+  }
+
+  void MemoryPool::Deallocate(void *p, size_t bytes) {
+    if (!p)
+      return;
+    SizeClasses &classes = Classes();
+    if (bytes > MAX_SIZE) {
+      ::operator delete(p);
+      return;
+    }
+    size_t c = ClassOf(bytes);
+    size_t size = size_t(1) << (c + MIN_SHIFT);
+    // reserve the space first, so that concurrent releases cannot overshoot
+    if (classes.retained.fetch_add(size) + size > MAX_RETAINED ||
+        !classes.lists[c]->TryPush(std::move(p))) {
+      classes.retained -= size;
+      ::operator delete(p);
+    }
+  }
+
+  uint64_t MemoryPool::NumMisses() { return Classes().misses; }
+
+  uint64_t MemoryPool::RetainedBytes() { return Classes().retained; }
+
+  void MemoryPool::Trim() {
+    SizeClasses &classes = Classes();
+    for (size_t c = 0; c < NUM_CLASSES; ++c) {
+      void *p = 0;
+      while (classes.lists[c]->TryPop(p)) {
+        classes.retained -= size_t(1) << (c + MIN_SHIFT);
+        ::operator delete(p);
+      }
+    }
+  }
+}
@@ -8,10 +8,19 @@ namespace eudaq {
 
   Monitor::Monitor(const std::string &name, const std::string &runcontrol,
                    const unsigned lim, const unsigned skip_,
-                   const unsigned int skip_evts, const std::string &datafile)
+                   const unsigned int skip_evts, const std::string &datafile,
+                   unsigned threads, const std::string &sharedmemory)
       : CommandReceiver("Monitor", name, runcontrol, false), m_run(0),
         m_callstart(false), m_reader(0), limit(lim), skip(100 - skip_),
-        skip_events_with_counter(skip_evts) {
+        skip_events_with_counter(skip_evts), m_shmname(sharedmemory),
+        m_shmretry(0) {
+    if (threads != 1) {
+      m_converter.reset(new ParallelConverter(
+          [this](const DetectorEvent &, const StandardEvent &sev) {
+            OnEvent(sev);
+          },
+          threads));
+    }
     if (datafile != "") {
       // set offline
       m_reader = std::shared_ptr<FileReader>(new FileReader(datafile));
@@ -24,24 +33,77 @@ namespace eudaq {
     StartThread();
   }
 
+  shared_ptr<DetectorEvent> Monitor::NextSharedEvent() {
+    if (m_shm && m_shm->IsClosed()) {
+      // the DataCollector was reconfigured or has gone, look for a new ring
+      m_shm.reset();
+    }
+    if (!m_shm) {
+      Time now = Time::Current();
+      if (now < m_shmretry)
+        return shared_ptr<DetectorEvent>();
+      m_shmretry = now + Time(1);
+      try {
+        m_shm.reset(new SharedMemoryReader(m_shmname));
+      } catch (const Exception &) {
+        return shared_ptr<DetectorEvent>();
+      }
+      EUDAQ_INFO("Reading events from shared memory " + m_shmname);
+      // attached during a run, its BORE was published before
+      shared_ptr<DetectorEvent> bore = m_shm->LastBore();
+      if (bore) {
+        if (m_converter)
+          m_converter->Flush();
+        PluginManager::Initialize(*bore);
+        m_lastbore = bore;
+      }
+    }
+    for (;;) {
+      shared_ptr<DetectorEvent> ev = m_shm->NextEvent();
+      // the end of the previous run can still be in the ring
+      unsigned run = m_run;
+      if (!ev || run == 0 || ev->GetRunNumber() == run)
+        return ev;
+    }
+  }
+
   bool Monitor::ProcessEvent() {
 
-    if (!m_reader.get())
-      return false;
-    if (!m_reader->NextEvent())
-      return false;
+    shared_ptr<DetectorEvent> shmev;
+    if (m_shmname != "") {
+      shmev = NextSharedEvent();
+      if (!shmev) {
+        if (m_converter)
+          m_converter->Flush();
+        return false;
+      }
+      if (shmev->IsBORE()) {
+        if (m_converter)
+          m_converter->Flush();
+        PluginManager::Initialize(*shmev);
+      }
+    } else {
+      if (!m_reader.get())
+        return false;
+      if (!m_reader->NextEvent()) {
+        if (m_converter)
+          m_converter->Flush();
+        return false;
+      }
+    }
+    const DetectorEvent &dev =
+        shmev ? *shmev : m_reader->GetDetectorEvent();
 
-    unsigned evt_number = m_reader->GetDetectorEvent().GetEventNumber();
+    unsigned evt_number = dev.GetEventNumber();
     if (limit > 0 && evt_number > limit)
       return true;
 
     if (evt_number % 1000 == 0) {
-      std::cout << "ProcessEvent "
-                << m_reader->GetDetectorEvent().GetEventNumber()
-                << (m_reader->GetDetectorEvent().IsBORE()
-                        ? "B"
-                        : m_reader->GetDetectorEvent().IsEORE() ? "E" : "")
-                << std::endl;
+      std::cout << "ProcessEvent " << dev.GetEventNumber()
+                << (dev.IsBORE() ? "B" : dev.IsEORE() ? "E" : "");
+      if (m_shm)
+        std::cout << " (" << m_shm->NumDropped() << " dropped)";
+      std::cout << std::endl;
     }
 
     if (skip > 0 && (evt_number % 100 >= skip)) { //-s functionality
@@ -49,18 +111,23 @@ namespace eudaq {
     } else if (skip_events_with_counter >
                0) { //-sc functionality, you cant have both
       if (++counter_for_skipping < skip_events_with_counter && evt_number > 0 &&
-          !m_reader->GetDetectorEvent().IsBORE() &&
-          !m_reader->GetDetectorEvent().IsEORE())
+          !dev.IsBORE() && !dev.IsEORE())
         return true;
       else
         counter_for_skipping = 0;
     }
 
     try {
-      const DetectorEvent &dev = m_reader->GetDetectorEvent();
       if (dev.IsBORE())
-        m_lastbore = std::shared_ptr<DetectorEvent>(new DetectorEvent(dev));
-      OnEvent(PluginManager::ConvertToStandard(dev));
+        m_lastbore = shmev ? shmev : std::shared_ptr<DetectorEvent>(
+                                         new DetectorEvent(dev));
+      if (m_converter) {
+        // events from the ring are already copies of their own
+        m_converter->Convert(shmev ? shmev : std::shared_ptr<DetectorEvent>(
+                                                 new DetectorEvent(dev)));
+      } else {
+        OnEvent(PluginManager::ConvertToStandard(dev));
+      }
       //        ++counter_events_for_online_monitor;
     } catch (const InterruptedException &) {
       return false;
@@ -89,11 +156,18 @@ namespace eudaq {
 
   void Monitor::OnStartRun(unsigned param) {
     std::cout << "run " << param << std::endl;
+    if (m_converter)
+      m_converter->Flush();
     m_run = param;
-    m_reader = std::shared_ptr<FileReader>(new FileReader(to_string(m_run)));
-    PluginManager::Initialize(m_reader->GetDetectorEvent()); // process BORE
-    EUDAQ_INFO("Starting run " + to_string(m_run));
+    if (m_shmname == "") {
+      m_reader = std::shared_ptr<FileReader>(new FileReader(to_string(param)));
+      PluginManager::Initialize(m_reader->GetDetectorEvent()); // process BORE
+    }
+    EUDAQ_INFO("Starting run " + to_string(param));
   }
 
-  void Monitor::OnStopRun() { m_reader->Interrupt(); }
+  void Monitor::OnStopRun() {
+    if (m_reader)
+      m_reader->Interrupt();
+  }
 }
@@ -3,32 +3,98 @@
 void eudaq::multiFileReader::addFileReader(
     const std::string &filename, const std::string &filepattern /*= ""*/) {
   m_fileReaders.emplace_back(
-      std::make_shared<FileReader>(filename, filepattern));
+      std::make_shared<FileReader>(filename, filepattern, true));
   m_ev = m_fileReaders.back()->GetDetectorEvent_ptr();
+  m_current.push_back(m_ev);
   m_sync.addBOREEvent(m_fileReaders.size() - 1, *m_ev);
 }
 
 void eudaq::multiFileReader::Interrupt() {
+  m_stop = true;
   for (auto &p : m_fileReaders) {
     p->Interrupt();
   }
 }
 
+void eudaq::multiFileReader::ReadAhead::Run(FileReader *reader,
+                                            const std::atomic<bool> *stop) {
+  try {
+    while (!*stop && reader->NextEvent()) {
+      std::shared_ptr<DetectorEvent> ev = reader->GetDetectorEvent_ptr();
+      if (!queue.Push(std::move(ev), *stop))
+        break;
+    }
+  } catch (...) {
+    error = std::current_exception();
+  }
+  eof = true;
+}
+
+void eudaq::multiFileReader::StartReadAhead() {
+  for (size_t i = 0; i < m_fileReaders.size(); ++i) {
+    m_readahead.emplace_back(new ReadAhead(m_readaheadsize));
+    m_readahead.back()->thread = std::thread(
+        &ReadAhead::Run, m_readahead.back().get(), m_fileReaders[i].get(),
+        &m_stop);
+  }
+}
+
+void eudaq::multiFileReader::StopReadAhead() {
+  m_stop = true;
+  if (!m_readahead.empty()) {
+    // wake up readers waiting for more data
+    for (auto &p : m_fileReaders)
+      p->Interrupt();
+  }
+  for (auto &r : m_readahead) {
+    if (r->thread.joinable())
+      r->thread.join();
+  }
+  m_readahead.clear();
+}
+
+// Makes the next event of the file current, returns false at the end
+bool eudaq::multiFileReader::ReadNext(size_t fileID) {
+  if (m_readahead.empty()) {
+    if (!m_fileReaders[fileID]->NextEvent())
+      return false;
+    m_current[fileID] = m_fileReaders[fileID]->GetDetectorEvent_ptr();
+    return true;
+  }
+  ReadAhead &r = *m_readahead[fileID];
+  std::shared_ptr<DetectorEvent> ev;
+  for (unsigned tries = 0; !r.queue.TryPop(ev); ++tries) {
+    // eof is only set after the last push, so check the queue once more
+    if (r.eof && !r.queue.TryPop(ev)) {
+      if (r.error)
+        std::rethrow_exception(r.error);
+      return false;
+    }
+    if (r.eof || m_stop)
+      break;
+    BoundedQueue<std::shared_ptr<DetectorEvent>>::Backoff(tries);
+  }
+  if (!ev)
+    return false;
+  m_current[fileID] = ev;
+  return true;
+}
+
 bool eudaq::multiFileReader::NextEvent(size_t skip /*= 0*/) {
   if (!m_preaparedForEvents) {
     m_sync.PrepareForEvents();
     m_preaparedForEvents = true;
+    if (m_readaheadsize > 0 && m_fileReaders.size() > 0)
+      StartReadAhead();
   }
   for (size_t skipIndex = 0; skipIndex <= skip; skipIndex++) {
 
     do {
       for (size_t fileID = 0; fileID < m_fileReaders.size(); ++fileID) {
-        if (!m_fileReaders[fileID]->NextEvent() &&
-            m_sync.SubEventQueueIsEmpty(fileID)) {
+        if (!ReadNext(fileID) && m_sync.SubEventQueueIsEmpty(fileID)) {
           return false;
         }
-        m_sync.AddDetectorElementToProducerQueue(
-            fileID, m_fileReaders[fileID]->GetDetectorEvent_ptr());
+        m_sync.AddDetectorElementToProducerQueue(fileID, m_current[fileID]);
       }
       m_sync.storeCurrentOrder();
     } while (!m_sync.SyncNEvents(m_eventsToSync));
@@ -46,8 +112,11 @@ const eudaq::DetectorEvent &eudaq::multiFileReader::GetDetectorEvent() const {
 
 const eudaq::Event &eudaq::multiFileReader::GetEvent() const { return *m_ev; }
 
-eudaq::multiFileReader::multiFileReader(bool sync)
-    : m_sync(sync), m_eventsToSync(0), m_preaparedForEvents(0) {}
+eudaq::multiFileReader::multiFileReader(bool sync, size_t readahead)
+    : m_readaheadsize(readahead), m_stop(false), m_sync(sync),
+      m_eventsToSync(0), m_preaparedForEvents(0) {}
+
+eudaq::multiFileReader::~multiFileReader() { StopReadAhead(); }
 
 unsigned eudaq::multiFileReader::RunNumber() const {
   return m_ev->GetRunNumber();
@@ -0,0 +1,153 @@
+#include "eudaq/ParallelConverter.hh"
+#include "eudaq/PluginManager.hh"
+#include "eudaq/Instrumentation.hh"
+#include "eudaq/Exception.hh"
+
+namespace eudaq {
+
+  ParallelConverter::ParallelConverter(const Callback &callback,
+                                       unsigned threads, size_t inflight)
+      : m_callback(callback), m_maxinflight(inflight), m_stop(false) {
+    if (threads == 0)
+      threads = std::thread::hardware_concurrency();
+    if (m_maxinflight == 0)
+      m_maxinflight = 4 * threads;
+    if (threads > 1) {
+      for (unsigned i = 0; i < threads; ++i) {
+        m_threads.push_back(
+            std::thread(&ParallelConverter::WorkerThread, this));
+      }
+    }
+  }
+
+  ParallelConverter::~ParallelConverter() {
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_stop = true;
+      // running jobs only wait for the turns of earlier jobs,
+      // so the ones not yet started can simply be dropped
+      m_queue.clear();
+    }
+    m_cvwork.notify_all();
+    for (size_t i = 0; i < m_threads.size(); ++i) {
+      m_threads[i].join();
+    }
+  }
+
+  void ParallelConverter::Convert(std::shared_ptr<const DetectorEvent> dev) {
+    if (!dev)
+      EUDAQ_THROW("ParallelConverter: Null event!");
+    if (dev->IsBORE()) {
+      Flush();
+      m_callback(*dev, StandardEvent(*dev));
+      return;
+    }
+    if (m_threads.empty() || dev->IsEORE()) {
+      Flush();
+      m_callback(*dev, PluginManager::ConvertToStandard(*dev));
+      return;
+    }
+    std::shared_ptr<Job> job(new Job);
+    job->dev = dev;
+    std::vector<const Event *> subevents =
+        PluginManager::StandardSubEvents(*dev);
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      for (size_t i = 0; i < subevents.size(); ++i) {
+        Step step = {subevents[i], 0, 0};
+        const DataConverterPlugin *plugin = 0;
+        try {
+          plugin = &PluginManager::GetInstance().GetPlugin(*subevents[i]);
+        } catch (const Exception &) {
+          // reported by the conversion itself
+        }
+        if (plugin && !plugin->IsThreadSafe()) {
+          step.turn = &m_turns[plugin];
+          step.ticket = step.turn->issued++;
+        }
+        job->steps.push_back(step);
+      }
+      m_queue.push_back(job);
+      m_inflight.push_back(job);
+    }
+    m_cvwork.notify_one();
+    Deliver(m_maxinflight);
+  }
+
+  void ParallelConverter::Flush() { Deliver(0); }
+
+  void ParallelConverter::Deliver(size_t keep) {
+    for (;;) {
+      std::shared_ptr<Job> job;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_inflight.empty())
+          return;
+        if (!m_inflight.front()->done) {
+          if (m_inflight.size() <= keep)
+            return;
+          m_cvdone.wait(lock, [this] { return m_inflight.front()->done; });
+        }
+        job = m_inflight.front();
+        m_inflight.pop_front();
+      }
+      if (job->error)
+        std::rethrow_exception(job->error);
+      m_callback(*job->dev, *job->sev);
+    }
+  }
+
+  void ParallelConverter::WorkerThread() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+      m_cvwork.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+      if (m_queue.empty())
+        return;
+      std::shared_ptr<Job> job = m_queue.front();
+      m_queue.pop_front();
+      lock.unlock();
+      Run(*job);
+      lock.lock();
+      job->done = true;
+      m_cvdone.notify_all();
+    }
+  }
+
+  void ParallelConverter::Run(Job &job) {
+    try {
+      job.sev.reset(new StandardEvent(*job.dev));
+    } catch (...) {
+      job.error = std::current_exception();
+    }
+    // the time converting, without waiting for the turns
+    uint64_t converting = 0;
+    // every turn must be served, even after an error, or later
+    // events waiting for the same plugin would block forever
+    for (size_t i = 0; i < job.steps.size(); ++i) {
+      const Step &step = job.steps[i];
+      if (step.turn) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cvdone.wait(lock,
+                      [&step] { return step.turn->served == step.ticket; });
+      }
+      if (!job.error) {
+        uint64_t start =
+            Instrumentation::Enabled() ? Instrumentation::Now() : 0;
+        try {
+          PluginManager::ConvertStandardSubEvent(*job.sev, *step.ev);
+        } catch (...) {
+          job.error = std::current_exception();
+        }
+        if (start)
+          converting += Instrumentation::Now() - start;
+      }
+      if (step.turn) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        ++step.turn->served;
+        m_cvdone.notify_all();
+      }
+    }
+    if (Instrumentation::Enabled())
+      Instrumentation::Record(STAGE_CONVERT, converting);
+  }
+}
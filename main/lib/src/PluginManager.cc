@@ -1,6 +1,7 @@
 #include "eudaq/PluginManager.hh"
 #include "eudaq/Exception.hh"
 #include "eudaq/Configuration.hh"
+#include "eudaq/Instrumentation.hh"
 
 #if USE_LCIO
 #include "lcio.h"
@@ -108,24 +109,34 @@ namespace eudaq {
   StandardEvent PluginManager::ConvertToStandard(const DetectorEvent &dev) {
     // StandardEvent event(dev.GetRunNumber(), dev.GetEventNumber(),
     // dev.GetTimestamp());
+    StageTimer timer(STAGE_CONVERT);
     StandardEvent event(dev);
+    std::vector<const Event *> subevents = StandardSubEvents(dev);
+    for (size_t i = 0; i < subevents.size(); ++i) {
+      ConvertStandardSubEvent(event, *subevents[i]);
+    }
+    return event;
+  }
+
+  std::vector<const Event *>
+  PluginManager::StandardSubEvents(const DetectorEvent &dev) {
+    // the EUDRB planes come first, followed by the others in file order
+    std::vector<const Event *> result;
     for (size_t i = 0; i < dev.NumEvents(); ++i) {
       const Event *ev = dev.GetEvent(i);
       if (!ev)
         EUDAQ_THROW("Null event!");
       if (ev->GetSubType() == "EUDRB") {
-        ConvertStandardSubEvent(event, *ev);
+        result.push_back(ev);
       }
     }
     for (size_t i = 0; i < dev.NumEvents(); ++i) {
       const Event *ev = dev.GetEvent(i);
-      if (!ev)
-        EUDAQ_THROW("Null event!");
       if (ev->GetSubType() != "EUDRB") {
-        ConvertStandardSubEvent(event, *ev);
+        result.push_back(ev);
       }
     }
-    return event;
+    return result;
   }
 
 #if USE_LCIO
@@ -1,42 +1,109 @@
 #include "eudaq/RawDataEvent.hh"
 #include "eudaq/PluginManager.hh"
 
+#include <cstdint>
+#include <mutex>
 #include <ostream>
+#include <stdexcept>
 
 namespace eudaq {
 
+  namespace {
+    /// Guards copying referenced blocks, striped by block address
+    std::mutex &CopyMutex(const void *block) {
+      static std::mutex mutexes[64];
+      return mutexes[(reinterpret_cast<uintptr_t>(block) / sizeof(void *)) %
+                     64];
+    }
+  }
+
   EUDAQ_DEFINE_EVENT(RawDataEvent, str2id("_RAW"));
 
-  RawDataEvent::block_t::block_t(Deserializer &des) {
+  RawDataEvent::block_t::block_t(Deserializer &des)
+      : m_ref(0), m_reflen(0), m_copied(false) {
     des.read(id);
-    des.read(data);
+    unsigned len = 0;
+    des.read(len);
+    if (len)
+      m_ref = des.ReadReference(len, m_owner);
+    if (m_ref) {
+      m_reflen = len;
+    } else {
+      data.resize(len);
+      if (len)
+        des.read(&data[0], len);
+    }
   }
 
   void RawDataEvent::block_t::Serialize(Serializer &ser) const {
     ser.write(id);
-    ser.write(data);
+    // the block outlives the serialization, so it may be referenced
+    if (m_ref) {
+      ser.write((unsigned)m_reflen);
+      ser.append_reference(m_ref, m_reflen);
+    } else {
+      ser.write((unsigned)data.size());
+      if (!data.empty())
+        ser.append_reference(&data[0], data.size());
+    }
   }
 
   void RawDataEvent::block_t::Append(const RawDataEvent::data_t &d) {
+    if (m_ref) {
+      Data();
+      m_ref = 0;
+      m_reflen = 0;
+      m_owner.reset();
+      m_copied = false;
+    }
     data.insert(data.end(), d.begin(), d.end());
   }
 
+  const RawDataEvent::data_t &RawDataEvent::block_t::Data() const {
+    // the reference is kept, so that Bytes() and Size() do not change while
+    // other threads read the block
+    if (m_ref) {
+      std::lock_guard<std::mutex> lock(CopyMutex(this));
+      if (!m_copied) {
+        data.assign(m_ref, m_ref + m_reflen);
+        m_copied = true;
+      }
+    }
+    return data;
+  }
+
   RawDataEvent::RawDataEvent(std::string type, unsigned run, unsigned event)
       : Event(run, event), m_type(type) {}
 
   RawDataEvent::RawDataEvent(Deserializer &ds) : Event(ds) {
     ds.read(m_type);
-    ds.read(m_blocks);
+    unsigned n = 0;
+    ds.read(n);
+    m_blocks.reserve(n);
+    for (unsigned i = 0; i < n; ++i) {
+      m_blocks.push_back(block_t(ds));
+    }
   }
 
   unsigned RawDataEvent::GetID(size_t i) const { return m_blocks.at(i).id; }
 
   const RawDataEvent::data_t &RawDataEvent::GetBlock(size_t i) const {
-    return m_blocks.at(i).data;
+    return m_blocks.at(i).Data();
+  }
+
+  const RawDataEvent::byte_t *RawDataEvent::GetBlockData(size_t i) const {
+    return m_blocks.at(i).Bytes();
+  }
+
+  size_t RawDataEvent::GetBlockSize(size_t i) const {
+    return m_blocks.at(i).Size();
   }
 
   RawDataEvent::byte_t RawDataEvent::GetByte(size_t block, size_t index) const {
-    return GetBlock(block).at(index);
+    const block_t &b = m_blocks.at(block);
+    if (index >= b.Size())
+      throw std::out_of_range("RawDataEvent::GetByte");
+    return b.Bytes()[index];
   }
 
   void RawDataEvent::Print(std::ostream &os) const {
@@ -56,6 +123,9 @@ namespace eudaq {
   void RawDataEvent::Serialize(Serializer &ser) const {
     Event::Serialize(ser);
     ser.write(m_type);
-    ser.write(m_blocks);
+    ser.write((unsigned)m_blocks.size());
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+      ser.write(m_blocks[i]);
+    }
   }
 }
@@ -0,0 +1,287 @@
+#include "eudaq/SharedMemoryRing.hh"
+#include "eudaq/BufferSerializer.hh"
+#include "eudaq/Exception.hh"
+#include "eudaq/Logger.hh"
+#include "eudaq/Utils.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#if !EUDAQ_PLATFORM_IS(WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace eudaq {
+
+  namespace {
+
+    static const uint32_t RING_MAGIC = 0x52455545; // "EUER"
+    static const uint32_t RING_VERSION = 1;
+    static const size_t RING_ALIGN = 64;
+
+    /// At the start of the shared memory
+    struct RingHeader {
+      std::atomic<uint32_t> magic; ///< Set last, once the ring is ready
+      uint32_t version;
+      uint64_t slots, slotsize;
+      std::atomic<uint64_t> head;   ///< Number of events published
+      std::atomic<uint32_t> closed; ///< Set when the writer goes away
+    };
+
+    /// Followed by the serialized event. Slot 0 keeps the last BORE, slots
+    /// 1 to n are the ring.
+    struct SlotHeader {
+      std::atomic<uint64_t> seq; ///< Index + 1 of the event, 0 while written
+      uint64_t size;
+    };
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+                  "the shared memory ring needs lock-free atomics");
+
+    size_t Aligned(size_t n) {
+      return (n + RING_ALIGN - 1) / RING_ALIGN * RING_ALIGN;
+    }
+
+    size_t SlotStride(size_t slotsize) {
+      return Aligned(sizeof(SlotHeader) + slotsize);
+    }
+
+    size_t MapSize(size_t slots, size_t slotsize) {
+      return Aligned(sizeof(RingHeader)) + (slots + 1) * SlotStride(slotsize);
+    }
+
+    size_t SlotOffset(size_t slotsize, size_t slot) {
+      return Aligned(sizeof(RingHeader)) + slot * SlotStride(slotsize);
+    }
+
+    std::string ShmName(const std::string &name) {
+      return name.size() > 0 && name[0] == '/' ? name : "/" + name;
+    }
+
+    EUDAQ_EXCEPTION(SlotFullException);
+
+    /// Only counts the bytes, to check that an event fits into a slot
+    class SizeSerializer : public Serializer {
+    public:
+      SizeSerializer() : m_size(0) {}
+      size_t size() const { return m_size; }
+
+    private:
+      virtual void Serialize(const unsigned char *, size_t len) {
+        m_size += len;
+      }
+      size_t m_size;
+    };
+
+    /// Serializes directly into the memory of a slot
+    class SlotSerializer : public Serializer {
+    public:
+      SlotSerializer(unsigned char *data, size_t size)
+          : m_data(data), m_size(size), m_used(0) {}
+      size_t used() const { return m_used; }
+
+    private:
+      virtual void Serialize(const unsigned char *data, size_t len) {
+        if (len > m_size - m_used)
+          throw SlotFullException("Event does not fit into the slot");
+        std::memcpy(m_data + m_used, data, len);
+        m_used += len;
+      }
+      unsigned char *m_data;
+      size_t m_size, m_used;
+    };
+  }
+
+  SharedMemoryRing::SharedMemoryRing(const std::string &name, size_t slots,
+                                     size_t slotsize)
+      : m_name(ShmName(name)), m_slots(std::max<size_t>(slots, 1)),
+        m_slotsize(slotsize), m_mapsize(MapSize(m_slots, slotsize)),
+        m_map(0), m_published(0), m_toolarge(0) {
+#if EUDAQ_PLATFORM_IS(WIN32)
+    EUDAQ_THROW("Shared memory is not supported on this platform");
+#else
+    // an existing ring may still be in use by another writer, so it is not
+    // replaced; one left behind by a writer that crashed has to be removed
+    int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST)
+      EUDAQ_THROW("Shared memory " + m_name + " already exists, remove " +
+                  "/dev/shm" + m_name + " if no DataCollector is using it");
+    if (fd < 0)
+      EUDAQ_THROW("Unable to create shared memory " + m_name + ": " +
+                  std::strerror(errno));
+    if (ftruncate(fd, m_mapsize) != 0) {
+      std::string err = std::strerror(errno);
+      close(fd);
+      shm_unlink(m_name.c_str());
+      EUDAQ_THROW("Unable to size shared memory " + m_name + ": " + err);
+    }
+    void *map =
+        mmap(0, m_mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+      shm_unlink(m_name.c_str());
+      EUDAQ_THROW("Unable to map shared memory " + m_name);
+    }
+    m_map = static_cast<unsigned char *>(map);
+    RingHeader *header = new (m_map) RingHeader;
+    header->version = RING_VERSION;
+    header->slots = m_slots;
+    header->slotsize = m_slotsize;
+    header->head.store(0, std::memory_order_relaxed);
+    header->closed.store(0, std::memory_order_relaxed);
+    for (size_t slot = 0; slot <= m_slots; ++slot) {
+      SlotHeader *s = new (m_map + SlotOffset(m_slotsize, slot)) SlotHeader;
+      s->seq.store(0, std::memory_order_relaxed);
+      s->size = 0;
+    }
+    header->magic.store(RING_MAGIC, std::memory_order_release);
+#endif
+  }
+
+  SharedMemoryRing::~SharedMemoryRing() {
+#if !EUDAQ_PLATFORM_IS(WIN32)
+    if (m_map) {
+      reinterpret_cast<RingHeader *>(m_map)->closed.store(
+          1, std::memory_order_release);
+      munmap(m_map, m_mapsize);
+      shm_unlink(m_name.c_str());
+    }
+#endif
+  }
+
+  bool SharedMemoryRing::Write(size_t slot, uint64_t seq,
+                               const DetectorEvent &ev) {
+    SizeSerializer size;
+    size.write(ev);
+    if (size.size() > m_slotsize)
+      return false;
+    // a seqlock: readers check that seq did not change while they read
+    SlotHeader *s =
+        reinterpret_cast<SlotHeader *>(m_map + SlotOffset(m_slotsize, slot));
+    s->seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    SlotSerializer ser(reinterpret_cast<unsigned char *>(s + 1), m_slotsize);
+    ser.write(ev);
+    s->size = ser.used();
+    s->seq.store(seq, std::memory_order_release);
+    return true;
+  }
+
+  bool SharedMemoryRing::Publish(const DetectorEvent &ev) {
+    uint64_t index = m_published;
+    if (!Write(1 + index % m_slots, index + 1, ev)) {
+      if (m_toolarge++ == 0)
+        EUDAQ_WARN("Events larger than the shared memory slots (" +
+                   to_string(m_slotsize) + " bytes) are not published");
+      return false;
+    }
+    if (ev.IsBORE())
+      Write(0, index + 1, ev);
+    reinterpret_cast<RingHeader *>(m_map)->head.store(
+        index + 1, std::memory_order_release);
+    ++m_published;
+    return true;
+  }
+
+  SharedMemoryReader::SharedMemoryReader(const std::string &name)
+      : m_name(ShmName(name)), m_slots(0), m_slotsize(0), m_mapsize(0),
+        m_map(0), m_next(0), m_dropped(0) {
+#if EUDAQ_PLATFORM_IS(WIN32)
+    EUDAQ_THROW("Shared memory is not supported on this platform");
+#else
+    int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+      EUDAQ_THROW("No shared memory " + m_name + ": " + std::strerror(errno));
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RingHeader)) {
+      close(fd);
+      EUDAQ_THROW("Shared memory " + m_name + " is not an event ring");
+    }
+    m_mapsize = st.st_size;
+    void *map = mmap(0, m_mapsize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+      EUDAQ_THROW("Unable to map shared memory " + m_name);
+    m_map = static_cast<const unsigned char *>(map);
+    const RingHeader *header = reinterpret_cast<const RingHeader *>(m_map);
+    if (header->magic.load(std::memory_order_acquire) != RING_MAGIC ||
+        header->version != RING_VERSION || header->slots == 0 ||
+        MapSize(header->slots, header->slotsize) > m_mapsize) {
+      munmap(const_cast<unsigned char *>(m_map), m_mapsize);
+      EUDAQ_THROW("Shared memory " + m_name + " is not an event ring");
+    }
+    m_slots = header->slots;
+    m_slotsize = header->slotsize;
+    m_next = header->head.load(std::memory_order_acquire);
+#endif
+  }
+
+  SharedMemoryReader::~SharedMemoryReader() {
+#if !EUDAQ_PLATFORM_IS(WIN32)
+    if (m_map)
+      munmap(const_cast<unsigned char *>(m_map), m_mapsize);
+#endif
+  }
+
+  std::shared_ptr<DetectorEvent> SharedMemoryReader::Read(size_t slot,
+                                                          uint64_t seq) {
+    const SlotHeader *s = reinterpret_cast<const SlotHeader *>(
+        m_map + SlotOffset(m_slotsize, slot));
+    if (s->seq.load(std::memory_order_acquire) != seq)
+      return std::shared_ptr<DetectorEvent>();
+    std::shared_ptr<DetectorEvent> ev;
+    try {
+      // no owner, so that the event does not keep references into the slot
+      BufferDeserializer des(reinterpret_cast<const unsigned char *>(s + 1),
+                             std::min<uint64_t>(s->size, m_slotsize));
+      std::unique_ptr<Event> e(EventFactory::Create(des));
+      if (dynamic_cast<DetectorEvent *>(e.get()))
+        ev.reset(static_cast<DetectorEvent *>(e.release()));
+    } catch (const std::exception &) {
+      // the slot was overwritten while it was read
+      ev.reset();
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->seq.load(std::memory_order_relaxed) != seq)
+      return std::shared_ptr<DetectorEvent>();
+    return ev;
+  }
+
+  std::shared_ptr<DetectorEvent> SharedMemoryReader::NextEvent() {
+    const RingHeader *header = reinterpret_cast<const RingHeader *>(m_map);
+    for (;;) {
+      uint64_t head = header->head.load(std::memory_order_acquire);
+      if (m_next >= head)
+        return std::shared_ptr<DetectorEvent>();
+      if (head - m_next >= m_slots) {
+        // the oldest event is the next one to be overwritten, skip it as well
+        m_dropped += head - m_slots + 1 - m_next;
+        m_next = head - m_slots + 1;
+      }
+      uint64_t index = m_next++;
+      std::shared_ptr<DetectorEvent> ev = Read(1 + index % m_slots, index + 1);
+      if (ev)
+        return ev;
+      ++m_dropped;
+    }
+  }
+
+  std::shared_ptr<DetectorEvent> SharedMemoryReader::LastBore() {
+    const SlotHeader *s =
+        reinterpret_cast<const SlotHeader *>(m_map + SlotOffset(m_slotsize, 0));
+    uint64_t seq = s->seq.load(std::memory_order_acquire);
+    if (seq == 0)
+      return std::shared_ptr<DetectorEvent>();
+    return Read(0, seq);
+  }
+
+  bool SharedMemoryReader::IsClosed() const {
+    const RingHeader *header = reinterpret_cast<const RingHeader *>(m_map);
+    return header->closed.load(std::memory_order_acquire) != 0;
+  }
+}
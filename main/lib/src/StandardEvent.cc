@@ -92,7 +92,7 @@ namespace eudaq {
     }
   }
 
-  void StandardPlane::PushPixelHelper(unsigned x, unsigned y, double p,
+  void StandardPlane::PushPixelHelper(coord_t x, coord_t y, double p,
                                       bool pivot, unsigned frame) {
     if (frame > m_x.size())
       EUDAQ_THROW("Bad frame number " + to_string(frame) + " in PushPixel");
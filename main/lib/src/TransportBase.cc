@@ -24,26 +24,77 @@ namespace eudaq {
     return true;
   }
 
-  TransportBase::TransportBase() : m_callback(0) {}
+  TransportEventQueue::TransportEventQueue(size_t capacity)
+      : m_ring(capacity), m_overflowsize(0) {}
+
+  void TransportEventQueue::Push(TransportEvent::EventType et,
+                                 ConnectionInfo &id, std::string &&packet) {
+    Item item;
+    item.etype = et;
+    item.id = &id;
+    item.packet = std::move(packet);
+    // once events overflow, the following ones must queue up behind them
+    if (m_overflowsize.load(std::memory_order_acquire) == 0 &&
+        m_ring.TryPush(std::move(item)))
+      return;
+    std::lock_guard<std::mutex> lock(m_overflowmutex);
+    m_overflow.push_back(std::move(item));
+    m_overflowsize.store(m_overflow.size(), std::memory_order_release);
+  }
+
+  bool TransportEventQueue::Pop(Item &item) {
+    // the ring only ever holds events older than those in the overflow list
+    if (m_ring.TryPop(item))
+      return true;
+    if (m_overflowsize.load(std::memory_order_acquire) == 0)
+      return false;
+    std::lock_guard<std::mutex> lock(m_overflowmutex);
+    if (m_overflow.empty())
+      return false;
+    item = std::move(m_overflow.front());
+    m_overflow.pop_front();
+    m_overflowsize.store(m_overflow.size(), std::memory_order_release);
+    return true;
+  }
+
+  bool TransportEventQueue::Empty() const {
+    return m_ring.Empty() &&
+           m_overflowsize.load(std::memory_order_acquire) == 0;
+  }
+
+  TransportBase::TransportBase() : m_callback(0), m_hasheld(false) {}
 
   void TransportBase::SetCallback(const TransportCallback &callback) {
     m_callback = callback;
   }
 
+  void TransportBase::SendPacket(const BufferSegment *segments,
+                                 size_t nsegments, const ConnectionInfo &inf,
+                                 bool duringconnect) {
+    std::vector<unsigned char> data;
+    for (size_t i = 0; i < nsegments; ++i) {
+      data.insert(data.end(), segments[i].data,
+                  segments[i].data + segments[i].size);
+    }
+    SendPacket(data.data(), data.size(), inf, duringconnect);
+  }
+
   void TransportBase::Process(int timeout) {
     if (timeout == -1)
       timeout = DEFAULT_TIMEOUT;
     MutexLock m(m_mutex);
     ProcessEvents(timeout);
+    TransportEventQueue::Item item;
+    bool held = m_hasheld;
+    if (held) {
+      item = std::move(m_held);
+      m_hasheld = false;
+    }
     m.Release();
-    for (;;) {
-      MutexLock m(m_mutex);
-      if (m_events.empty())
-        break;
-      // std::cout << "Got packet" << std::endl;
-      TransportEvent evt(m_events.front());
-      m_events.pop();
-      m.Release();
+    // the queue is lock-free, so events are handled without the mutex
+    while (held || m_events.Pop(item)) {
+      held = false;
+      TransportEvent evt(item.etype, *item.id, std::move(item.packet));
       m_callback(evt);
     }
   }
@@ -52,30 +103,22 @@ namespace eudaq {
                                     const ConnectionInfo &conn) {
     if (timeout == -1)
       timeout = DEFAULT_TIMEOUT;
-    // std::cout << "ReceivePacket()" << std::flush;
-    while (!m_events.empty() &&
-           m_events.front().etype != TransportEvent::RECEIVE) {
-      m_events.pop();
+    // skip anything that is not a packet
+    while (!m_hasheld && m_events.Pop(m_held)) {
+      m_hasheld = m_held.etype == TransportEvent::RECEIVE;
     }
-    // std::cout << " current level=" << m_events.size() << std::endl;
-    if (m_events.empty()) {
-      // std::cout << "Getting more" << std::endl;
+    if (!m_hasheld) {
       ProcessEvents(timeout);
-      // std::cout << "Temp level=" << m_events.size() << std::endl;
-      while (!m_events.empty() &&
-             m_events.front().etype != TransportEvent::RECEIVE) {
-        m_events.pop();
+      while (!m_hasheld && m_events.Pop(m_held)) {
+        m_hasheld = m_held.etype == TransportEvent::RECEIVE;
       }
-      // std::cout << "New level=" << m_events.size() << std::endl;
     }
     bool ret = false;
-    if (!m_events.empty() && conn.Matches(m_events.front().id)) {
+    if (m_hasheld && conn.Matches(*m_held.id)) {
       ret = true;
-      *packet = m_events.front().packet;
-      m_events.pop();
+      *packet = std::move(m_held.packet);
+      m_hasheld = false;
     }
-    // std::cout << "ReceivePacket() return " << (ret ? "true" : "false") <<
-    // std::endl;
     return ret;
   }
 
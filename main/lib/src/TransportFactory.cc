@@ -49,6 +49,10 @@ namespace eudaq {
             MakeTransportInfo<NULLServer, NULLClient>(NULLServer::name));
         TransportFactory::Register(
             MakeTransportInfo<TCPServer, TCPClient>(TCPServer::name));
+#if EUDAQ_PLATFORM_IS(LINUX)
+        TransportFactory::Register(
+            MakeTransportInfo<EPOLLServer, TCPClient>(EPOLLServer::name));
+#endif
       }
       static map_t m;
       return m;
@@ -162,6 +162,7 @@ is it from the context correct?
 
 #include <sys/types.h>
 #include <errno.h>
+#include <algorithm>
 //#include <unistd.h>
 
 #include <iostream>
@@ -175,7 +176,6 @@ namespace eudaq {
   namespace {
 
     static const int MAXPENDING = 16;
-    static const int MAX_BUFFER_SIZE = 10000;
 
     static int to_int(char c) { return static_cast<unsigned char>(c); }
 
@@ -245,6 +245,120 @@ namespace eudaq {
       // if (length > 500000) std::cout << "Done send packet" << std::endl;
     }
 
+    static void do_send_segments(SOCKET sock, const BufferSegment *segments,
+                                 size_t nsegments) {
+      size_t length = 0;
+      for (size_t i = 0; i < nsegments; ++i)
+        length += segments[i].size;
+      unsigned char header[4] = {0};
+      size_t len = length;
+      for (int i = 0; i < 4; ++i) {
+        header[i] = static_cast<unsigned char>(len & 0xff);
+        len >>= 8;
+      }
+#if EUDAQ_PLATFORM_IS(WIN32) || EUDAQ_PLATFORM_IS(MINGW)
+      // no scatter-gather send here, so concatenate the segments
+      std::vector<unsigned char> buffer(header, header + 4);
+      for (size_t i = 0; i < nsegments; ++i)
+        buffer.insert(buffer.end(), segments[i].data,
+                      segments[i].data + segments[i].size);
+      do_send_data(sock, buffer.data(), buffer.size());
+#else
+      // send the length prefix and all segments with as few syscalls as
+      // possible, straight from where the data are
+      std::vector<iovec> iov;
+      iov.reserve(nsegments + 1);
+      iovec hdr = {header, 4};
+      iov.push_back(hdr);
+      for (size_t i = 0; i < nsegments; ++i) {
+        if (segments[i].size) {
+          iovec seg = {const_cast<unsigned char *>(segments[i].data),
+                       segments[i].size};
+          iov.push_back(seg);
+        }
+      }
+      size_t first = 0;
+      while (first < iov.size()) {
+        msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_iov = &iov[first];
+        msg.msg_iovlen = std::min<size_t>(iov.size() - first, EUDAQ_IOV_MAX);
+        ssize_t result = sendmsg(sock, &msg, FLAGS);
+        if (result > 0) {
+          size_t sent = result;
+          while (sent > 0) {
+            if (sent >= iov[first].iov_len) {
+              sent -= iov[first].iov_len;
+              ++first;
+            } else {
+              iov[first].iov_base =
+                  static_cast<char *>(iov[first].iov_base) + sent;
+              iov[first].iov_len -= sent;
+              sent = 0;
+            }
+          }
+        } else if (result < 0 &&
+                   (LastSockError() == EUDAQ_ERROR_Resource_temp_unavailable ||
+                    LastSockError() == EUDAQ_ERROR_Interrupted_function_call)) {
+          // continue
+        } else if (result == 0) {
+          EUDAQ_THROW_NOLOG("Connection reset by peer");
+        } else {
+          EUDAQ_THROW_NOLOG(LastSockErrorString("Error sending data"));
+        }
+      }
+#endif
+    }
+
+    // size of the kernel receive buffer, so that a single recv() can drain it
+    static size_t receive_buffer_size(SOCKET sock) {
+      int size = 0;
+      socklen_t len = sizeof size;
+      if (getsockopt(sock, SOL_SOCKET, SO_RCVBUF,
+                     reinterpret_cast<char *>(&size), &len) ||
+          size <= 0)
+        return 0;
+      return static_cast<size_t>(size);
+    }
+
+    static SOCKET open_server_socket(int port, const std::string &param) {
+      SOCKET srvsock = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+      if (srvsock == (SOCKET)-1)
+        EUDAQ_THROW_NOLOG(LastSockErrorString(
+            "Failed to create socket")); //$$ check if (SOCKET)-1 is correct
+      setup_signal();
+      setup_socket(srvsock);
+
+      sockaddr_in addr;
+      memset(&addr, 0, sizeof addr);
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_ANY);
+      addr.sin_port = htons(port);
+
+      if (bind(srvsock, (sockaddr *)&addr, sizeof addr)) {
+        closesocket(srvsock);
+        EUDAQ_THROW_NOLOG(
+            LastSockErrorString("Failed to bind socket: " + param));
+      }
+      if (listen(srvsock, MAXPENDING)) {
+        closesocket(srvsock);
+        EUDAQ_THROW_NOLOG(
+            LastSockErrorString("Failed to listen on socket: " + param));
+      }
+      return srvsock;
+    }
+
+    static std::string local_hostname() {
+#ifdef WIN32
+      const char *host = getenv("computername");
+#else
+      const char *host = getenv("HOSTNAME");
+#endif
+      if (!host)
+        host = "localhost";
+      return host;
+    }
+
     //     static void send_data(SOCKET sock, uint32_t data) {
     //       std::string str;
     //       for (int i = 0; i < 4; ++i) {
@@ -272,73 +386,108 @@ namespace eudaq {
   }
 
   void ConnectionInfoTCP::append(size_t length, const char *data) {
-    m_buf += std::string(data, length);
-    update_length();
-    // std::cout << *this << " - append: " << m_len << ", " << m_buf.size() <<
-    // std::endl;
+    while (length > 0) {
+      size_t len = 0;
+      char *buf = recvbuffer(len);
+      if (len > length)
+        len = length;
+      std::memcpy(buf, data, len);
+      received(len);
+      data += len;
+      length -= len;
+    }
+  }
+
+  void ConnectionInfoTCP::SetBufferSize(size_t size) {
+    if (size < DEFAULT_BUFFER_SIZE)
+      size = DEFAULT_BUFFER_SIZE;
+    m_bufsize = size;
+  }
+
+  char *ConnectionInfoTCP::recvbuffer(size_t &length) {
+    if (m_direct && m_filled < m_pktlen) {
+      length = m_pktlen - m_filled;
+      return &m_packet[m_filled];
+    }
+    if (m_buf.size() < m_bufsize)
+      m_buf.resize(m_bufsize);
+    if (m_begin == m_end) {
+      m_begin = m_end = 0;
+    } else if (m_buf.size() - m_end < m_buf.size() / 4) {
+      // running out of space at the end, move the remaining data to the front
+      std::memmove(&m_buf[0], &m_buf[m_begin], m_end - m_begin);
+      m_end -= m_begin;
+      m_begin = 0;
+    }
+    if (m_end == m_buf.size()) {
+      // packets are not being retrieved, so we have to grow
+      m_buf.resize(2 * m_buf.size());
+    }
+    length = m_buf.size() - m_end;
+    return &m_buf[m_end];
+  }
+
+  void ConnectionInfoTCP::received(size_t length) {
+    if (m_direct && m_filled < m_pktlen) {
+      m_filled += length;
+    } else {
+      m_end += length;
+      update_length();
+    }
   }
 
   bool ConnectionInfoTCP::havepacket() const {
-    return m_buf.length() >= m_len + 4;
+    if (m_direct)
+      return m_filled == m_pktlen;
+    return m_haveheader && m_end - m_begin >= m_len;
   }
 
   std::string ConnectionInfoTCP::getpacket() {
     if (!havepacket())
       EUDAQ_THROW_NOLOG("No packet available");
-    std::string packet(m_buf, 4, m_len);
-    m_buf.erase(0, m_len + 4);
-    update_length(true);
-    // std::cout << *this << " - getpacket: " << m_len << ", " << m_buf.size()
-    // << std::endl;
+    std::string packet;
+    if (m_direct) {
+      packet.swap(m_packet);
+      m_direct = false;
+      m_pktlen = m_filled = 0;
+    } else {
+      packet.assign(m_buf.data() + m_begin, m_len);
+      m_begin += m_len;
+      m_haveheader = false;
+      m_len = 0;
+    }
+    update_length();
     return packet;
   }
 
-  void ConnectionInfoTCP::update_length(bool force) {
-    // std::cout << "DBG: len=" << m_len << ", buf=" << m_buf.length();
-    if (force || m_len == 0) {
+  void ConnectionInfoTCP::update_length() {
+    if (!m_haveheader && m_end - m_begin >= 4) {
       m_len = 0;
-      if (m_buf.length() >= 4) {
-        for (int i = 0; i < 4; ++i) {
-          m_len |= to_int(m_buf[i]) << (8 * i);
-        }
-        //         std::cout << " (" << to_hex(m_buf[3], 2)
-        //                   << " " << to_hex(m_buf[2], 2)
-        //                   << " " << to_hex(m_buf[1], 2)
-        //                   << " " << to_hex(m_buf[0], 2)
-        //                   << ")";
+      for (int i = 0; i < 4; ++i) {
+        m_len |= to_int(m_buf[m_begin + i]) << (8 * i);
       }
+      m_begin += 4;
+      m_haveheader = true;
+    }
+    if (m_haveheader && !m_direct && m_len >= DIRECT_THRESHOLD &&
+        m_end - m_begin < m_len) {
+      // a large packet: receive the rest of it straight into its own string
+      m_direct = true;
+      m_pktlen = m_len;
+      m_packet.resize(m_pktlen);
+      m_filled = m_end - m_begin;
+      std::memcpy(&m_packet[0], m_buf.data() + m_begin, m_filled);
+      m_begin = m_end = 0;
+      m_haveheader = false;
+      m_len = 0;
     }
-    // std::cout << ", len=" << m_len << std::endl;
   }
 
   TCPServer::TCPServer(const std::string &param)
       : m_port(from_string(param, 44000)),
-        m_srvsock(socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)),
-        m_maxfd(m_srvsock) {
-    if (m_srvsock == (SOCKET)-1)
-      EUDAQ_THROW_NOLOG(LastSockErrorString(
-          "Failed to create socket")); //$$ check if (SOCKET)-1 is correct
-    setup_signal();
+        m_srvsock(open_server_socket(m_port, param)), m_maxfd(m_srvsock) {
     FD_ZERO(&m_fdset);
     FD_SET(m_srvsock, &m_fdset);
-
-    setup_socket(m_srvsock);
-
-    sockaddr_in addr;
-    memset(&addr, 0, sizeof addr);
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(m_port);
-
-    if (bind(m_srvsock, (sockaddr *)&addr, sizeof addr)) {
-      closesocket(m_srvsock);
-      EUDAQ_THROW_NOLOG(LastSockErrorString("Failed to bind socket: " + param));
-    }
-    if (listen(m_srvsock, MAXPENDING)) {
-      closesocket(m_srvsock);
-      EUDAQ_THROW_NOLOG(
-          LastSockErrorString("Failed to listen on socket: " + param));
-    }
   }
 
   TCPServer::~TCPServer() {
@@ -395,6 +544,19 @@ namespace eudaq {
     }
   }
 
+  void TCPServer::SendPacket(const BufferSegment *segments, size_t nsegments,
+                             const ConnectionInfo &id, bool duringconnect) {
+    for (size_t i = 0; i < m_conn.size(); ++i) {
+      if (id.Matches(*m_conn[i])) {
+        ConnectionInfoTCP *inf =
+            dynamic_cast<ConnectionInfoTCP *>(m_conn[i].get());
+        if (inf && inf->IsEnabled() && (inf->GetState() > 0 || duringconnect)) {
+          do_send_segments(inf->GetFd(), segments, nsegments);
+        }
+      }
+    }
+  }
+
   void TCPServer::ProcessEvents(int timeout) {
 // std::cout << "DEBUG: Process..." << std::endl;
 #if DEBUG_NOTIMEOUT == 0
@@ -434,8 +596,9 @@ namespace eudaq {
             setup_socket(peersock);
             std::string host = inet_ntoa(addr.sin_addr);
             host += ":" + to_string(ntohs(addr.sin_port));
-            std::shared_ptr<ConnectionInfo> ptr(
-                new ConnectionInfoTCP(peersock, host));
+            ConnectionInfoTCP *inf = new ConnectionInfoTCP(peersock, host);
+            inf->SetBufferSize(receive_buffer_size(peersock));
+            std::shared_ptr<ConnectionInfo> ptr(inf);
             bool inserted = false;
             for (size_t i = 0; i < m_conn.size(); ++i) {
               if (m_conn[i]->GetState() < 0) {
@@ -445,35 +608,33 @@ namespace eudaq {
             }
             if (!inserted)
               m_conn.push_back(ptr);
-            m_events.push(TransportEvent(TransportEvent::CONNECT, *ptr));
+            m_events.Push(TransportEvent::CONNECT, *ptr);
             FD_CLR(m_srvsock, &tempset);
           }
         }
         for (SOCKET j = 0; j < m_maxfd + 1; j++) {
           if (FD_ISSET(j, &tempset)) {
-            char buffer[MAX_BUFFER_SIZE + 1];
+            ConnectionInfoTCP &m = GetInfo(j);
+            size_t buflen = 0;
+            char *buffer = m.recvbuffer(buflen);
 
             do {
-              result = recv(j, buffer, MAX_BUFFER_SIZE, 0);
+              result = recv(j, buffer, static_cast<int>(buflen), 0);
             } while (result == EUDAQ_ERROR_NO_DATA_RECEIVED &&
                      LastSockError() == EUDAQ_ERROR_Interrupted_function_call);
 
             if (result > 0) {
-              buffer[result] = 0;
-              ConnectionInfoTCP &m = GetInfo(j);
-              m.append(result, buffer);
+              m.received(result);
               while (m.havepacket()) {
                 done = true;
-                m_events.push(
-                    TransportEvent(TransportEvent::RECEIVE, m, m.getpacket()));
+                m_events.Push(TransportEvent::RECEIVE, m, m.getpacket());
               }
             } // else /*if (result == 0)*/ {
             else if (result == 0) {
               debug_transport(
                   "Server #%d, return=%d, WSAError:%d (%s) Disconnected.\n", j,
                   result, errno, strerror(errno));
-              ConnectionInfoTCP &m = GetInfo(j);
-              m_events.push(TransportEvent(TransportEvent::DISCONNECT, m));
+              m_events.Push(TransportEvent::DISCONNECT, m);
               m.Disable();
               closesocket(j);
               FD_CLR(j, &m_fdset);
@@ -499,18 +660,248 @@ namespace eudaq {
   }
 
   std::string TCPServer::ConnectionString() const {
-#ifdef WIN32
-    const char *host = getenv("computername");
+    return name + "://" + local_hostname() + ":" + to_string(m_port);
+  }
+
+#if EUDAQ_PLATFORM_IS(LINUX)
+
+  const std::string EPOLLServer::name = "epoll";
+
+  EPOLLServer::EPOLLServer(const std::string &param)
+      : m_port(from_string(param, 44000)),
+        m_srvsock(open_server_socket(m_port, param)),
+        m_epollfd(epoll_create1(EPOLL_CLOEXEC)) {
+    if (m_epollfd == -1) {
+      closesocket(m_srvsock);
+      EUDAQ_THROW_NOLOG(LastSockErrorString("Failed to create epoll instance"));
+    }
+    epoll_event ev;
+    memset(&ev, 0, sizeof ev);
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = m_srvsock;
+    if (epoll_ctl(m_epollfd, EPOLL_CTL_ADD, m_srvsock, &ev)) {
+      close(m_epollfd);
+      closesocket(m_srvsock);
+      EUDAQ_THROW_NOLOG(LastSockErrorString("Failed to watch server socket"));
+    }
+  }
+
+  EPOLLServer::~EPOLLServer() {
+    for (size_t i = 0; i < m_conn.size(); ++i) {
+      ConnectionInfoTCP *inf =
+          dynamic_cast<ConnectionInfoTCP *>(m_conn[i].get());
+      if (inf && inf->IsEnabled()) {
+        closesocket(inf->GetFd());
+      }
+    }
+    close(m_epollfd);
+    closesocket(m_srvsock);
+  }
+
+  void EPOLLServer::Close(const ConnectionInfo &id) {
+    for (size_t i = 0; i < m_conn.size(); ++i) {
+      if (id.Matches(*m_conn[i])) {
+        ConnectionInfoTCP *inf =
+            dynamic_cast<ConnectionInfoTCP *>(m_conn[i].get());
+        if (inf && inf->IsEnabled()) {
+          Remove(*inf);
+        }
+      }
+    }
+  }
+
+  void EPOLLServer::SendPacket(const unsigned char *data, size_t len,
+                               const ConnectionInfo &id, bool duringconnect) {
+    for (size_t i = 0; i < m_conn.size(); ++i) {
+      if (id.Matches(*m_conn[i])) {
+        ConnectionInfoTCP *inf =
+            dynamic_cast<ConnectionInfoTCP *>(m_conn[i].get());
+        if (inf && inf->IsEnabled() && (inf->GetState() > 0 || duringconnect)) {
+          do_send_packet(inf->GetFd(), data, len);
+        }
+      }
+    }
+  }
+
+  void EPOLLServer::SendPacket(const BufferSegment *segments,
+                               size_t nsegments, const ConnectionInfo &id,
+                               bool duringconnect) {
+    for (size_t i = 0; i < m_conn.size(); ++i) {
+      if (id.Matches(*m_conn[i])) {
+        ConnectionInfoTCP *inf =
+            dynamic_cast<ConnectionInfoTCP *>(m_conn[i].get());
+        if (inf && inf->IsEnabled() && (inf->GetState() > 0 || duringconnect)) {
+          do_send_segments(inf->GetFd(), segments, nsegments);
+        }
+      }
+    }
+  }
+
+  void EPOLLServer::Accept() {
+    // edge-triggered: accept everything that is pending
+    for (;;) {
+      sockaddr_in addr;
+      socklen_t len = sizeof(addr);
+      SOCKET peersock = accept(m_srvsock, (sockaddr *)&addr, &len);
+      if (peersock == INVALID_SOCKET) {
+        if (LastSockError() == EUDAQ_ERROR_Interrupted_function_call)
+          continue;
+        if (LastSockError() != EUDAQ_ERROR_Resource_temp_unavailable &&
+            LastSockError() != EAGAIN)
+          std::cout << LastSockErrorString("Error in accept()") << std::endl;
+        return;
+      }
+      setup_socket(peersock);
+      std::string host = inet_ntoa(addr.sin_addr);
+      host += ":" + to_string(ntohs(addr.sin_port));
+      std::shared_ptr<ConnectionInfoTCP> ptr(
+          new ConnectionInfoTCP(peersock, host));
+      ptr->SetBufferSize(receive_buffer_size(peersock));
+
+      epoll_event ev;
+      memset(&ev, 0, sizeof ev);
+      ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+      ev.data.fd = peersock;
+      if (epoll_ctl(m_epollfd, EPOLL_CTL_ADD, peersock, &ev)) {
+        std::cout << LastSockErrorString("Error in epoll_ctl()") << std::endl;
+        closesocket(peersock);
+        continue;
+      }
+
+      bool inserted = false;
+      for (size_t i = 0; i < m_conn.size(); ++i) {
+        if (m_conn[i]->GetState() < 0) {
+          m_conn[i] = ptr;
+          inserted = true;
+          break;
+        }
+      }
+      if (!inserted)
+        m_conn.push_back(ptr);
+      Peer peer = {ptr.get(), false};
+      m_fdmap[peersock] = peer;
+      m_events.Push(TransportEvent::CONNECT, *ptr);
+    }
+  }
+
+  bool EPOLLServer::Receive(ConnectionInfoTCP &m, bool &drained) {
+    // edge-triggered: the socket must be read until it is drained, but not
+    // all at once, or a fast sender keeps the others waiting
+    static const size_t QUOTA = 64 * 1024;
+    bool gotpacket = false;
+    drained = true;
+    for (size_t bytes = 0; bytes < QUOTA;) {
+      size_t buflen = 0;
+      char *buffer = m.recvbuffer(buflen);
+      int result = recv(m.GetFd(), buffer, buflen, 0);
+      if (result > 0) {
+        bytes += result;
+        m.received(result);
+        while (m.havepacket()) {
+          gotpacket = true;
+          m_events.Push(TransportEvent::RECEIVE, m, m.getpacket());
+        }
+        // a short read emptied the socket, new data will signal a new edge
+        if ((size_t)result < buflen)
+          break;
+        if (bytes >= QUOTA)
+          drained = false;
+      } else if (result == 0) {
+        debug_transport("Server #%d Disconnected.\n", m.GetFd());
+        m_events.Push(TransportEvent::DISCONNECT, m);
+        Remove(m);
+        break;
+      } else if (LastSockError() == EUDAQ_ERROR_Interrupted_function_call) {
+        continue;
+      } else if (LastSockError() == EUDAQ_ERROR_Resource_temp_unavailable ||
+                 LastSockError() == EAGAIN) {
+        break;
+      } else {
+        debug_transport("Server #%d, WSAError:%d (%s) \n", m.GetFd(), errno,
+                        strerror(errno));
+        m_events.Push(TransportEvent::DISCONNECT, m);
+        Remove(m);
+        break;
+      }
+    }
+    return gotpacket;
+  }
+
+  void EPOLLServer::Remove(ConnectionInfoTCP &m) {
+    SOCKET fd = m.GetFd();
+    m.Disable();
+    epoll_ctl(m_epollfd, EPOLL_CTL_DEL, fd, NULL);
+    m_fdmap.erase(fd);
+    closesocket(fd);
+  }
+
+  void EPOLLServer::ProcessEvents(int timeout) {
+#if DEBUG_NOTIMEOUT == 0
+    Time t_start = Time::Current();
+#endif
+    Time t_remain = Time(0, timeout);
+    bool done = false;
+    do {
+      static const int MAX_EVENTS = 64;
+      epoll_event events[MAX_EVENTS];
+      // timeout is given in microseconds, epoll_wait wants milliseconds;
+      // do not wait while sockets still have data from earlier
+      int ms = m_ready.empty()
+                   ? static_cast<int>((t_remain.Seconds() * 1e6 + 999) / 1000)
+                   : 0;
+      int result = epoll_wait(m_epollfd, events, MAX_EVENTS, ms);
+
+      if (result < 0 &&
+          LastSockError() != EUDAQ_ERROR_Interrupted_function_call) {
+        std::cout << LastSockErrorString("Error in epoll_wait()") << std::endl;
+      }
+      for (int i = 0; i < result; ++i) {
+        SOCKET fd = events[i].data.fd;
+        if (fd == m_srvsock) {
+          Accept();
+          continue;
+        }
+        std::unordered_map<SOCKET, Peer>::iterator it = m_fdmap.find(fd);
+        if (it != m_fdmap.end() && !it->second.ready) {
+          it->second.ready = true;
+          m_ready.push_back(fd);
+        }
+      }
+
+      // one turn for each socket that was ready at the start of the pass
+      for (size_t n = m_ready.size(); n > 0; --n) {
+        SOCKET fd = m_ready.front();
+        m_ready.pop_front();
+        std::unordered_map<SOCKET, Peer>::iterator it = m_fdmap.find(fd);
+        if (it == m_fdmap.end() || !it->second.ready)
+          continue; // closed since it was queued
+        bool drained = true;
+        if (Receive(*it->second.info, drained))
+          done = true;
+        // Receive may have removed the connection
+        it = m_fdmap.find(fd);
+        if (it == m_fdmap.end())
+          continue;
+        if (drained)
+          it->second.ready = false;
+        else
+          m_ready.push_back(fd);
+      }
+
+#if DEBUG_NOTIMEOUT
+      t_remain = Time(0, timeout);
 #else
-    const char *host = getenv("HOSTNAME");
+      t_remain = Time(0, timeout) + t_start - Time::Current();
 #endif
+    } while (!done && t_remain > Time(0));
+  }
 
-    if (!host)
-      host = "localhost";
-    // gethostname(buf, sizeof buf);
-    return name + "://" + host + ":" + to_string(m_port);
+  std::string EPOLLServer::ConnectionString() const {
+    return name + "://" + local_hostname() + ":" + to_string(m_port);
   }
 
+#endif
+
   TCPClient::TCPClient(const std::string &param)
       : m_server(param), m_port(44000),
         m_sock(socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)),
@@ -552,6 +943,7 @@ namespace eudaq {
                               m_server + ":" + to_string(m_port)));
     }
     setup_socket(m_sock); // set to non-blocking
+    m_buf.SetBufferSize(receive_buffer_size(m_sock));
   }
 
   void TCPClient::SendPacket(const unsigned char *data, size_t len,
@@ -564,6 +956,13 @@ namespace eudaq {
     // std::cout << "Sent" << std::endl;
   }
 
+  void TCPClient::SendPacket(const BufferSegment *segments, size_t nsegments,
+                             const ConnectionInfo &id, bool) {
+    if (id.Matches(m_buf)) {
+      do_send_segments(m_buf.GetFd(), segments, nsegments);
+    }
+  }
+
   void TCPClient::ProcessEvents(int timeout) {
 // std::cout << "ProcessEvents()" << std::endl;
 #if DEBUG_NOTIMEOUT == 0
@@ -588,10 +987,11 @@ namespace eudaq {
 
       bool donereading = false;
       do {
-        char buffer[MAX_BUFFER_SIZE + 1];
+        size_t buflen = 0;
+        char *buffer = m_buf.recvbuffer(buflen);
 
         do {
-          result = recv(m_sock, buffer, MAX_BUFFER_SIZE, 0);
+          result = recv(m_sock, buffer, static_cast<int>(buflen), 0);
         } while (result == EUDAQ_ERROR_NO_DATA_RECEIVED &&
                  LastSockError() == EUDAQ_ERROR_Interrupted_function_call);
 
@@ -611,10 +1011,9 @@ namespace eudaq {
           EUDAQ_THROW_NOLOG(LastSockErrorString(
               "SocketClient Error (" + to_string(LastSockError()) + ")"));
         } else if (result > 0) {
-          m_buf.append(result, buffer);
+          m_buf.received(result);
           while (m_buf.havepacket()) {
-            m_events.push(TransportEvent(TransportEvent::RECEIVE, m_buf,
-                                         m_buf.getpacket()));
+            m_events.Push(TransportEvent::RECEIVE, m_buf, m_buf.getpacket());
             done = true;
           }
         }
@@ -0,0 +1,55 @@
+/*
+ * ClusterGrid.hh
+ *
+ *  The clusters of a plane binned by their position, for finding the
+ *  clusters near a position without looking at all of them.
+ */
+
+#ifndef CLUSTERGRID_HH_
+#define CLUSTERGRID_HH_
+
+#include <vector>
+
+#include "SimpleStandardCluster.hh"
+
+//!ClusterGrid class
+/*!
+  Holds the clusters of one plane together with their positions, which are
+  only calculated once. Find() bins them into square cells the first time it
+  is called with a given window, after that a search only looks at the
+  clusters in the cells the window overlaps.
+ */
+class ClusterGrid {
+public:
+  ClusterGrid() : _cellSize(0), _minX(0), _minY(0), _nX(0), _nY(0) {}
+
+  //! Set the clusters (in this order), those with less than minsize pixels
+  //! are left out
+  void setClusters(const std::vector<SimpleStandardCluster> &clusters,
+                   int minsize);
+  unsigned int size() const { return _clusters.size(); }
+  const SimpleStandardCluster &getCluster(unsigned int i) const {
+    return _clusters[i];
+  }
+  int getX(unsigned int i) const { return _x[i]; }
+  int getY(unsigned int i) const { return _y[i]; }
+
+  //! The indices of the clusters with |dx| < window and |dy| < window to
+  //! (x, y), in increasing order
+  void Find(int x, int y, int window, std::vector<unsigned int> &found);
+
+private:
+  void Bin(int cellSize);
+  int cellX(int x) const;
+  int cellY(int y) const;
+
+  std::vector<SimpleStandardCluster> _clusters;
+  std::vector<int> _x, _y;
+  int _cellSize; // 0 if not binned yet
+  int _minX, _minY;
+  int _nX, _nY;
+  std::vector<unsigned int> _cellStart; // first entry of a cell in _binned
+  std::vector<unsigned int> _binned;    // cluster indices sorted by cell
+};
+
+#endif /* CLUSTERGRID_HH_ */
@@ -20,6 +20,7 @@
 
 #include "SimpleStandardPlaneDouble.hh"
 #include "CorrelationHistos.hh"
+#include "ClusterGrid.hh"
 #include "BaseCollection.hh"
 
 using namespace std;
@@ -71,14 +72,12 @@ protected:
   map<pair<SimpleStandardPlane, SimpleStandardPlane>, CorrelationHistos *> _map;
   vector<SimpleStandardPlane> _planes;
   bool isPlaneRegistered(SimpleStandardPlane p);
-  bool checkCorrelations(const SimpleStandardCluster &cluster1,
-                         const SimpleStandardCluster &cluster2,
-                         const bool all_mimosa);
   void fillHistograms(vector<vector<pair<int, SimpleStandardCluster>>> tracks,
                       const SimpleStandardEvent &simpEv);
   void fillHistograms(const SimpleStandardPlaneDouble &simpPlaneDouble);
   void fillHistograms(const SimpleStandardPlane &p1,
-                      const SimpleStandardPlane &p2);
+                      const SimpleStandardPlane &p2, ClusterGrid &clusters1,
+                      ClusterGrid &clusters2);
 
 public:
   CorrelationCollection();
@@ -0,0 +1,84 @@
+/*
+ * FillPool.hh
+ *
+ *  Threads analysing events and filling the histograms into per-thread
+ *  shards.
+ */
+
+#ifndef FILLPOOL_HH_
+#define FILLPOOL_HH_
+
+#include "eudaq/StandardEvent.hh"
+#include "HistoShard.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//!FillPool class
+/*!
+  Passes events to a number of worker threads. Each worker owns a
+  HistoShardSet that is installed as its thread's shard set (see
+  ShardedFill), so the histograms themselves are only changed by Merge(),
+  which is called from the GUI thread.
+
+  A worker holds the mutex of its shard set while it handles an event. A
+  Pause object holds all of them, so while it exists no event is being
+  handled and the histograms and collections may be read and changed
+  freely.
+ */
+class FillPool {
+public:
+  typedef std::function<void(const eudaq::StandardEvent &)> Handler;
+
+  //! threads = 0 uses one thread per core
+  FillPool(const Handler &handler, unsigned threads);
+  ~FillPool();
+
+  //! Queue an event; blocks while too many events are waiting
+  void Add(std::shared_ptr<const eudaq::StandardEvent> ev);
+  //! Wait until all queued events have been handled
+  void Drain();
+  unsigned getNThreads() const { return _shards.size(); }
+  //! The highest number of the events handled so far
+  unsigned getLastEventNumber();
+
+  class Pause {
+  public:
+    explicit Pause(FillPool &pool);
+    ~Pause();
+
+  private:
+    Pause(const Pause &);
+    Pause &operator=(const Pause &);
+    FillPool &_pool;
+  };
+
+  //! Add the shards to the histograms (only while paused)
+  void Merge();
+  //! Throw away the shards and their fills (only while paused); needed
+  //! whenever histograms are reset or booked
+  void Clear();
+
+private:
+  FillPool(const FillPool &);
+  FillPool &operator=(const FillPool &);
+  void WorkerThread(HistoShardSet *shards);
+
+  Handler _handler;
+  size_t _maxqueue;
+  std::vector<HistoShardSet *> _shards;
+  std::vector<std::thread> _threads;
+  std::mutex _mutex;
+  std::condition_variable _cvwork, _cvdone;
+  std::deque<std::shared_ptr<const eudaq::StandardEvent> > _queue;
+  size_t _busy;
+  unsigned _lastevent;
+  bool _stop;
+};
+
+#endif /* FILLPOOL_HH_ */
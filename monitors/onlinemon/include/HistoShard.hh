@@ -0,0 +1,114 @@
+/*
+ * HistoShard.hh
+ *
+ *  Per-thread copies of the histograms, for filling them from several
+ *  threads without touching the ROOT objects.
+ */
+
+#ifndef HISTOSHARD_HH_
+#define HISTOSHARD_HH_
+
+#include <TH1.h>
+#include <TH2.h>
+
+#include "HitCounter.hh"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+//!HistoShard class
+/*!
+  Plain arrays holding the fills of one thread for one histogram. Fills
+  with unit weight into fixed bins are counted per bin; anything else
+  (weights, profiles, extendable or variable axes) is stored as it came and
+  replayed into the histogram. Merge() adds everything to the histogram,
+  including the statistics, and empties the shard.
+ */
+class HistoShard {
+public:
+  explicit HistoShard(TH1 *histo);
+
+  void Fill(double x, double w);
+  void Fill(double x, double y, double w);
+  void Merge();
+  void Clear();
+
+private:
+  struct Axis {
+    int nbins;
+    double min, max;
+    int bin(double v) const {
+      if (v < min)
+        return 0;
+      if (!(v < max))
+        return nbins + 1;
+      return 1 + int(nbins * (v - min) / (max - min));
+    }
+  };
+  void addBin(int bin);
+
+  TH1 *_histo;
+  Axis _x, _y;
+  bool _is2D;
+  bool _binned; // false if all fills are replayed
+  std::vector<double> _bins;
+  std::vector<int> _touched; // bins with content, in order of the first fill
+  double _entries;
+  double _sumw, _sumwx, _sumwx2, _sumwy, _sumwy2, _sumwxy;
+  std::vector<double> _raw; // x, y, w of the replayed fills
+};
+
+//!HistoShardSet class
+/*!
+  The shards of all histograms filled by one thread, and its increments to
+  plain counters and hit counters. The mutex is held by the owning thread while it fills and
+  by whoever merges or clears the set.
+
+  A shard keeps the histogram pointer and binning it was created for, so
+  Clear() deletes the shards as well: a histogram that is reset may change
+  its axes, and one that is booked again may get the address of the one it
+  replaces.
+ */
+class HistoShardSet {
+public:
+  HistoShardSet() {}
+  ~HistoShardSet();
+
+  HistoShard &getShard(TH1 *histo);
+  void addCount(int &counter, int n) { _counts[&counter] += n; }
+  void addHit(HitCounter &counter, unsigned int cell) {
+    _hits[&counter].push_back(cell);
+  }
+  void Merge();
+  void Clear();
+  std::mutex &getMutex() { return _mutex; }
+
+private:
+  HistoShardSet(const HistoShardSet &);
+  HistoShardSet &operator=(const HistoShardSet &);
+
+  std::map<TH1 *, HistoShard *> _shards;
+  std::map<int *, int> _counts;
+  std::map<HitCounter *, std::vector<unsigned int> > _hits;
+  std::mutex _mutex;
+};
+
+//!ShardedFill class
+/*!
+  Fills a histogram, or its shard if the calling thread has a shard set.
+  Without a shard set the histogram is filled directly, as before.
+ */
+class ShardedFill {
+public:
+  static void Fill(TH1 *histo, double x, double w = 1);
+  static void Fill(TH2 *histo, double x, double y);
+  //! Increment a counter that is read together with the histograms
+  static void Count(int &counter, int n = 1);
+  //! Add a hit to a cell of a hit counter
+  static void Count(HitCounter &counter, unsigned int cell);
+  //! The shard set of the calling thread, NULL to fill directly
+  static void setThreadShards(HistoShardSet *shards);
+};
+
+#endif /* HISTOSHARD_HH_ */
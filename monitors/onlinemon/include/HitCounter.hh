@@ -0,0 +1,65 @@
+/*
+ * HitCounter.hh
+ *
+ *  Hit counts of the pixels of a plane, remembering which pixels got hits
+ *  since they were last looked at.
+ */
+
+#ifndef HITCOUNTER_HH_
+#define HITCOUNTER_HH_
+
+#include <vector>
+
+//!HitCounter class
+/*!
+  Counts for the cells of a contiguous grid. The first change of a cell is
+  recorded together with its count before, until the changes are taken
+  with clearChanges(), so whatever is derived from the counts only has to
+  be updated for these cells.
+ */
+class HitCounter {
+public:
+  struct Change {
+    unsigned int cell;
+    int before;
+  };
+
+  HitCounter() {}
+  explicit HitCounter(unsigned int ncells) { resize(ncells); }
+
+  void resize(unsigned int ncells) {
+    _counts.assign(ncells, 0);
+    _changed.assign(ncells, false);
+    _changes.clear();
+  }
+  unsigned int size() const { return _counts.size(); }
+
+  void add(unsigned int cell, int n = 1) {
+    if (!_changed[cell]) {
+      _changed[cell] = true;
+      Change change = {cell, _counts[cell]};
+      _changes.push_back(change);
+    }
+    _counts[cell] += n;
+  }
+  int operator[](unsigned int cell) const { return _counts[cell]; }
+
+  //! The cells changed since the last clearChanges(), in order of change
+  const std::vector<Change> &getChanges() const { return _changes; }
+  void clearChanges() {
+    for (unsigned int i = 0; i < _changes.size(); ++i) {
+      _changed[_changes[i].cell] = false;
+    }
+    _changes.clear();
+  }
+
+  //! Set all counts to zero and forget the changes
+  void clear() { resize(_counts.size()); }
+
+private:
+  std::vector<int> _counts;
+  std::vector<bool> _changed;
+  std::vector<Change> _changes;
+};
+
+#endif /* HITCOUNTER_HH_ */
@@ -12,8 +12,10 @@
 #include <TFile.h>
 
 #include <map>
+#include <vector>
 
 #include "SimpleStandardEvent.hh"
+#include "HitCounter.hh"
 
 using namespace std;
 
@@ -102,8 +104,13 @@ public:
   void setRootMonitor(RootMonitor *mon) { _mon = mon; }
 
 private:
-  int **plane_map_array; // store an array representing the map
-  int zero_plane_array(); // fill array with zeros;
+  // hits per pixel for calculating e.g. hotpixels and occupancy, the cell
+  // of a pixel is x * _maxY + y
+  HitCounter _pixelHits;
+  std::map<int, int> _pixelsWithHits; // number of pixels per number of hits
+  std::vector<unsigned int> _hotPixels; // cells of the current hot pixels
+  std::vector<bool> _isHotPixel;
+  void clearPixelHits();
   int SetHistoAxisLabelx(TH1 *histo, string xlabel);
   int SetHistoAxisLabely(TH1 *histo, string ylabel);
   int SetHistoAxisLabels(TH1 *histo, string xlabel, string ylabel);
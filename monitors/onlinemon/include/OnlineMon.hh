@@ -46,6 +46,8 @@
 // STL includes
 #include <string>
 #include <memory>
+#include <set>
+#include <utility>
 
 #ifdef WIN32
 #define EUDAQ_SLEEP(x) Sleep(x * 1000)
@@ -58,6 +60,19 @@ using namespace std;
 class OnlineMonWindow;
 class BaseCollection;
 class CheckEOF;
+class FillPool;
+
+//! Processing times of the previous event handled by a thread, they are
+//! filled into the monitor performance histograms with the next one
+struct MonitorTimes {
+  MonitorTimes() : analysis(0), fill(0), clustering(0), correlation(0) {}
+  TStopwatch processing;
+  TStopwatch inner;
+  double analysis;
+  double fill;
+  double clustering;
+  double correlation;
+};
 
 class RootMonitor : private eudaq::Holder<int>,
                     // public TApplication,
@@ -83,8 +98,9 @@ public:
   RootMonitor(const std::string &runcontrol, const std::string &datafile, int x,
               int y, int w, int h, int argc, int offline, const unsigned lim,
               const unsigned skip_, const unsigned int skip_with_counter,
-              const std::string &conffile = "");
-  ~RootMonitor() { gApplication->Terminate(); }
+              const std::string &conffile = "", unsigned threads = 1,
+              unsigned fillthreads = 1, const std::string &sharedmemory = "");
+  ~RootMonitor();
   void registerSensorInGUI(std::string name, int id);
   HitmapCollection *hmCollection;
   CorrelationCollection *corrCollection;
@@ -108,6 +124,10 @@ public:
   }
   virtual void OnStartRun(unsigned param);
   virtual void OnEvent(const eudaq::StandardEvent &ev);
+  //! Add what the fill threads filled to the histograms (GUI thread)
+  void MergeHistograms();
+  //! Reset all collections, including what the fill threads filled
+  void ResetHistograms();
 
   virtual void OnBadEvent(std::shared_ptr<eudaq::Event> ev) {
     EUDAQ_ERROR("Bad event type found in data file");
@@ -134,16 +154,17 @@ public:
   string GetSnapShotDir();
   OnlineMonConfiguration mon_configdata; // FIXME
 private:
+  void AnalyseEvent(const eudaq::StandardEvent &ev, MonitorTimes &times);
+
   string snapshotdir;
   EventSanityChecker myevent; // FIXME
   bool useTrackCorrelator;
-  TStopwatch my_event_processing_time;
-  TStopwatch my_event_inner_operations_time;
-  double previous_event_analysis_time;
-  double previous_event_fill_time;
-  double previous_event_clustering_time;
-  double previous_event_correlation_time;
+  MonitorTimes _times; // of the events analysed by the monitor thread
   unsigned int tracksPerEvent;
+  FillPool *_fillPool; // NULL if the monitor thread fills the histograms
+  unsigned int _calculatedEvents; // event number of the last Calculate
+  // (sensor, id) of the planes with booked histograms
+  std::set<std::pair<std::string, int> > _bookedPlanes;
 };
 
 #ifdef __CINT__
@@ -45,6 +45,10 @@ public:
 
   int getCorrel_minclustersize() const;
   void setCorrel_minclustersize(int correl_minclustersize);
+  int getCorrel_window() const;
+  void setCorrel_window(int correl_window);
+  int getCorrel_allpairsmax() const;
+  void setCorrel_allpairsmax(int correl_allpairsmax);
   std::vector<int> getPlanes_to_be_skipped() const;
   void setPlanes_to_be_skipped(std::vector<int> planes_to_be_skipped);
 
@@ -60,6 +64,8 @@ private:
   std::map<int, bool> correlation_xy_flip;
   std::vector<int> planes_to_be_skipped;
   int correl_minclustersize;
+  int correl_window;      // 0: correlate all pairs of clusters
+  int correl_allpairsmax; // up to this many pairs all are correlated anyway
   // Clusterizer settings
 
   // hotcluster finder settings
@@ -0,0 +1,87 @@
+/*
+ * ClusterGrid.cc
+ *
+ *  The clusters of a plane binned by their position, for finding the
+ *  clusters near a position without looking at all of them.
+ */
+
+#include "ClusterGrid.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void ClusterGrid::setClusters(const std::vector<SimpleStandardCluster> &clusters,
+                              int minsize) {
+  _clusters.clear();
+  _x.clear();
+  _y.clear();
+  for (unsigned int i = 0; i < clusters.size(); ++i) {
+    if (clusters[i].getNPixel() < minsize)
+      continue;
+    _clusters.push_back(clusters[i]);
+    _x.push_back(clusters[i].getX());
+    _y.push_back(clusters[i].getY());
+  }
+  _cellSize = 0;
+}
+
+int ClusterGrid::cellX(int x) const {
+  return std::min(std::max((x - _minX) / _cellSize, 0), _nX - 1);
+}
+
+int ClusterGrid::cellY(int y) const {
+  return std::min(std::max((y - _minY) / _cellSize, 0), _nY - 1);
+}
+
+void ClusterGrid::Bin(int cellSize) {
+  _cellSize = cellSize;
+  _minX = *std::min_element(_x.begin(), _x.end());
+  _minY = *std::min_element(_y.begin(), _y.end());
+  int width = *std::max_element(_x.begin(), _x.end()) - _minX + 1;
+  int height = *std::max_element(_y.begin(), _y.end()) - _minY + 1;
+  // a small window on a large plane with few clusters would give mostly
+  // empty cells, keep their number in proportion to the clusters
+  double maxcells = 4. * _clusters.size() + 64;
+  if ((double)width * height > maxcells * _cellSize * _cellSize) {
+    _cellSize = (int)std::ceil(std::sqrt((double)width * height / maxcells));
+  }
+  _nX = (width + _cellSize - 1) / _cellSize;
+  _nY = (height + _cellSize - 1) / _cellSize;
+
+  // counting sort of the clusters by cell
+  _cellStart.assign(_nX * _nY + 1, 0);
+  for (unsigned int i = 0; i < _clusters.size(); ++i) {
+    ++_cellStart[cellY(_y[i]) * _nX + cellX(_x[i]) + 1];
+  }
+  for (unsigned int cell = 0; cell + 1 < _cellStart.size(); ++cell) {
+    _cellStart[cell + 1] += _cellStart[cell];
+  }
+  _binned.resize(_clusters.size());
+  std::vector<unsigned int> next(_cellStart.begin(), _cellStart.end() - 1);
+  for (unsigned int i = 0; i < _clusters.size(); ++i) {
+    _binned[next[cellY(_y[i]) * _nX + cellX(_x[i])]++] = i;
+  }
+}
+
+void ClusterGrid::Find(int x, int y, int window,
+                       std::vector<unsigned int> &found) {
+  found.clear();
+  if (window <= 0 || _clusters.empty())
+    return;
+  if (_cellSize < window)
+    Bin(window);
+  int x0 = cellX(x - window + 1), x1 = cellX(x + window - 1);
+  int y0 = cellY(y - window + 1), y1 = cellY(y + window - 1);
+  for (int cy = y0; cy <= y1; ++cy) {
+    for (int cx = x0; cx <= x1; ++cx) {
+      int cell = cy * _nX + cx;
+      for (unsigned int k = _cellStart[cell]; k < _cellStart[cell + 1]; ++k) {
+        unsigned int i = _binned[k];
+        if (std::abs(_x[i] - x) < window && std::abs(_y[i] - y) < window)
+          found.push_back(i);
+      }
+    }
+  }
+  std::sort(found.begin(), found.end());
+}
@@ -8,6 +8,8 @@
 #include "CorrelationCollection.hh"
 #include "OnlineMon.hh"
 
+#include <algorithm>
+
 CorrelationCollection::CorrelationCollection()
     : BaseCollection(), _mapOld(), _map(), _planes(), skip_this_plane(),
       correlateAllPlanes(false), selected_planes_to_skip(),
@@ -38,31 +40,6 @@ bool CorrelationCollection::isPlaneRegistered(const SimpleStandardPlane p) {
   return true;
 }
 
-bool CorrelationCollection::checkCorrelations(
-    const SimpleStandardCluster &cluster1,
-    const SimpleStandardCluster &cluster2,
-    const bool only_mimos_planes = true) {
-  int diffParam;
-
-  if (only_mimos_planes == true) {
-    diffParam = getWindowWidthForCorrelation();
-  } else {
-    return false; //(Phill) Changed this from true to false because I think if
-                  //it can only correlate mimosa planes then it should fail if
-                  //there is anything else
-  }
-
-  if (abs(cluster1.getX() - cluster2.getX()) < diffParam &&
-      abs(cluster1.getY() - cluster2.getY()) < diffParam) {
-    // This says that if the x and y differences of the two clusters is less
-    // than the 'window width for correlation' then the check is successful,
-    // otherwise it fails
-    return true;
-  } else {
-    return false;
-  }
-}
-
 void CorrelationCollection::fillHistograms(
     const SimpleStandardPlaneDouble &simpPlaneDouble) {
   CorrelationHistos *corrmap = _mapOld[simpPlaneDouble];
@@ -107,7 +84,10 @@ CorrelationHistos *
 CorrelationCollection::getCorrelationHistos(const SimpleStandardPlane &p1,
                                             const SimpleStandardPlane &p2) {
   std::pair<SimpleStandardPlane, SimpleStandardPlane> plane(p1, p2);
-  return _map[plane];
+  // only look up the histograms, the map is shared by the fill threads
+  std::map<std::pair<SimpleStandardPlane, SimpleStandardPlane>,
+           CorrelationHistos *>::const_iterator it = _map.find(plane);
+  return it == _map.end() ? NULL : it->second;
 }
 
 void CorrelationCollection::Reset() {
@@ -127,11 +107,9 @@ void CorrelationCollection::Fill(const SimpleStandardEvent &simpev) {
   if (skip_this_plane.size() == 0) // do this only at the very first event
   {
     selected_planes_to_skip = _mon->mon_configdata.getPlanes_to_be_skipped();
-    skip_this_plane.reserve(nPlanes);
-    // init vector
-    for (int elements = 0; elements < nPlanes; elements++) {
-      skip_this_plane[elements] = false;
-    }
+    // init vector (sized, so this is really only done once: later events may
+    // be filled from several threads at the same time)
+    skip_this_plane.assign(nPlanes, false);
     // now get vector of planes to be disabled and set the corresponding entries
     // to true
     for (unsigned int skipplanes = 0;
@@ -147,12 +125,24 @@ void CorrelationCollection::Fill(const SimpleStandardEvent &simpev) {
     if (nPlanes_disabled > 0)
       std::cout << "CorrelationCollection : Disabling " << nPlanes_disabled
                 << " Planes" << endl;
+  } else {
+    nPlanes_disabled =
+        std::count(skip_this_plane.begin(), skip_this_plane.end(), true);
   }
   if (nPlanes - nPlanes_disabled < 2) {
     if (nPlanes > 2)
       std::cout << "CorrelationCollection : Too Many Planes Disabled ..."
                 << endl;
   } else {
+    // the clusters of each plane, with their positions, are only looked up
+    // once and not for every pair of planes
+    std::vector<ClusterGrid> clustersInPlanes(nPlanes);
+    for (int plane = 0; plane < nPlanes; plane++) {
+      if (!skip_this_plane[plane])
+        clustersInPlanes[plane].setClusters(
+            simpev.getPlane(plane).getClusters(),
+            _mon->mon_configdata.getCorrel_minclustersize());
+    }
     for (int planeA = 0; planeA < nPlanes; planeA++) {
       const SimpleStandardPlane &simpPlane = simpev.getPlane(planeA);
 #ifdef DEBUG
@@ -198,7 +188,8 @@ void CorrelationCollection::Fill(const SimpleStandardEvent &simpev) {
             (skip_this_plane[planeB]) == false) {
           const SimpleStandardPlane &p1 = simpev.getPlane(planeA);
           const SimpleStandardPlane &p2 = simpev.getPlane(planeB);
-          fillHistograms(p1, p2);
+          fillHistograms(p1, p2, clustersInPlanes[planeA],
+                         clustersInPlanes[planeB]);
         }
       }
     }
@@ -209,24 +200,27 @@ unsigned int
 CorrelationCollection::FillWithTracks(const SimpleStandardEvent &simpev) {
   int nPlanes = simpev.getNPlanes();
   int nPlanes_disabled = 0;
-  std::vector<vector<SimpleStandardCluster>> clustersInPlanes;
+  std::vector<ClusterGrid> clustersInPlanes;
+  // clusters taken for a track are marked instead of being removed, so the
+  // grids stay valid
+  std::vector<vector<bool>> usedClusters;
+  std::vector<unsigned int> nUnusedClusters;
   std::vector<vector<pair<int, SimpleStandardCluster>>> reconstructedTracks;
   std::vector<pair<int, SimpleStandardCluster>> singleTrack;
   singleTrack.reserve(nPlanes);
   bool noClusterFound;
   const int lastPlane = nPlanes - 1;
-  SimpleStandardCluster tempCluster;
-  bool correlationDecission;
+  const int window = getWindowWidthForCorrelation();
+  std::vector<unsigned int> candidates;
+  int trackX = 0, trackY = 0; // position of the last cluster of the track
 
   unsigned int plane_vector_size = 0;
   if (skip_this_plane.size() == 0) // do this only at the very first event
   {
     selected_planes_to_skip = _mon->mon_configdata.getPlanes_to_be_skipped();
-    skip_this_plane.reserve(nPlanes);
-    // init vector
-    for (int elements = 0; elements < nPlanes; elements++) {
-      skip_this_plane[elements] = false;
-    }
+    // init vector (sized, so this is really only done once: later events may
+    // be filled from several threads at the same time)
+    skip_this_plane.assign(nPlanes, false);
     // now get vector of planes to be disabled and set the corresponding entries
     // to true
     for (unsigned int skipplanes = 0;
@@ -242,6 +236,9 @@ CorrelationCollection::FillWithTracks(const SimpleStandardEvent &simpev) {
     if (nPlanes_disabled > 0)
       std::cout << "CorrelationCollection : Disabling " << nPlanes_disabled
                 << " Planes" << endl;
+  } else {
+    nPlanes_disabled =
+        std::count(skip_this_plane.begin(), skip_this_plane.end(), true);
   }
   if (nPlanes - nPlanes_disabled < 2) {
     if (nPlanes > 2)
@@ -264,7 +261,12 @@ CorrelationCollection::FillWithTracks(const SimpleStandardEvent &simpev) {
             back_inserter(clustersAfterDeletion), checkIfClusterIsBigEnough);
         //                cout<< "Clusters: " << clustersAfterDeletion.size() <<
         //                endl;
-        clustersInPlanes.push_back(clustersAfterDeletion);
+        std::sort(clustersAfterDeletion.begin(), clustersAfterDeletion.end(),
+                  SortClustersByXY());
+        clustersInPlanes.push_back(ClusterGrid());
+        clustersInPlanes.back().setClusters(clustersAfterDeletion, 0);
+        usedClusters.push_back(vector<bool>(clustersAfterDeletion.size()));
+        nUnusedClusters.push_back(clustersAfterDeletion.size());
 
         if (!isPlaneRegistered(simpPlane)) {
           plane_vector_size =
@@ -290,68 +292,64 @@ CorrelationCollection::FillWithTracks(const SimpleStandardEvent &simpev) {
       }
     }
   }
-  for (unsigned int plane = 0; plane < clustersInPlanes.size(); ++plane)
-    std::sort(clustersInPlanes.at(plane).begin(),
-              clustersInPlanes.at(plane).end(), SortClustersByXY());
-
+  // The clusters of a plane are taken from the back, the sort order, and a
+  // track is continued with the last unused cluster in the window of the
+  // next plane.
   for (unsigned int currPlaneIndex = 0;
-       currPlaneIndex < clustersInPlanes.size() - 2; ++currPlaneIndex) {
-    std::vector<SimpleStandardCluster> &currentPlane =
-        clustersInPlanes.at(currPlaneIndex);
+       currPlaneIndex + 2 < clustersInPlanes.size(); ++currPlaneIndex) {
+    ClusterGrid &currentPlane = clustersInPlanes.at(currPlaneIndex);
+    vector<bool> &currentUsed = usedClusters.at(currPlaneIndex);
+    unsigned int &currentUnused = nUnusedClusters.at(currPlaneIndex);
 
     singleTrack.clear();
-    while (currentPlane.size() > 0) {
+    while (currentUnused > 0) {
       if (singleTrack.size() > 0)
         singleTrack.clear();
 
-      while (singleTrack.size() == 0 && currentPlane.size() > 0) {
-        tempCluster = currentPlane.back();
+      while (singleTrack.size() == 0 && currentUnused > 0) {
+        int last = currentPlane.size() - 1;
+        while (currentUsed[last])
+          --last;
+        const SimpleStandardCluster &tempCluster = currentPlane.getCluster(last);
         if (tempCluster.getNPixel() >=
             _mon->mon_configdata.getCorrel_minclustersize()) {
           std::pair<int, SimpleStandardCluster> trackPair(currPlaneIndex,
                                                           tempCluster);
           singleTrack.push_back(trackPair);
+          trackX = currentPlane.getX(last);
+          trackY = currentPlane.getY(last);
         }
-        currentPlane.pop_back();
+        currentUsed[last] = true;
+        --currentUnused;
       }
 
       if (singleTrack.size() > 0) {
-        for (int nextPlaneIndex = ++currPlaneIndex; nextPlaneIndex < nPlanes;
-             ++nextPlaneIndex) {
-          std::vector<SimpleStandardCluster> &clustersInNextPlane =
-              clustersInPlanes.at(nextPlaneIndex);
+        for (int nextPlaneIndex = ++currPlaneIndex;
+             nextPlaneIndex < (int)clustersInPlanes.size(); ++nextPlaneIndex) {
+          ClusterGrid &clustersInNextPlane = clustersInPlanes.at(nextPlaneIndex);
+          vector<bool> &nextUsed = usedClusters.at(nextPlaneIndex);
+
+          // only MIMOSA26 planes are correlated
+          int match = -1;
+          if (simpev.getPlane(currPlaneIndex).is_MIMOSA26 &&
+              simpev.getPlane(nextPlaneIndex).is_MIMOSA26) {
+            clustersInNextPlane.Find(trackX, trackY, window, candidates);
+            for (unsigned int k = candidates.size(); k > 0 && match < 0; --k) {
+              if (!nextUsed[candidates[k - 1]])
+                match = candidates[k - 1];
+            }
+          }
           noClusterFound = false;
-
-          //                    for(std::vector<SimpleStandardCluster>::iterator
-          //                    it = --nextPlane.end(); it >= nextPlane.begin();
-          //                    --it)
-          //                    int currentSize = clustersInNextPlane.size();
-          for (int currentclusterIndex = clustersInNextPlane.size() - 1;
-               currentclusterIndex >= 0; --currentclusterIndex) {
-            SimpleStandardCluster &currentCluster =
-                clustersInNextPlane.at(currentclusterIndex);
-            //                        if( currentCluster.getNPixel() >=
-            //                        _mon->mon_configdata.getCorrel_minclustersize()
-            //                                &&
-            //                                checkCorrelations(singleTrack.back().second,
-            //                                currentCluster) )
-
-            if (simpev.getPlane(currPlaneIndex).is_MIMOSA26 &&
-                simpev.getPlane(nextPlaneIndex).is_MIMOSA26)
-              correlationDecission =
-                  checkCorrelations(singleTrack.back().second, currentCluster);
-            else
-              correlationDecission = checkCorrelations(
-                  singleTrack.back().second, currentCluster, false);
-            if (correlationDecission) {
-              std::pair<int, SimpleStandardCluster> trackPair(nextPlaneIndex,
-                                                              currentCluster);
-              singleTrack.push_back(trackPair);
-              clustersInNextPlane.erase(clustersInNextPlane.begin() +
-                                        currentclusterIndex);
-              break;
-            } else if (currentclusterIndex == 0)
-              noClusterFound = true;
+          if (match >= 0) {
+            std::pair<int, SimpleStandardCluster> trackPair(
+                nextPlaneIndex, clustersInNextPlane.getCluster(match));
+            singleTrack.push_back(trackPair);
+            trackX = clustersInNextPlane.getX(match);
+            trackY = clustersInNextPlane.getY(match);
+            nextUsed[match] = true;
+            --nUnusedClusters.at(nextPlaneIndex);
+          } else if (nUnusedClusters.at(nextPlaneIndex) > 0) {
+            noClusterFound = true;
           }
 
           if (nextPlaneIndex == lastPlane || noClusterFound) {
@@ -394,45 +392,51 @@ void CorrelationCollection::fillHistograms(
             currentTrack.at(clusterPair2).second;
         pair<SimpleStandardPlane, SimpleStandardPlane> planePair(firstPlane,
                                                                  secondPlane);
-        CorrelationHistos *corrmap = _map[planePair];
-
-        corrmap->Fill(firstCluster, secondCluster);
+        // only look up the histograms, the map is shared by the fill threads
+        map<pair<SimpleStandardPlane, SimpleStandardPlane>,
+            CorrelationHistos *>::const_iterator corrmap = _map.find(planePair);
+        if (corrmap != _map.end() && corrmap->second != NULL)
+          corrmap->second->Fill(firstCluster, secondCluster);
       }
     }
   }
 }
 
 void CorrelationCollection::fillHistograms(const SimpleStandardPlane &p1,
-                                           const SimpleStandardPlane &p2) {
+                                           const SimpleStandardPlane &p2,
+                                           ClusterGrid &clusters1,
+                                           ClusterGrid &clusters2) {
 
   std::pair<SimpleStandardPlane, SimpleStandardPlane> plane(p1, p2);
-  CorrelationHistos *corrmap = _map[plane];
+  // only look up the histograms, the map is shared by the fill threads
+  std::map<std::pair<SimpleStandardPlane, SimpleStandardPlane>,
+           CorrelationHistos *>::const_iterator it = _map.find(plane);
+  CorrelationHistos *corrmap = it == _map.end() ? NULL : it->second;
   if (corrmap == NULL) {
     // std::cout << "CorrelationCollection: Histogram not registered ...yet  "
     // << p1.getName()<< " "<<p1.getID() <<" / "<< p2.getName()<<"
     // "<<p2.getID()<<std::endl;
   } else {
-    const std::vector<SimpleStandardCluster> aClusters = p1.getClusters();
-    const std::vector<SimpleStandardCluster> bClusters = p2.getClusters();
-
-    for (unsigned int acluster = 0; acluster < aClusters.size(); acluster++) {
-      const SimpleStandardCluster &oneAcluster = aClusters.at(acluster);
-      if (oneAcluster.getNPixel() <
-          _mon->mon_configdata.getCorrel_minclustersize()) // we are only
-                                                           // interested in
-                                                           // clusters with
-                                                           // several pixels
-      {
-        continue;
+    // the clusters are already restricted to the minimum cluster size
+    int window = _mon->mon_configdata.getCorrel_window();
+    if (window <= 0 || (double)clusters1.size() * clusters2.size() <=
+                           _mon->mon_configdata.getCorrel_allpairsmax()) {
+      for (unsigned int acluster = 0; acluster < clusters1.size(); acluster++) {
+        for (unsigned int bcluster = 0; bcluster < clusters2.size();
+             bcluster++) {
+          corrmap->Fill(clusters1.getCluster(acluster),
+                        clusters2.getCluster(bcluster));
+        }
       }
-      for (unsigned int bcluster = 0; bcluster < bClusters.size(); bcluster++) {
-        const SimpleStandardCluster &oneBcluster = bClusters.at(bcluster);
-        //
-        if (oneBcluster.getNPixel() <
-            _mon->mon_configdata.getCorrel_minclustersize()) {
-          continue;
-        } else {
-          corrmap->Fill(oneAcluster, oneBcluster);
+    } else {
+      // too many pairs, only correlate the clusters within the window
+      std::vector<unsigned int> found;
+      for (unsigned int acluster = 0; acluster < clusters1.size(); acluster++) {
+        clusters2.Find(clusters1.getX(acluster), clusters1.getY(acluster),
+                       window, found);
+        for (unsigned int i = 0; i < found.size(); i++) {
+          corrmap->Fill(clusters1.getCluster(acluster),
+                        clusters2.getCluster(found[i]));
         }
       }
     }
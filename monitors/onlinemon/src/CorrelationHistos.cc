@@ -6,6 +6,7 @@
  */
 
 #include "CorrelationHistos.hh"
+#include "HistoShard.hh"
 
 CorrelationHistos::CorrelationHistos(SimpleStandardPlane p1,
                                      SimpleStandardPlane p2)
@@ -61,10 +62,10 @@ void CorrelationHistos::Fill(const SimpleStandardCluster &cluster1,
   // std::cout << "Filling Histogram: " << _2dcorrX->GetName() << " (" <<
   // cluster1.getX() << ", " << cluster2.getX() << ")" << std::endl;
   if (_2dcorrX != NULL)
-    _2dcorrX->Fill(cluster1.getX(), cluster2.getX());
+    ShardedFill::Fill(_2dcorrX, cluster1.getX(), cluster2.getX());
   if (_2dcorrY != NULL)
-    _2dcorrY->Fill(cluster1.getY(), cluster2.getY());
-  _fills++;
+    ShardedFill::Fill(_2dcorrY, cluster1.getY(), cluster2.getY());
+  ShardedFill::Count(_fills);
 }
 
 void CorrelationHistos::Reset() {
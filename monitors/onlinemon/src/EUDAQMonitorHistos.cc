@@ -6,6 +6,7 @@
  */
 
 #include "../include/EUDAQMonitorHistos.hh"
+#include "HistoShard.hh"
 
 EUDAQMonitorHistos::EUDAQMonitorHistos(const SimpleStandardEvent &ev) {
   nplanes = ev.getNPlanes();
@@ -80,24 +81,24 @@ EUDAQMonitorHistos::~EUDAQMonitorHistos() {
 void EUDAQMonitorHistos::Fill(const SimpleStandardEvent &ev) {
 
   unsigned int event_nr = ev.getEvent_number();
-  Planes_perEventHisto->Fill(ev.getNPlanes());
+  ShardedFill::Fill(Planes_perEventHisto, ev.getNPlanes());
   unsigned int nhits_total = 0;
 
   for (unsigned int i = 0; i < nplanes; i++) {
-    Hits_vs_PlaneHisto->Fill(i, ev.getPlane(i).getNHits());
-    Hits_vs_Events[i]->Fill(event_nr, ev.getPlane(i).getNHits());
-    TLUdelta_perEventHisto[i]->Fill(
-        event_nr,
+    ShardedFill::Fill(Hits_vs_PlaneHisto, i, ev.getPlane(i).getNHits());
+    ShardedFill::Fill(Hits_vs_Events[i], event_nr, ev.getPlane(i).getNHits());
+    ShardedFill::Fill(
+        TLUdelta_perEventHisto[i], event_nr,
         ev.getPlane(i).getTLUEvent() -
             (event_nr % 32768)); // TLU counter can only hnadel 32768 counts
     nhits_total += ev.getPlane(i).getNHits();
   }
-  Hits_vs_EventsTotal->Fill(event_nr, nhits_total);
+  ShardedFill::Fill(Hits_vs_EventsTotal, event_nr, nhits_total);
 }
 
 void EUDAQMonitorHistos::Fill(const unsigned int evt_number,
                               const unsigned int tracks) {
-  TracksPerEvent->Fill(evt_number, tracks);
+  ShardedFill::Fill(TracksPerEvent, evt_number, tracks);
 }
 
 void EUDAQMonitorHistos::Write() {
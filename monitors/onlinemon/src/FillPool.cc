@@ -0,0 +1,108 @@
+/*
+ * FillPool.cc
+ *
+ *  Threads analysing events and filling the histograms into per-thread
+ *  shards.
+ */
+
+#include "FillPool.hh"
+
+#include "eudaq/Exception.hh"
+#include "eudaq/Logger.hh"
+
+FillPool::FillPool(const Handler &handler, unsigned threads)
+    : _handler(handler), _busy(0), _lastevent(0), _stop(false) {
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  _maxqueue = 4 * threads;
+  for (unsigned i = 0; i < threads; ++i) {
+    _shards.push_back(new HistoShardSet);
+  }
+  for (unsigned i = 0; i < threads; ++i) {
+    _threads.push_back(std::thread(&FillPool::WorkerThread, this, _shards[i]));
+  }
+}
+
+FillPool::~FillPool() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cvwork.notify_all();
+  for (size_t i = 0; i < _threads.size(); ++i) {
+    _threads[i].join();
+  }
+  for (size_t i = 0; i < _shards.size(); ++i) {
+    delete _shards[i];
+  }
+}
+
+void FillPool::Add(std::shared_ptr<const eudaq::StandardEvent> ev) {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cvdone.wait(lock, [this] { return _queue.size() < _maxqueue; });
+  _queue.push_back(ev);
+  _cvwork.notify_one();
+}
+
+void FillPool::Drain() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cvdone.wait(lock, [this] { return _queue.empty() && _busy == 0; });
+}
+
+unsigned FillPool::getLastEventNumber() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _lastevent;
+}
+
+void FillPool::WorkerThread(HistoShardSet *shards) {
+  ShardedFill::setThreadShards(shards);
+  std::unique_lock<std::mutex> lock(_mutex);
+  for (;;) {
+    _cvwork.wait(lock, [this] { return _stop || !_queue.empty(); });
+    if (_queue.empty())
+      break;
+    std::shared_ptr<const eudaq::StandardEvent> ev = _queue.front();
+    _queue.pop_front();
+    ++_busy;
+    lock.unlock();
+    try {
+      std::lock_guard<std::mutex> fill(shards->getMutex());
+      _handler(*ev);
+    } catch (const std::exception &e) {
+      EUDAQ_ERROR(std::string("Error handling event in the online monitor: ") +
+                  e.what());
+    }
+    lock.lock();
+    --_busy;
+    if (ev->GetEventNumber() > _lastevent)
+      _lastevent = ev->GetEventNumber();
+    _cvdone.notify_all();
+  }
+  ShardedFill::setThreadShards(NULL);
+}
+
+FillPool::Pause::Pause(FillPool &pool) : _pool(pool) {
+  for (size_t i = 0; i < _pool._shards.size(); ++i) {
+    _pool._shards[i]->getMutex().lock();
+  }
+}
+
+FillPool::Pause::~Pause() {
+  for (size_t i = _pool._shards.size(); i > 0; --i) {
+    _pool._shards[i - 1]->getMutex().unlock();
+  }
+}
+
+void FillPool::Merge() {
+  for (size_t i = 0; i < _shards.size(); ++i) {
+    _shards[i]->Merge();
+  }
+}
+
+void FillPool::Clear() {
+  for (size_t i = 0; i < _shards.size(); ++i) {
+    _shards[i]->Clear();
+  }
+}
@@ -0,0 +1,214 @@
+/*
+ * HistoShard.cc
+ *
+ *  Per-thread copies of the histograms, for filling them from several
+ *  threads without touching the ROOT objects.
+ */
+
+#include "HistoShard.hh"
+
+#include <TArrayD.h>
+#include <TAxis.h>
+#include <TProfile.h>
+
+namespace {
+  thread_local HistoShardSet *threadShards = NULL;
+}
+
+HistoShard::HistoShard(TH1 *histo)
+    : _histo(histo), _is2D(histo->GetDimension() == 2), _binned(true),
+      _entries(0), _sumw(0), _sumwx(0), _sumwx2(0), _sumwy(0), _sumwy2(0),
+      _sumwxy(0) {
+  const TAxis *xaxis = histo->GetXaxis();
+  const TAxis *yaxis = histo->GetYaxis();
+  _x.nbins = xaxis->GetNbins();
+  _x.min = xaxis->GetXmin();
+  _x.max = xaxis->GetXmax();
+  _y.nbins = _is2D ? yaxis->GetNbins() : 0;
+  _y.min = yaxis->GetXmin();
+  _y.max = yaxis->GetXmax();
+#ifdef EUDAQ_LIB_ROOT6
+  bool canExtend = histo->CanExtendAllAxes();
+#else
+  bool canExtend = histo->TestBit(TH1::kCanRebin);
+#endif
+  if (canExtend || histo->GetDimension() > 2 ||
+      dynamic_cast<TProfile *>(histo) != NULL || xaxis->IsVariableBinSize() ||
+      (_is2D && yaxis->IsVariableBinSize())) {
+    _binned = false;
+  } else {
+    _bins.assign((_x.nbins + 2) * (_y.nbins + 2), 0);
+  }
+}
+
+void HistoShard::addBin(int bin) {
+  if (_bins[bin] == 0)
+    _touched.push_back(bin);
+  _bins[bin] += 1;
+  _entries += 1;
+}
+
+void HistoShard::Fill(double x, double w) {
+  if (!_binned || w != 1) {
+    _raw.push_back(x);
+    _raw.push_back(0);
+    _raw.push_back(w);
+    return;
+  }
+  int bin = _x.bin(x);
+  addBin(bin);
+  // like TH1::Fill, under- and overflows do not enter the statistics
+  if (bin > 0 && bin <= _x.nbins) {
+    _sumw += 1;
+    _sumwx += x;
+    _sumwx2 += x * x;
+  }
+}
+
+void HistoShard::Fill(double x, double y, double w) {
+  if (!_binned || w != 1) {
+    _raw.push_back(x);
+    _raw.push_back(y);
+    _raw.push_back(w);
+    return;
+  }
+  int binx = _x.bin(x), biny = _y.bin(y);
+  addBin(binx + (_x.nbins + 2) * biny);
+  if (binx > 0 && binx <= _x.nbins && biny > 0 && biny <= _y.nbins) {
+    _sumw += 1;
+    _sumwx += x;
+    _sumwx2 += x * x;
+    _sumwy += y;
+    _sumwy2 += y * y;
+    _sumwxy += x * y;
+  }
+}
+
+void HistoShard::Merge() {
+  if (!_touched.empty()) {
+    // the statistics have to be read before the bins change, as ROOT may
+    // recompute them from the bins; for a zoomed axis they only cover the
+    // visible range, so they are recomputed afterwards
+    bool zoomed = _histo->GetXaxis()->TestBit(TAxis::kAxisRange) ||
+                  _histo->GetYaxis()->TestBit(TAxis::kAxisRange);
+    Double_t stats[TH1::kNstat];
+    _histo->GetStats(stats);
+    double entries = _histo->GetEntries();
+    TArrayD *sumw2 = _histo->GetSumw2N() ? _histo->GetSumw2() : NULL;
+    for (size_t i = 0; i < _touched.size(); ++i) {
+      int bin = _touched[i];
+      _histo->AddBinContent(bin, _bins[bin]);
+      if (sumw2)
+        (*sumw2)[bin] += _bins[bin];
+    }
+    stats[0] += _sumw;
+    stats[1] += _sumw;
+    stats[2] += _sumwx;
+    stats[3] += _sumwx2;
+    if (_is2D) {
+      stats[4] += _sumwy;
+      stats[5] += _sumwy2;
+      stats[6] += _sumwxy;
+    }
+    if (zoomed)
+      _histo->ResetStats();
+    else
+      _histo->PutStats(stats);
+    _histo->SetEntries(entries + _entries);
+  }
+  for (size_t i = 0; i < _raw.size(); i += 3) {
+    if (_is2D)
+      static_cast<TH2 *>(_histo)->Fill(_raw[i], _raw[i + 1], _raw[i + 2]);
+    else
+      _histo->Fill(_raw[i], _raw[i + 2]);
+  }
+  Clear();
+}
+
+void HistoShard::Clear() {
+  for (size_t i = 0; i < _touched.size(); ++i) {
+    _bins[_touched[i]] = 0;
+  }
+  _touched.clear();
+  _raw.clear();
+  _entries = _sumw = _sumwx = _sumwx2 = _sumwy = _sumwy2 = _sumwxy = 0;
+}
+
+HistoShardSet::~HistoShardSet() {
+  std::map<TH1 *, HistoShard *>::iterator it;
+  for (it = _shards.begin(); it != _shards.end(); ++it) {
+    delete it->second;
+  }
+}
+
+HistoShard &HistoShardSet::getShard(TH1 *histo) {
+  HistoShard *&shard = _shards[histo];
+  if (shard == NULL)
+    shard = new HistoShard(histo);
+  return *shard;
+}
+
+void HistoShardSet::Merge() {
+  std::map<TH1 *, HistoShard *>::iterator it;
+  for (it = _shards.begin(); it != _shards.end(); ++it) {
+    it->second->Merge();
+  }
+  std::map<int *, int>::iterator count;
+  for (count = _counts.begin(); count != _counts.end(); ++count) {
+    *count->first += count->second;
+  }
+  _counts.clear();
+  std::map<HitCounter *, std::vector<unsigned int> >::iterator hits;
+  for (hits = _hits.begin(); hits != _hits.end(); ++hits) {
+    for (size_t i = 0; i < hits->second.size(); ++i) {
+      hits->first->add(hits->second[i]);
+    }
+  }
+  _hits.clear();
+}
+
+void HistoShardSet::Clear() {
+  std::map<TH1 *, HistoShard *>::iterator it;
+  for (it = _shards.begin(); it != _shards.end(); ++it) {
+    delete it->second;
+  }
+  _shards.clear();
+  _counts.clear();
+  _hits.clear();
+}
+
+void ShardedFill::Fill(TH1 *histo, double x, double w) {
+  if (threadShards == NULL) {
+    histo->Fill(x, w);
+  } else {
+    threadShards->getShard(histo).Fill(x, w);
+  }
+}
+
+void ShardedFill::Fill(TH2 *histo, double x, double y) {
+  if (threadShards == NULL) {
+    histo->Fill(x, y);
+  } else {
+    threadShards->getShard(histo).Fill(x, y, 1);
+  }
+}
+
+void ShardedFill::Count(int &counter, int n) {
+  if (threadShards == NULL) {
+    counter += n;
+  } else {
+    threadShards->addCount(counter, n);
+  }
+}
+
+void ShardedFill::Count(HitCounter &counter, unsigned int cell) {
+  if (threadShards == NULL) {
+    counter.add(cell);
+  } else {
+    threadShards->addHit(counter, cell);
+  }
+}
+
+void ShardedFill::setThreadShards(HistoShardSet *shards) {
+  threadShards = shards;
+}
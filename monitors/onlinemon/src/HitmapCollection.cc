@@ -8,9 +8,6 @@
 #include "HitmapCollection.hh"
 #include "OnlineMon.hh"
 
-static int counting = 0;
-static int events = 0;
-
 bool HitmapCollection::isPlaneRegistered(SimpleStandardPlane p) {
   std::map<SimpleStandardPlane, HitmapHistos *>::iterator it;
   it = _map.find(p);
@@ -32,16 +29,14 @@ void HitmapCollection::fillHistograms(const SimpleStandardPlane &simpPlane) {
     isOnePlaneRegistered = true;
   }
 
-  HitmapHistos *hitmap = _map[simpPlane];
+  // the planes may be filled from several threads, so only look them up
+  std::map<SimpleStandardPlane, HitmapHistos *>::const_iterator it =
+      _map.find(simpPlane);
+  if (it == _map.end() || it->second == NULL)
+    return;
+  HitmapHistos *hitmap = it->second;
   hitmap->Fill(simpPlane);
 
-  ++counting;
-  events += simpPlane.getNHits();
-
-  //    if(counting == 60000)
-  //        std::cout << "Final AVG: " << std::scientific << (double)events /
-  //        (double)10000 << std::endl;
-
   for (int hitpix = 0; hitpix < simpPlane.getNHits(); hitpix++) {
     const SimpleStandardHit &onehit = simpPlane.getHit(hitpix);
 
@@ -141,7 +136,10 @@ void HitmapCollection::Fill(const SimpleStandardEvent &simpev) {
 }
 HitmapHistos *HitmapCollection::getHitmapHistos(std::string sensor, int id) {
   SimpleStandardPlane sp(sensor, id);
-  return _map[sp];
+  // only look up the histograms, the map is shared by the fill threads
+  std::map<SimpleStandardPlane, HitmapHistos *>::const_iterator it =
+      _map.find(sp);
+  return it == _map.end() ? NULL : it->second;
 }
 
 void HitmapCollection::registerPlane(const SimpleStandardPlane &p) {
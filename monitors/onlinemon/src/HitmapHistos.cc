@@ -7,6 +7,7 @@
 
 #include "HitmapHistos.hh"
 #include "OnlineMon.hh"
+#include "HistoShard.hh"
 #include <cstdlib>
 
 HitmapHistos::HitmapHistos(SimpleStandardPlane p, RootMonitor *mon)
@@ -104,7 +105,7 @@ HitmapHistos::HitmapHistos(SimpleStandardPlane p, RootMonitor *mon)
     sprintf(out, "%s %i Hitoccupancy", _sensor.c_str(), _id);
     sprintf(out2, "h_hitocc%s_%i", _sensor.c_str(), _id);
 
-    _hitOcc = new TH1F(out2, out, 250, 0.01, 1);
+    _hitOcc = new TH1F(out2, out, 1000, 0, 1);
     SetHistoAxisLabelx(_hitOcc, "Frequency");
 
     sprintf(out, "%s %i Clustersize", _sensor.c_str(), _id);
@@ -207,31 +208,21 @@ HitmapHistos::HitmapHistos(SimpleStandardPlane p, RootMonitor *mon)
       }
     }
     // make a plane array for calculating e..g hotpixels and occupancy
-
-    plane_map_array = new int *[_maxX];
-    if (plane_map_array != NULL) {
-      for (int j = 0; j < _maxX; j++) {
-        plane_map_array[j] = new int[_maxY];
-        if (plane_map_array[j] == NULL) {
-          cout << "HitmapHistos :Error in memory allocation" << endl;
-          exit(-1);
-        }
-      }
-      zero_plane_array();
-    }
+    _pixelHits.resize(_maxX * _maxY);
+    _isHotPixel.assign(_maxX * _maxY, false);
 
   } else {
     std::cout << "No max sensorsize known!" << std::endl;
   }
 }
 
-int HitmapHistos::zero_plane_array() {
-  for (int i = 0; i < _maxX; i++) {
-    for (int j = 0; j < _maxY; j++) {
-      plane_map_array[i][j] = 0;
-    }
+void HitmapHistos::clearPixelHits() {
+  _pixelHits.clear();
+  _pixelsWithHits.clear();
+  for (unsigned int i = 0; i < _hotPixels.size(); ++i) {
+    _isHotPixel[_hotPixels[i]] = false;
   }
-  return 0;
+  _hotPixels.clear();
 }
 
 void HitmapHistos::Fill(const SimpleStandardHit &hit) {
@@ -244,21 +235,24 @@ void HitmapHistos::Fill(const SimpleStandardHit &hit) {
     pixelIsHot = true;
 
   if (_hitmap != NULL && !pixelIsHot)
-    _hitmap->Fill(pixel_x, pixel_y);
+    ShardedFill::Fill(_hitmap, pixel_x, pixel_y);
   if (_hitXmap != NULL && !pixelIsHot)
-    _hitXmap->Fill(pixel_x);
+    ShardedFill::Fill(_hitXmap, pixel_x);
   if (_hitYmap != NULL && !pixelIsHot)
-    _hitYmap->Fill(pixel_y);
+    ShardedFill::Fill(_hitYmap, pixel_y);
   if ((is_MIMOSA26) && (_hitmapSections != NULL) && (!pixelIsHot))
   //&& _hitOcc->GetEntries()>0) // only fill histogram when occupancies and
   //hotpixels have been determined
   {
-    char sectionid[3];
-    sprintf(sectionid, "%i%c", _id,
-            (pixel_x / _mon->mon_configdata.getMimosa26_section_boundary()) +
-                65); // determine section label
-    _hitmapSections->Fill(sectionid,
-                          1); // add one hit to the corresponding section bin
+    // the bins are labelled with the sections, so fill the centre of the bin
+    // of this section
+    unsigned int section =
+        pixel_x / _mon->mon_configdata.getMimosa26_section_boundary();
+    if (section < mimosa26_max_section) {
+      ShardedFill::Fill(
+          _hitmapSections,
+          _hitmapSections->GetXaxis()->GetBinCenter(section + 1));
+    }
     // tab[pixel_x/_mon->mon_configdata.getMimosa26_section_boundary()]++;
   }
   /*else
@@ -278,44 +272,46 @@ void HitmapHistos::Fill(const SimpleStandardHit &hit) {
     }*/
 
   if ((pixel_x < _maxX) && (pixel_y < _maxY)) {
-    plane_map_array[pixel_x][pixel_y] = plane_map_array[pixel_x][pixel_y] + 1;
+    ShardedFill::Count(_pixelHits, pixel_x * _maxY + pixel_y);
   }
   // if (_sensor == std::string("APIX")) {
   // if (_sensor == std::string("APIX") || _sensor == std::string("USBPIX") ||
   // _sensor == std::string("USBPIXI4") ) {
   if ((is_APIX) || (is_USBPIX) || (is_USBPIXI4) || is_DEPFET) {
     if (_totSingle != NULL)
-      _totSingle->Fill(hit.getTOT());
+      ShardedFill::Fill(_totSingle, hit.getTOT());
     if (_lvl1Distr != NULL)
-      _lvl1Distr->Fill(hit.getLVL1());
+      ShardedFill::Fill(_lvl1Distr, hit.getLVL1());
   }
 }
 
 void HitmapHistos::Fill(const SimpleStandardPlane &plane) {
   // std::cout<< "FILL with a plane." << std::endl;
   if (_nHits != NULL)
-    _nHits->Fill(plane.getNHits());
+    ShardedFill::Fill(_nHits, plane.getNHits());
   if ((_nbadHits != NULL) && (plane.getNBadHits() > 0)) {
-    _nbadHits->Fill(plane.getNBadHits());
+    ShardedFill::Fill(_nbadHits, plane.getNBadHits());
   }
   if (_nClusters != NULL)
-    _nClusters->Fill(plane.getNClusters());
+    ShardedFill::Fill(_nClusters, plane.getNClusters());
 
   // we fill the information for the individual mimosa sections, and do a
   // zero-suppression,in case not all sections have hits/clusters
   if (is_MIMOSA26) {
-    _nPivotPixel->Fill(plane.getPivotPixel());
+    ShardedFill::Fill(_nPivotPixel, plane.getPivotPixel());
     for (unsigned int section = 0; section < mimosa26_max_section; section++) {
       if (_nHits_section[section] != NULL) {
         if (plane.getNSectionHits(section) > 0) {
-          _nHits_section[section]->Fill(plane.getNSectionHits(section));
+          ShardedFill::Fill(_nHits_section[section],
+                            plane.getNSectionHits(section));
           // std::cout<< "Section " << section << " filling with " <<
           // plane.getNSectionHits(section) << std::endl;
         }
       }
       if (_nClusters_section[section] != NULL) {
         if (plane.getNSectionClusters(section) > 0) {
-          _nClusters_section[section]->Fill(plane.getNSectionClusters(section));
+          ShardedFill::Fill(_nClusters_section[section],
+                            plane.getNSectionClusters(section));
         }
       }
     }
@@ -324,9 +320,9 @@ void HitmapHistos::Fill(const SimpleStandardPlane &plane) {
 
 void HitmapHistos::Fill(const SimpleStandardCluster &cluster) {
   if (_clusterMap != NULL)
-    _clusterMap->Fill(cluster.getX(), cluster.getY());
+    ShardedFill::Fill(_clusterMap, cluster.getX(), cluster.getY());
   if (_clusterSize != NULL)
-    _clusterSize->Fill(cluster.getNPixel());
+    ShardedFill::Fill(_clusterSize, cluster.getNPixel());
   if (is_MIMOSA26) {
     unsigned int nsection =
         cluster.getX() /
@@ -338,22 +334,23 @@ void HitmapHistos::Fill(const SimpleStandardCluster &cluster) {
         (_nClustersize_section[nsection] != NULL)) // check if valid address
     {
       if (cluster.getNPixel() > 0) {
-        _nClustersize_section[nsection]->Fill(cluster.getNPixel());
+        ShardedFill::Fill(_nClustersize_section[nsection],
+                          cluster.getNPixel());
       }
     }
   }
 
   if ((is_APIX) || (is_USBPIX) || (is_USBPIXI4)) {
     if (_lvl1Width != NULL)
-      _lvl1Width->Fill(cluster.getLVL1Width());
+      ShardedFill::Fill(_lvl1Width, cluster.getLVL1Width());
     if (_totCluster != NULL)
-      _totCluster->Fill(cluster.getTOT());
+      ShardedFill::Fill(_totCluster, cluster.getTOT());
     if (_lvl1Cluster != NULL)
-      _lvl1Cluster->Fill(cluster.getFirstLVL1());
+      ShardedFill::Fill(_lvl1Cluster, cluster.getFirstLVL1());
     if (_clusterXWidth != NULL)
-      _clusterXWidth->Fill(cluster.getWidthX());
+      ShardedFill::Fill(_clusterXWidth, cluster.getWidthX());
     if (_clusterYWidth != NULL)
-      _clusterYWidth->Fill(cluster.getWidthY());
+      ShardedFill::Fill(_clusterYWidth, cluster.getWidthY());
   }
 }
 
@@ -385,60 +382,85 @@ void HitmapHistos::Reset() {
     _nHotPixels_section[section]->Reset();
   }
   // we have to reset the aux array as well
-  zero_plane_array();
+  clearPixelHits();
 }
 
 void HitmapHistos::Calculate(const int currentEventNum) {
   _wait = true;
-  _hitOcc->SetBins(currentEventNum / 10, 0, 1);
+  if (currentEventNum <= 0) {
+    _wait = false;
+    return;
+  }
+
+  // only the pixels hit since the last time change their number of hits
+  const std::vector<HitCounter::Change> &changes = _pixelHits.getChanges();
+  for (unsigned int i = 0; i < changes.size(); ++i) {
+    if (changes[i].before != 0 && --_pixelsWithHits[changes[i].before] == 0)
+      _pixelsWithHits.erase(changes[i].before);
+    ++_pixelsWithHits[_pixelHits[changes[i].cell]];
+  }
+
+  // FIXME it's not occupancy, it's frequency
   _hitOcc->Reset();
+  int nHitPixels = 0;
+  std::map<int, int>::const_iterator hits;
+  for (hits = _pixelsWithHits.begin(); hits != _pixelsWithHits.end(); ++hits) {
+    _hitOcc->Fill(hits->first / (double)currentEventNum, hits->second);
+    nHitPixels += hits->second;
+  }
+  _hitOcc->SetEntries(nHitPixels);
 
-  int nHotpixels = 0;
-  std::vector<unsigned int> nHotpixels_section;
+  // only count as hotpixel if occupancy larger than minimal occupancy for a
+  // single hit. As the number of events only grows, a pixel that was not hot
+  // and got no hits since can't have become hot, so only the hot pixels and
+  // the pixels with new hits are checked
   double Hotpixelcut = _mon->mon_configdata.getHotpixelcut();
-  double bin = 0;
-  double occupancy = 0;
-  if (is_MIMOSA26) // probalbly initialize vector
-  {
-    nHotpixels_section.reserve(_mon->mon_configdata.getMimosa26_max_sections());
-    for (unsigned int i = 0;
-         i < _mon->mon_configdata.getMimosa26_max_sections(); i++) {
-      nHotpixels_section[i] = 0;
+  bool findHotpixels = (1. / (double)currentEventNum) < Hotpixelcut;
+  std::vector<unsigned int> hotPixels;
+  for (unsigned int i = 0; i < _hotPixels.size(); ++i) {
+    unsigned int cell = _hotPixels[i];
+    if (findHotpixels &&
+        _pixelHits[cell] / (double)currentEventNum > Hotpixelcut) {
+      hotPixels.push_back(cell);
+    } else {
+      _isHotPixel[cell] = false;
     }
   }
-
-  for (int x = 0; x < _maxX; ++x) {
-    for (int y = 0; y < _maxY; ++y) {
-
-      bin = plane_map_array[x][y];
-
-      if (bin != 0) {
-        occupancy =
-            bin /
-            (double)currentEventNum; // FIXME it's not occupancy, it's frequency
-        _hitOcc->Fill(occupancy);
-        // only count as hotpixel if occupancy larger than minimal occupancy for
-        // a single hit
-        if (occupancy > Hotpixelcut && ((1. / (double)(currentEventNum)) <
-                                        _mon->mon_configdata.getHotpixelcut()))
-        // if (occupancy>Hotpixelcut && )
-        {
-          nHotpixels++;
-          _HotPixelMap->SetBinContent(x + 1, y + 1,
-                                      occupancy); // ROOT start from 1
-          if (is_MIMOSA26) {
-            nHotpixels_section
-                [x / _mon->mon_configdata.getMimosa26_section_boundary()]++;
-          }
-        }
+  if (findHotpixels) {
+    for (unsigned int i = 0; i < changes.size(); ++i) {
+      unsigned int cell = changes[i].cell;
+      if (!_isHotPixel[cell] &&
+          _pixelHits[cell] / (double)currentEventNum > Hotpixelcut) {
+        _isHotPixel[cell] = true;
+        hotPixels.push_back(cell);
       }
     }
   }
+  _hotPixels.swap(hotPixels);
+  _pixelHits.clearChanges();
+
+  int nHotpixels = _hotPixels.size();
+  std::vector<unsigned int> nHotpixels_section;
+  if (is_MIMOSA26) {
+    nHotpixels_section.assign(mimosa26_max_section, 0);
+  }
+  for (unsigned int i = 0; i < _hotPixels.size(); ++i) {
+    int x = _hotPixels[i] / _maxY;
+    int y = _hotPixels[i] % _maxY;
+    _HotPixelMap->SetBinContent(x + 1, y + 1,
+                                _pixelHits[_hotPixels[i]] /
+                                    (double)currentEventNum); // ROOT start from 1
+    if (is_MIMOSA26) {
+      unsigned int section =
+          x / _mon->mon_configdata.getMimosa26_section_boundary();
+      if (section < mimosa26_max_section)
+        nHotpixels_section[section]++;
+    }
+  }
   if (nHotpixels > 0) {
     _nHotPixels->Fill(nHotpixels);
     if (is_MIMOSA26) {
-      for (unsigned int section = 0;
-           section < _mon->mon_configdata.getMimosa26_max_sections();
+      for (unsigned int section = 0; section < mimosa26_max_section;
            section++) {
         if ((nHotpixels_section[section] > 0)) {
           _nHotPixels_section[section]->Fill(nHotpixels_section[section]);
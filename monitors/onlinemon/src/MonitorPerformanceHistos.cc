@@ -6,6 +6,7 @@
  */
 
 #include "MonitorPerformanceHistos.hh"
+#include "HistoShard.hh"
 
 #include <iostream>
 
@@ -37,10 +38,10 @@ void MonitorPerformanceHistos::Write() {
 }
 
 void MonitorPerformanceHistos::Fill(SimpleStandardEvent ev) {
-  _AnalysisTimeHisto->Fill(ev.getMonitor_eventanalysistime());
-  _FillTimeHisto->Fill(ev.getMonitor_eventfilltime());
-  _ClusteringTimeHisto->Fill(ev.getMonitor_clusteringtime());
-  _CorrelationTimeHisto->Fill(ev.getMonitor_correlationtime());
+  ShardedFill::Fill(_AnalysisTimeHisto, ev.getMonitor_eventanalysistime());
+  ShardedFill::Fill(_FillTimeHisto, ev.getMonitor_eventfilltime());
+  ShardedFill::Fill(_ClusteringTimeHisto, ev.getMonitor_clusteringtime());
+  ShardedFill::Fill(_CorrelationTimeHisto, ev.getMonitor_correlationtime());
 }
 
 void MonitorPerformanceHistos::Reset() {
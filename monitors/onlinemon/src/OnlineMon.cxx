@@ -40,13 +40,15 @@
 
 //ONLINE MONITOR Includes
 #include "OnlineMon.hh"
+#include "FillPool.hh"
 
 using namespace std;
 
 RootMonitor::RootMonitor(const std::string & runcontrol, const std::string & datafile, int /*x*/, int /*y*/, int /*w*/,
 			 int /*h*/, int argc, int offline, const unsigned lim, const unsigned skip_, const unsigned int skip_with_counter,
-			 const std::string & conffile)
-  : eudaq::Holder<int>(argc), eudaq::Monitor("OnlineMon", runcontrol, lim, skip_, skip_with_counter, datafile), _offline(offline), _planesInitialized(false) {
+			 const std::string & conffile, unsigned threads, unsigned fillthreads, const std::string & sharedmemory)
+  : eudaq::Holder<int>(argc), eudaq::Monitor("OnlineMon", runcontrol, lim, skip_, skip_with_counter, datafile, threads, sharedmemory), _offline(offline), _planesInitialized(false),
+    _fillPool(NULL), _calculatedEvents(0) {
 
   if (_offline <= 0)
   {
@@ -144,10 +146,14 @@ RootMonitor::RootMonitor(const std::string & runcontrol, const std::string & dat
 
   //set a few defaults
   snapshotdir=mon_configdata.getSnapShotDir();
-  previous_event_analysis_time=0;
-  previous_event_fill_time=0;
-  previous_event_clustering_time=0;
-  previous_event_correlation_time=0;
+
+  if (fillthreads != 1)
+  {
+    _fillPool = new FillPool([this](const eudaq::StandardEvent & ev) {
+        AnalyseEvent(ev, fillThreadTimes);
+      }, fillthreads);
+    cout << "Filling histograms with " << _fillPool->getNThreads() << " threads" << endl;
+  }
 
   onlinemon->SetOnlineMon(this);    
 
@@ -163,6 +169,23 @@ void RootMonitor::setReduce(const unsigned int red) {
   }
 }
 
+RootMonitor::~RootMonitor() {
+  delete _fillPool;
+  gApplication->Terminate();
+}
+
+// the name under which the histograms of a plane are booked
+static string getSensorName(const eudaq::StandardPlane & plane) {
+  if ((plane.Type() == std::string("DEPFET")) &&(plane.Sensor().length()==0)) // FIXME ugly hack for the DEPFET
+  {
+    return plane.Type();
+  }
+  return plane.Sensor();
+}
+
+// the processing times of the fill threads
+static thread_local MonitorTimes fillThreadTimes;
+
 void RootMonitor::OnEvent(const eudaq::StandardEvent & ev) {
 #ifdef DEBUG
   cout << "Called onEvent " << ev.GetEventNumber()<< endl;
@@ -172,9 +195,6 @@ void RootMonitor::OnEvent(const eudaq::StandardEvent & ev) {
 
   //    cout << "Called onEvent " << ev.GetEventNumber()<< endl;
 
-  //start timing to measure processing time
-  my_event_processing_time.Start(true);
-
   bool reduce=false; //do we use Event reduction
   bool skip_dodgy_event=false; // do we skip this event because we consider it dodgy
 
@@ -182,6 +202,11 @@ void RootMonitor::OnEvent(const eudaq::StandardEvent & ev) {
   {
     if (_offline <(int)  ev.GetEventNumber())
     {
+      if (_fillPool != NULL)
+      {
+        _fillPool->Drain();
+        MergeHistograms();
+      }
       TFile *f = new TFile(rootfilename.c_str(),"RECREATE");
       if (f!=NULL)
       {
@@ -232,179 +257,254 @@ void RootMonitor::OnEvent(const eudaq::StandardEvent & ev) {
       }
     }
 
-    SimpleStandardEvent simpEv;
     if ((ev.GetEventNumber() == 1) && (_offline <0)) //only update Display, when GUI is active
     {
       onlinemon->UpdateStatus("Getting data..");
     }
-    // store the processing time of the previous EVENT, as we can't track this during the  processing
-    simpEv.setMonitor_eventanalysistime(previous_event_analysis_time);
-    simpEv.setMonitor_eventfilltime(previous_event_fill_time);
-    simpEv.setMonitor_eventclusteringtime(previous_event_clustering_time);
-    simpEv.setMonitor_eventcorrelationtime(previous_event_correlation_time);
-    // add some info into the simple event header
-    simpEv.setEvent_number(ev.GetEventNumber());
-    simpEv.setEvent_timestamp(ev.GetTimestamp());
 
     if (skip_dodgy_event)
     {
       return; //don't process any further
     }
 
-    for (unsigned int i = 0; i < num;i++)
+    // Events whose planes all have their histograms booked go to the fill
+    // threads, the others (at least the first one) are handled here, as the
+    // booking changes the collections and the GUI.
+    bool booked = _planesInitialized;
+    for (unsigned int i = 0; booked && i < num; i++)
     {
       const eudaq::StandardPlane & plane = ev.GetPlane(i);
-
-#ifdef DEBUG
-      cout << "Plane ID         " << plane.ID()<<endl;
-      cout << "Plane Size       " << sizeof(plane) <<endl;
-      cout << "Plane Frames     " << plane.NumFrames() <<endl;
-      for (unsigned int nframes=0; nframes<plane.NumFrames(); nframes++)
+      if (strcmp(plane.Sensor().c_str(), "FORTIS") != 0 &&
+          _bookedPlanes.find(make_pair(getSensorName(plane), (int)plane.ID())) == _bookedPlanes.end())
       {
-        cout << "Plane Pixels Hit Frame " << nframes <<" "<<plane.HitPixels(0) <<endl;
+        booked = false;
       }
-      cout << i << " "<<plane.TLUEvent() << " "<< plane.PivotPixel() <<endl;
-#endif
-
+    }
 
-      string sensorname;
-      if ((plane.Type() == std::string("DEPFET")) &&(plane.Sensor().length()==0)) // FIXME ugly hack for the DEPFET
-      {
-        sensorname=plane.Type();
-      }
-      else
+    if (_fillPool != NULL && booked)
+    {
+      _fillPool->Add(std::make_shared<eudaq::StandardEvent>(ev));
+    }
+    else
+    {
+      std::unique_ptr<FillPool::Pause> pause;
+      if (_fillPool != NULL)
       {
-        sensorname=plane.Sensor();
-
+        _fillPool->Drain();
+        pause.reset(new FillPool::Pause(*_fillPool));
+        // booking may replace histograms of the same name, so the shards
+        // must not keep pointers to them
+        _fillPool->Merge();
+        _fillPool->Clear();
       }
-      // DEAL with Fortis ...
-      if (strcmp(plane.Sensor().c_str(), "FORTIS") == 0 )
+      AnalyseEvent(ev, _times);
+      for (unsigned int i = 0; i < num; i++)
       {
-        continue;
+        const eudaq::StandardPlane & plane = ev.GetPlane(i);
+        _bookedPlanes.insert(make_pair(getSensorName(plane), (int)plane.ID()));
       }
-      SimpleStandardPlane simpPlane(sensorname,plane.ID(),plane.XSize(),plane.YSize(), plane.TLUEvent(),plane.PivotPixel(),&mon_configdata);
+    }
 
-      for (unsigned int lvl1 = 0; lvl1 < plane.NumFrames(); lvl1++)
-      {
-        // if (lvl1 > 2 && plane.HitPixels(lvl1) > 0) std::cout << "LVLHits: " << lvl1 << ": " << plane.HitPixels(lvl1) << std::endl;
+    if (_offline <= 0)
+    {
+      onlinemon->setEventNumber(ev.GetEventNumber());
+      onlinemon->increaseAnalysedEventsCounter();
+    }
+  } // end of reduce if
 
-        for (unsigned int index = 0; index < plane.HitPixels(lvl1);index++)
-        {
-          SimpleStandardHit hit((int)plane.GetX(index,lvl1),(int)plane.GetY(index,lvl1));
-          hit.setTOT((int)plane.GetPixel(index,lvl1)); //this stores the analog information if existent, else it stores 1
-          hit.setLVL1(lvl1);
+  if (ev.IsBORE())
+  {
+    std::cout << "This is a BORE" << std::endl;
+  }
 
+}
+
+void RootMonitor::AnalyseEvent(const eudaq::StandardEvent & ev, MonitorTimes & times) {
+  //start timing to measure processing time
+  times.processing.Start(true);
+
+  unsigned int num = (unsigned int) ev.NumPlanes();
+  SimpleStandardEvent simpEv;
+  // store the processing time of the previous EVENT, as we can't track this during the  processing
+  simpEv.setMonitor_eventanalysistime(times.analysis);
+  simpEv.setMonitor_eventfilltime(times.fill);
+  simpEv.setMonitor_eventclusteringtime(times.clustering);
+  simpEv.setMonitor_eventcorrelationtime(times.correlation);
+  // add some info into the simple event header
+  simpEv.setEvent_number(ev.GetEventNumber());
+  simpEv.setEvent_timestamp(ev.GetTimestamp());
+
+  for (unsigned int i = 0; i < num;i++)
+  {
+    const eudaq::StandardPlane & plane = ev.GetPlane(i);
+
+#ifdef DEBUG
+    cout << "Plane ID         " << plane.ID()<<endl;
+    cout << "Plane Size       " << sizeof(plane) <<endl;
+    cout << "Plane Frames     " << plane.NumFrames() <<endl;
+    for (unsigned int nframes=0; nframes<plane.NumFrames(); nframes++)
+    {
+      cout << "Plane Pixels Hit Frame " << nframes <<" "<<plane.HitPixels(0) <<endl;
+    }
+    cout << i << " "<<plane.TLUEvent() << " "<< plane.PivotPixel() <<endl;
+#endif
 
 
-          if (simpPlane.getAnalogPixelType()) //this is analog pixel, apply threshold
+    string sensorname = getSensorName(plane);
+    // DEAL with Fortis ...
+    if (strcmp(plane.Sensor().c_str(), "FORTIS") == 0 )
+    {
+      continue;
+    }
+    SimpleStandardPlane simpPlane(sensorname,plane.ID(),plane.XSize(),plane.YSize(), plane.TLUEvent(),plane.PivotPixel(),&mon_configdata);
+
+    for (unsigned int lvl1 = 0; lvl1 < plane.NumFrames(); lvl1++)
+    {
+      // if (lvl1 > 2 && plane.HitPixels(lvl1) > 0) std::cout << "LVLHits: " << lvl1 << ": " << plane.HitPixels(lvl1) << std::endl;
+
+      for (unsigned int index = 0; index < plane.HitPixels(lvl1);index++)
+      {
+        SimpleStandardHit hit((int)plane.GetX(index,lvl1),(int)plane.GetY(index,lvl1));
+        hit.setTOT((int)plane.GetPixel(index,lvl1)); //this stores the analog information if existent, else it stores 1
+        hit.setLVL1(lvl1);
+
+
+
+        if (simpPlane.getAnalogPixelType()) //this is analog pixel, apply threshold
+        {
+          if (simpPlane.is_DEPFET)
           {
-            if (simpPlane.is_DEPFET)
+            if ((hit.getTOT()< -20) || (hit.getTOT()>120))
             {
-              if ((hit.getTOT()< -20) || (hit.getTOT()>120))
-              {
-                continue;
-              }
+              continue;
             }
-	    if (simpPlane.is_EXPLORER)
-	    {
-	      if (lvl1!=0) continue;
-	      hit.setTOT((int)plane.GetPixel(index));
-	      //if (hit.getTOT() < -20 || hit.getTOT() > 20) {
-		//std::cout << hit.getTOT() << std::endl;
-	      //}
-	      if (hit.getTOT() < 20)
-	      {
-		continue;
-	      }
-	    }
-            simpPlane.addHit(hit);
           }
-          else //purely digital pixel
+          if (simpPlane.is_EXPLORER)
           {
-            simpPlane.addHit(hit);
+            if (lvl1!=0) continue;
+            hit.setTOT((int)plane.GetPixel(index));
+            //if (hit.getTOT() < -20 || hit.getTOT() > 20) {
+              //std::cout << hit.getTOT() << std::endl;
+            //}
+            if (hit.getTOT() < 20)
+            {
+              continue;
+            }
           }
-
+          simpPlane.addHit(hit);
         }
+        else //purely digital pixel
+        {
+          simpPlane.addHit(hit);
+        }
+
       }
-      simpEv.addPlane(simpPlane);
+    }
+    simpEv.addPlane(simpPlane);
 #ifdef DEBUG
-      cout << "Type: " << plane.Type() << endl;
-      cout << "StandardPlane: "<< plane.Sensor() <<  " " << plane.ID() << " " << plane.XSize() << " " << plane.YSize() << endl;
-      cout << "PlaneAddress: " << &plane << endl;
+    cout << "Type: " << plane.Type() << endl;
+    cout << "StandardPlane: "<< plane.Sensor() <<  " " << plane.ID() << " " << plane.XSize() << " " << plane.YSize() << endl;
+    cout << "PlaneAddress: " << &plane << endl;
 #endif
 
-    }
+  }
 
-    my_event_inner_operations_time.Start(true);
-    simpEv.doClustering();
-    my_event_inner_operations_time.Stop();
-    previous_event_clustering_time = my_event_inner_operations_time.RealTime();
+  times.inner.Start(true);
+  simpEv.doClustering();
+  times.inner.Stop();
+  times.clustering = times.inner.RealTime();
 
-    if(!_planesInitialized)
-    {
+  // only the monitor thread gets here before the planes are initialized
+  if(!_planesInitialized)
+  {
 #ifdef DEBUG
-      cout << "Waiting for booking of Histograms..." << endl;
+    cout << "Waiting for booking of Histograms..." << endl;
 #endif
-      EUDAQ_SLEEP(1);
+    EUDAQ_SLEEP(1);
 #ifdef DEBUG
-      cout << "...long enough"<< endl;
+    cout << "...long enough"<< endl;
 #endif
-      _planesInitialized = true;
-    }
+    _planesInitialized = true;
+  }
 
-    //stop the Stop watch
-    my_event_processing_time.Stop();
+  //stop the Stop watch
+  times.processing.Stop();
 #ifdef DEBUG
-    cout << "Analysing"<<   " "<< my_event_processing_time.RealTime()<<endl;
+  cout << "Analysing"<<   " "<< times.processing.RealTime()<<endl;
 #endif
-    previous_event_analysis_time=my_event_processing_time.RealTime();
-    //Filling
-    my_event_processing_time.Start(true); //start the stopwatch again
-    for (unsigned int i = 0 ; i < _colls.size(); ++i)
+  times.analysis=times.processing.RealTime();
+  //Filling
+  times.processing.Start(true); //start the stopwatch again
+  for (unsigned int i = 0 ; i < _colls.size(); ++i)
+  {
+    if (_colls.at(i) == corrCollection)
     {
-      if (_colls.at(i) == corrCollection)
+      times.inner.Start(true);
+      if (getUseTrack_corr() == true)
       {
-        my_event_inner_operations_time.Start(true);
-        if (getUseTrack_corr() == true)
-        {
-          tracksPerEvent = corrCollection->FillWithTracks(simpEv);
-          if (eudaqCollection->getEUDAQMonitorHistos() != NULL) //workaround because Correlation Collection is before EUDAQ Mon collection
-            eudaqCollection->getEUDAQMonitorHistos()->Fill(simpEv.getEvent_number(), tracksPerEvent);
+        unsigned int tracks = corrCollection->FillWithTracks(simpEv);
+        if (eudaqCollection->getEUDAQMonitorHistos() != NULL) //workaround because Correlation Collection is before EUDAQ Mon collection
+          eudaqCollection->getEUDAQMonitorHistos()->Fill(simpEv.getEvent_number(), tracks);
 
-        }
-        else
-          _colls.at(i)->Fill(simpEv);
-        my_event_inner_operations_time.Stop();
-        previous_event_correlation_time = my_event_inner_operations_time.RealTime();
       }
       else
         _colls.at(i)->Fill(simpEv);
-
-      // CollType is used to check which kind of Collection we are having
-      if (_colls.at(i)->getCollectionType()==HITMAP_COLLECTION_TYPE) // Calculate is only implemented for HitMapCollections
-      {
-        _colls.at(i)->Calculate(ev.GetEventNumber());
-      }
+      times.inner.Stop();
+      times.correlation = times.inner.RealTime();
     }
+    else
+      _colls.at(i)->Fill(simpEv);
 
-    if (_offline <= 0)
+    // CollType is used to check which kind of Collection we are having
+    // With fill threads this is done on the merged histograms (see MergeHistograms)
+    if (_fillPool == NULL && _colls.at(i)->getCollectionType()==HITMAP_COLLECTION_TYPE) // Calculate is only implemented for HitMapCollections
     {
-      onlinemon->setEventNumber(ev.GetEventNumber());
-      onlinemon->increaseAnalysedEventsCounter();
+      _colls.at(i)->Calculate(ev.GetEventNumber());
     }
-  } // end of reduce if
-  my_event_processing_time.Stop();
+  }
+  times.processing.Stop();
 #ifdef DEBUG
-  cout << "Filling " << " "<< my_event_processing_time.RealTime()<<endl;
+  cout << "Filling " << " "<< times.processing.RealTime()<<endl;
   cout << "----------------------------------------"  <<endl<<endl;
 #endif
-  previous_event_fill_time=my_event_processing_time.RealTime();
+  times.fill=times.processing.RealTime();
+}
 
-  if (ev.IsBORE())
+void RootMonitor::MergeHistograms() {
+  if (_fillPool == NULL)
   {
-    std::cout << "This is a BORE" << std::endl;
+    return;
+  }
+  FillPool::Pause pause(*_fillPool);
+  _fillPool->Merge();
+  // every 1000 events, as without fill threads, but on all hits so far
+  unsigned int events = _fillPool->getLastEventNumber();
+  if (events / 1000 != _calculatedEvents / 1000)
+  {
+    _calculatedEvents = events;
+    for (unsigned int i = 0 ; i < _colls.size(); ++i)
+    {
+      if (_colls.at(i)->getCollectionType()==HITMAP_COLLECTION_TYPE)
+      {
+        _colls.at(i)->Calculate(events - events % 1000);
+      }
+    }
   }
+}
 
+void RootMonitor::ResetHistograms() {
+  std::unique_ptr<FillPool::Pause> pause;
+  if (_fillPool != NULL)
+  {
+    pause.reset(new FillPool::Pause(*_fillPool));
+    _fillPool->Clear();
+    _calculatedEvents = 0;
+  }
+  for (unsigned int i = 0 ; i < _colls.size(); ++i)
+  {
+    if (_colls.at(i) != NULL)
+      _colls.at(i)->Reset();
+  }
 }
 
 void RootMonitor::autoReset(const bool reset) {
@@ -415,6 +515,11 @@ void RootMonitor::autoReset(const bool reset) {
 
 void RootMonitor::OnStopRun()
 {
+  if (_fillPool != NULL)
+  {
+    _fillPool->Drain();
+    MergeHistograms();
+  }
   if (_writeRoot)
   {
     TFile *f = new TFile(rootfilename.c_str(),"RECREATE");
@@ -429,14 +534,14 @@ void RootMonitor::OnStopRun()
 
 void RootMonitor::OnStartRun(unsigned param) {
 
+  if (_fillPool != NULL)
+  {
+    _fillPool->Drain();
+  }
   if (onlinemon->getAutoReset())
   {
     onlinemon->UpdateStatus("Resetting..");
-    for (unsigned int i = 0 ; i < _colls.size(); ++i)
-    {
-      if (_colls.at(i) != NULL)
-        _colls.at(i)->Reset();
-    }
+    ResetHistograms();
   }
 
   Monitor::OnStartRun(param);
@@ -502,6 +607,9 @@ int main(int argc, const char ** argv) {
   eudaq::Option<std::string>     configfile(op, "c", "config_file"," ", "filename","Config file to use for onlinemon");
   eudaq::OptionFlag do_rootatend (op, "rf","root","Write out root-file after each run");
   eudaq::OptionFlag do_resetatend (op, "rs","reset","Reset Histograms when run stops");
+  eudaq::Option<unsigned>        threads(op, "j", "threads", 1, "threads", "Number of threads converting the events (0 = one per core)");
+  eudaq::Option<unsigned>        fillthreads(op, "fj", "fill-threads", 1, "threads", "Number of threads analysing the events and filling the histograms (0 = one per core)");
+  eudaq::Option<std::string>     sharedmemory(op, "sm", "shared-memory", "", "name", "Read the events from the shared memory of the DataCollector instead of the data files");
 
   try {
     op.Parse(argv);
@@ -535,7 +643,8 @@ int main(int argc, const char ** argv) {
     TApplication theApp("App", &argc, const_cast<char**>(argv),0,0);
     RootMonitor mon(rctrl.Value(), file.Value(), x.Value(), y.Value(),
         w.Value(), h.Value(), argc, offline.Value(), limit.Value(),
-        skipping.Value(), skip_counter.Value(), configfile.Value());
+        skipping.Value(), skip_counter.Value(), configfile.Value(), threads.Value(), fillthreads.Value(),
+        sharedmemory.Value());
     mon.setWriteRoot(do_rootatend.IsSet());
     mon.autoReset(do_resetatend.IsSet());
     mon.setReduce(reduce.Value());
@@ -134,6 +134,13 @@ int OnlineMonConfiguration::ReadConfigurationFile() {
           if (correl_minclustersize <= 0) {
             cerr << " Warning Illegal Clustersize used " << endl;
           }
+        } else if (key.compare("Window") == 0) {
+          correl_window = StringToNumber<int>(value);
+          if (correl_window < 0) {
+            cerr << " Warning Illegal Correlation Window used " << endl;
+          }
+        } else if (key.compare("AllPairsMax") == 0) {
+          correl_allpairsmax = StringToNumber<int>(value);
         } else if (key.compare("DisablePlanes") == 0) {
           vector<string> v;
           stringsplit(value, ',', v);
@@ -200,6 +207,8 @@ void OnlineMonConfiguration::SetDefaults() {
 
   // correl cluster settings
   correl_minclustersize = 2;
+  correl_window = 0;
+  correl_allpairsmax = 2500;
 }
 
 void OnlineMonConfiguration::setSnapShotDir(string SnapShotDir) {
@@ -230,6 +239,20 @@ void OnlineMonConfiguration::setCorrel_minclustersize(
   this->correl_minclustersize = correl_minclustersize;
 }
 
+int OnlineMonConfiguration::getCorrel_window() const { return correl_window; }
+
+void OnlineMonConfiguration::setCorrel_window(int correl_window) {
+  this->correl_window = correl_window;
+}
+
+int OnlineMonConfiguration::getCorrel_allpairsmax() const {
+  return correl_allpairsmax;
+}
+
+void OnlineMonConfiguration::setCorrel_allpairsmax(int correl_allpairsmax) {
+  this->correl_allpairsmax = correl_allpairsmax;
+}
+
 string OnlineMonConfiguration::getSnapShotFormat() const {
   return SnapShotFormat;
 }
@@ -249,6 +272,8 @@ void OnlineMonConfiguration::PrintConfiguration() {
   cout << endl;
   cout << "Correlation Settings" << endl;
   cout << "MinClusterSize      : " << correl_minclustersize << endl;
+  cout << "Window              : " << correl_window << endl;
+  cout << "AllPairsMax         : " << correl_allpairsmax << endl;
   cout << "Planes to skip      : ";
   for (unsigned int i = 0; i < planes_to_be_skipped.size(); i++) {
     cout << planes_to_be_skipped[i] << " ";
@@ -40,6 +40,7 @@ OnlineMonWindow::OnlineMonWindow(const TGWindow *p, UInt_t w, UInt_t h)
   // init snapshot counter
   snapshot_sequence = 0;
   _reduce = 1; // set a default value;
+  rmon = NULL;
   cout << "Opening Window" << endl;
   Hfrm_windows = new TGHorizontalFrame(this);
   Hfrm_left = new TGVerticalFrame(Hfrm_windows);
@@ -201,6 +202,8 @@ void OnlineMonWindow::ExecuteEvent(Int_t event, Int_t /*px*/, Int_t /*py*/,
 }
 
 void OnlineMonWindow::Write() {
+  if (rmon != NULL)
+    rmon->MergeHistograms();
   TFile *f = new TFile(_rootfilename.c_str(), "RECREATE");
   if (f != NULL) {
     for (unsigned int i = 0; i < _colls.size(); ++i) {
@@ -214,8 +217,12 @@ void OnlineMonWindow::Write() {
 
 void OnlineMonWindow::Reset() {
   UpdateStatus("Resetting..");
-  for (unsigned int i = 0; i < _colls.size(); ++i) {
-    _colls.at(i)->Reset();
+  if (rmon != NULL) {
+    rmon->ResetHistograms();
+  } else {
+    for (unsigned int i = 0; i < _colls.size(); ++i) {
+      _colls.at(i)->Reset();
+    }
   }
   _analysedEvents = 0;
 }
@@ -347,6 +354,8 @@ void OnlineMonWindow::registerHisto(std::string tree, TH1 *h, std::string op,
 
 void OnlineMonWindow::autoUpdate() {
 
+  if (rmon != NULL)
+    rmon->MergeHistograms();
   _reduceUpdate++;
   unsigned int activeHistoSize = _activeHistos.size();
   if (_reduceUpdate > activeHistoSize) {
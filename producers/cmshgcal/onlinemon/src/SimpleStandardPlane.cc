@@ -8,6 +8,7 @@
 #include <string>
 #include <vector>
 #include "include/SimpleStandardPlane.hh"
+#include "eudaq/Clustering.hh"
 
 SimpleStandardPlane::SimpleStandardPlane(const std::string &name, const int id,
                                          const int maxX, const int maxY,
@@ -104,116 +105,30 @@ void SimpleStandardPlane::reducePixels(const int reduceX, const int reduceY) {
 }
 
 void SimpleStandardPlane::doClustering() {
-  int nClusters = 0;
-  std::vector<int> clusterNumber;
-  const int NOCLUSTER = -1000;
-  const unsigned int minXDistance = 1;
-  const unsigned int minYDistance = 1;
-  const unsigned int npixels_hit = _hits.size();
-  bool continue_flag;
-  clusterNumber.assign(npixels_hit, NOCLUSTER);
-  // std::cout << "Before big loop" << std::endl;
-  // std::cout << "Name: " << _name << std::endl;
-
   // which planes to cluster, reject planes of Type Fortis
   if (is_FORTIS) {
     return;
   }
 
-  if (npixels_hit > 1) // (npixels_hit < 2000 ))
-  {
-    std::sort(_hits.begin(), _hits.end(), SortHitsByXY());
-    for (unsigned int aPixel = 0; aPixel < npixels_hit; aPixel++) {
-      continue_flag = true;
-      const SimpleStandardHit &aPix = _hits.at(aPixel);
-      for (unsigned int bPixel = aPixel + 1; bPixel < npixels_hit; bPixel++) {
-        if (continue_flag != true)
-          break;
-        // for (std::vector<SimpleStandardHit>::const_iterator hit =
-        // _hits.begin();
-        //   hit != _hits.end();
-        // std::cout << aPixel << " " << bPixel << " " << _hits.size() <<
-        // std::endl;
-        const SimpleStandardHit &bPix = _hits.at(bPixel);
-        unsigned int xDist = abs(aPix.getX() - bPix.getX());
-        unsigned int yDist = abs(aPix.getY() - bPix.getY());
-
-        if ((xDist <= minXDistance) &&
-            (yDist <= minYDistance)) { // this means they are neighbors in
-                                       // x-direction && / this means they are
-                                       // neighbors in y-direction
-          if ((clusterNumber.at(aPixel) == NOCLUSTER) &&
-              clusterNumber.at(bPixel) == NOCLUSTER) { // none of these pixels
-                                                       // have been assigned to
-                                                       // a cluster
-            //++nClusters;
-            clusterNumber.at(aPixel) = ++nClusters;
-            clusterNumber.at(bPixel) = nClusters;
-          } else if ((clusterNumber.at(aPixel) == NOCLUSTER) &&
-                     (clusterNumber.at(bPixel) !=
-                      NOCLUSTER)) { // b was assigned already, a not
-            clusterNumber.at(aPixel) = clusterNumber.at(bPixel);
-          } else if ((clusterNumber.at(aPixel) != NOCLUSTER) &&
-                     (clusterNumber.at(bPixel) ==
-                      NOCLUSTER)) { // a was assigned already, b not
-            clusterNumber.at(bPixel) = clusterNumber.at(aPixel);
-          } else { // both pixels have a cluster number already
-            int min =
-                std::min(clusterNumber.at(aPixel), clusterNumber.at(bPixel));
-            clusterNumber.at(aPixel) = min;
-            clusterNumber.at(bPixel) = min;
-          }
-        } else { // these pixels are not neighbored
-          continue_flag = false;
-        }
-        /*
-           if ( clusterNumber.at(aPixel) == NOCLUSTER )
-           {
-           ++nClusters;
-           clusterNumber.at(aPixel) = nClusters;
-           }
-           if ( clusterNumber.at(bPixel) == NOCLUSTER )
-           {
-           ++nClusters;
-           clusterNumber.at(bPixel) = nClusters;
-           }
-           }*/
-      } // inner for loop
-    } // outer for loop
-    for (unsigned int aPixel = 0; aPixel < npixels_hit; aPixel++)
-      if (clusterNumber.at(aPixel) == NOCLUSTER) {
-        ++nClusters;
-        clusterNumber.at(aPixel) = nClusters;
-      }
-  } else { // You can't use the clustering algorithm with only one pixel
-    if (npixels_hit == 1)
-      clusterNumber.at(0) = 1;
-  }
-
-  // std::cout << "After big loop" << std::endl;
-  std::set<int> clusterSet(clusterNumber.begin(), clusterNumber.end());
-
-  /*for (unsigned int i=0; i<npixels_hit;++i) {
-    if ( clusterNumber.at(i) != NOCLUSTER) {
-  //std::cerr << "Cluster with ID -1 in " << i << std::endl;
-  //} else {
-  clusterSet.insert(clusterNumber.at(i));
+  // neighbours are at most one pixel apart in x and y (diagonals included);
+  // the clusterer keeps its buffers, so there is one per thread
+  static thread_local eudaq::PixelClusterer clusterer;
+  static thread_local std::vector<int> xs, ys;
+  static thread_local std::vector<unsigned> labels;
+  const unsigned int npixels_hit = _hits.size();
+  xs.resize(npixels_hit);
+  ys.resize(npixels_hit);
+  for (unsigned int i = 0; i < npixels_hit; i++) {
+    xs[i] = _hits[i].getX();
+    ys[i] = _hits[i].getY();
   }
-  }*/
-  nClusters = clusterSet.size();
+  const size_t nClusters =
+      clusterer.Cluster(xs.data(), ys.data(), 0, npixels_hit, labels);
 
-  std::set<int>::iterator it;
-  for (it = clusterSet.begin(); it != clusterSet.end(); ++it) {
-    SimpleStandardCluster cluster;
-    for (unsigned int i = 0; i < npixels_hit; i++) {
-      if (clusterNumber.at(i) == *it) { // Put only these pixels in that
-                                        // ClusterCollection that belong to that
-                                        // cluster
-        cluster.addPixel(_hits.at(i));
-      }
-    }
-    _clusters.push_back(cluster);
-    // std::cout << "Cluster at: " << cluster.getX() << std::endl;
+  const size_t first = _clusters.size();
+  _clusters.resize(first + nClusters);
+  for (unsigned int i = 0; i < npixels_hit; i++) {
+    _clusters[first + labels[i]].addPixel(_hits[i]);
   }
   // if we have a mimosa, we need to fill the section information
 